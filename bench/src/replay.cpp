@@ -0,0 +1,239 @@
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <ecs.h>
+
+/**
+ * @brief Replays a trace recorded with ECS::TraceRecorder against an entity manager, and reports the throughput
+ * and latency percentiles of every operation.
+ *
+ * Usage: replay <trace> [repetitions]
+ *
+ * The component types of the trace are replaced by Slot components of SLOT_SIZE bytes, and its systems by
+ * systems with the same masks that read every component in their aspect.
+ */
+
+/**
+ * @brief The size of the components the trace's component types are replaced with.
+ *
+ */
+const size_t SLOT_SIZE = 64;
+
+/**
+ * @brief Stands in for the component type with the same index in the trace.
+ *
+ */
+template <size_t I>
+struct Slot : public ECS::Component<Slot<I>>
+{
+    unsigned char bytes[SLOT_SIZE];
+};
+
+typedef void (*AddFunction)(ECS::EntityManager&, ECS::Entity);
+typedef void (*RemoveFunction)(ECS::EntityManager&, ECS::Entity);
+typedef const unsigned char* (*GetFunction)(ECS::EntityManager&, ECS::Entity);
+
+template <size_t I>
+void AddSlot(ECS::EntityManager& entityManager, ECS::Entity entity)
+{
+    entityManager.AddComponent<Slot<I>>(entity);
+}
+
+template <size_t I>
+void RemoveSlot(ECS::EntityManager& entityManager, ECS::Entity entity)
+{
+    entityManager.RemoveComponent<Slot<I>>(entity);
+}
+
+template <size_t I>
+const unsigned char* GetSlot(ECS::EntityManager& entityManager, ECS::Entity entity)
+{
+    return entityManager.GetComponent<Slot<I>>(entity)->bytes;
+}
+
+/**
+ * @brief The functions of every slot, indexed by the component type in the trace.
+ *
+ */
+struct SlotTable
+{
+    AddFunction add[ECS::MAX_COMPONENTS];
+    RemoveFunction remove[ECS::MAX_COMPONENTS];
+    GetFunction get[ECS::MAX_COMPONENTS];
+
+    template <size_t... Is>
+    SlotTable(ECS::Private::IndexSequence<Is...>)
+    {
+        AddFunction addFunctions[] = { &AddSlot<Is>... };
+        RemoveFunction removeFunctions[] = { &RemoveSlot<Is>... };
+        GetFunction getFunctions[] = { &GetSlot<Is>... };
+
+        for (size_t i = 0; i < ECS::MAX_COMPONENTS; ++i)
+        {
+            add[i] = addFunctions[i];
+            remove[i] = removeFunctions[i];
+            get[i] = getFunctions[i];
+        }
+    }
+};
+
+/**
+ * @brief Stands in for a system of the trace. Reads every component in its aspect.
+ *
+ */
+class ReplaySystem : public ECS::EntitySystem
+{
+public:
+    ReplaySystem(const SlotTable& table, const std::bitset<ECS::MAX_COMPONENTS>& aspect, const std::bitset<ECS::MAX_COMPONENTS>& exclude, const std::bitset<ECS::MAX_COMPONENTS>& anyOf) : table(table)
+    {
+        checksum = 0;
+        SetMasks(aspect, exclude, anyOf, ECS::Private::MakeIndexSequence<ECS::MAX_COMPONENTS>::Type());
+
+        for (size_t i = 0; i < ECS::MAX_COMPONENTS; ++i)
+        {
+            if (aspect.test(i))
+                reads.push_back(table.get[i]);
+        }
+    }
+
+    void ProcessEntity(ECS::Entity entity)
+    {
+        for (auto get : reads)
+            checksum += get(*GetEntityManager(), entity)[0];
+    }
+
+    size_t checksum;
+private:
+    template <size_t... Is>
+    void SetMasks(const std::bitset<ECS::MAX_COMPONENTS>& aspect, const std::bitset<ECS::MAX_COMPONENTS>& exclude, const std::bitset<ECS::MAX_COMPONENTS>& anyOf, ECS::Private::IndexSequence<Is...>)
+    {
+        int expand[] = { 0, (SetMask<Is>(aspect, exclude, anyOf), 0)... };
+        (void)expand;
+    }
+
+    template <size_t I>
+    void SetMask(const std::bitset<ECS::MAX_COMPONENTS>& aspect, const std::bitset<ECS::MAX_COMPONENTS>& exclude, const std::bitset<ECS::MAX_COMPONENTS>& anyOf)
+    {
+        if (aspect.test(I))
+            Require<Slot<I>>();
+        if (exclude.test(I))
+            Exclude<Slot<I>>();
+        if (anyOf.test(I))
+            RequireAnyOf<Slot<I>>();
+    }
+
+    const SlotTable& table;
+    std::vector<GetFunction> reads;
+};
+
+/**
+ * @brief Replays a trace against an entity manager and system manager.
+ *
+ */
+class EntityManagerTarget : public ECS::ReplayTarget
+{
+public:
+    EntityManagerTarget(const SlotTable& table, bool verbose) : table(table), verbose(verbose), systemManager(&entityManager) {}
+
+    void DeclareComponent(ECS::ComponentType componentType, size_t size)
+    {
+        if (verbose)
+            std::printf("component %u: %zu bytes, replayed as %zu bytes\n", componentType, size, SLOT_SIZE);
+    }
+
+    void DeclareSystem(size_t system, const std::bitset<ECS::MAX_COMPONENTS>& aspect, const std::bitset<ECS::MAX_COMPONENTS>& exclude, const std::bitset<ECS::MAX_COMPONENTS>& anyOf)
+    {
+        if (system >= systems.size())
+            systems.resize(system + 1, nullptr);
+
+        systems[system] = new ReplaySystem(table, aspect, exclude, anyOf);
+        systemManager.RegisterSystem(systems[system]);
+    }
+
+    ECS::Entity CreateEntity()
+    {
+        return entityManager.CreateEntity();
+    }
+
+    void RemoveEntity(ECS::Entity entity)
+    {
+        entityManager.RemoveEntity(entity);
+    }
+
+    void AddComponent(ECS::Entity entity, ECS::ComponentType componentType)
+    {
+        table.add[componentType](entityManager, entity);
+    }
+
+    void RemoveComponent(ECS::Entity entity, ECS::ComponentType componentType)
+    {
+        table.remove[componentType](entityManager, entity);
+    }
+
+    void DestroyRemoved()
+    {
+        entityManager.DestroyRemoved();
+    }
+
+    void Process(size_t system)
+    {
+        if (system < systems.size() && systems[system] != nullptr)
+            systems[system]->Process();
+    }
+private:
+    const SlotTable& table;
+    bool verbose;
+    ECS::EntityManager entityManager;
+    ECS::SystemManager systemManager;
+
+    /**
+     * @brief The systems by their index in the trace. Owned by the system manager.
+     *
+     */
+    std::vector<ReplaySystem*> systems;
+};
+
+int main(int argc, char** argv)
+{
+    if (argc < 2)
+    {
+        std::fprintf(stderr, "usage: %s <trace> [repetitions]\n", argv[0]);
+        return 1;
+    }
+
+    int repetitions = argc > 2 ? std::atoi(argv[2]) : 1;
+    SlotTable table((ECS::Private::MakeIndexSequence<ECS::MAX_COMPONENTS>::Type()));
+    ECS::TraceReplayer replayer;
+
+    for (int i = 0; i < repetitions; ++i)
+    {
+        std::ifstream stream(argv[1], std::ios::binary);
+        ECS::TraceReader reader(stream);
+        EntityManagerTarget target(table, i == 0);
+
+        if (!replayer.Replay(reader, target))
+        {
+            std::fprintf(stderr, "%s is not a valid trace\n", argv[1]);
+            return 1;
+        }
+    }
+
+    std::printf("%-16s %10s %12s %8s %8s %8s %8s\n", "operation", "count", "ops/s", "p50 ns", "p90 ns", "p99 ns", "max ns");
+    for (size_t i = 0; i < ECS::TraceOperation::DECLARE_COMPONENT; ++i)
+    {
+        ECS::TraceOperation::Type type = static_cast<ECS::TraceOperation::Type>(i);
+        size_t count = replayer.GetCount(type);
+        if (count == 0)
+            continue;
+
+        uint64_t nanoseconds = replayer.GetTotalNanoseconds(type);
+        double throughput = nanoseconds > 0 ? static_cast<double>(count) * 1e9 / static_cast<double>(nanoseconds) : 0.0;
+        std::printf("%-16s %10zu %12.0f %8llu %8llu %8llu %8llu\n", ECS::TraceReplayer::GetName(type), count, throughput,
+                    static_cast<unsigned long long>(replayer.GetPercentile(type, 50.0)),
+                    static_cast<unsigned long long>(replayer.GetPercentile(type, 90.0)),
+                    static_cast<unsigned long long>(replayer.GetPercentile(type, 99.0)),
+                    static_cast<unsigned long long>(replayer.GetPercentile(type, 100.0)));
+    }
+
+    return 0;
+}
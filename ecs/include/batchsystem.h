@@ -0,0 +1,234 @@
+#pragma once
+
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <type_traits>
+#include "system.h"
+#include "entitymanager.h"
+
+namespace ECS
+{
+    namespace Private
+    {
+        /**
+         * @brief Private type. A compile time list of indices, used to expand parameter packs in lockstep.
+         *
+         */
+        template <size_t... Is>
+        struct IndexSequence {};
+
+        template <size_t N, size_t... Is>
+        struct MakeIndexSequence : MakeIndexSequence<N - 1, N - 1, Is...> {};
+
+        template <size_t... Is>
+        struct MakeIndexSequence<0, Is...>
+        {
+            typedef IndexSequence<Is...> Type;
+        };
+    }
+
+    /**
+     * @brief A system that processes contiguous spans of component columns instead of single entities.
+     *
+     * The template types are the component types the system reads and writes, and they are also its aspect.
+     * Declare a type const to get read-only access to it, e.g. BatchSystem<Position, const Velocity>. More
+     * components can be required or excluded with the usual functions.
+     *
+     * Process calls ProcessBatch once for every run of enabled entities whose components are stored
+     * consecutively in all columns. Entities that are created and given components in the same order end up in one run, but
+     * destroying components moves other components around and splits runs. The runs are cached and only
+     * recomputed when the processing list or the layout of one of the columns has changed.
+     *
+     * Alignment: every column starts at a COLUMN_ALIGNMENT byte boundary and is padded to a multiple of
+     * COLUMN_ALIGNMENT bytes. A span starting at index i of a column of T is therefore aligned to alignof(T),
+     * and to COLUMN_ALIGNMENT if i * sizeof(T) is a multiple of it. Kernels may read, but not write, past the
+     * end of a span up to the next COLUMN_ALIGNMENT boundary.
+     *
+     * Components of the processed types must not be added or destroyed while processing, since that may move
+     * the columns. Removing entities and components is fine, since destruction is deferred.
+     */
+    template <typename... Ts>
+    class BatchSystem : public EntitySystem
+    {
+    public:
+        virtual ~BatchSystem() {}
+
+        /**
+         * @brief Process a run of entities.
+         *
+         * @param count The number of entities in the run.
+         * @param components One pointer per component type, to the first of count consecutive components.
+         */
+        virtual void ProcessBatch(size_t count, Ts*... components) = 0;
+    protected:
+        /**
+         * @brief Protected constructor. Requires all template types.
+         *
+         */
+        BatchSystem();
+
+        /**
+         * @brief Call ProcessBatch for every run of consecutive components.
+         *
+         */
+        void ProcessEntities();
+    private:
+        static const size_t COLUMN_COUNT = sizeof...(Ts);
+
+        /**
+         * @brief Not used; batch systems do not visit single entities.
+         *
+         */
+        void ProcessEntity(Entity entity);
+
+        /**
+         * @brief Recompute the runs from the processing list and the layout of the columns.
+         *
+         */
+        void UpdateRuns(Private::ComponentPoolBase* const* pools);
+
+        /**
+         * @brief Check if the cached runs are still valid.
+         *
+         */
+        bool IsCacheValid(Private::ComponentPoolBase* const* pools) const;
+
+        /**
+         * @brief Call ProcessBatch for one run, expanding the column pointers.
+         *
+         */
+        template <size_t... Is>
+        void ProcessRun(Private::ComponentPoolBase* const* pools, const size_t* run, Private::IndexSequence<Is...>);
+
+        /**
+         * @brief The cached runs. Each run takes COLUMN_COUNT + 1 values: the number of entities followed by the
+         * start index in each column.
+         *
+         */
+        std::vector<size_t> runs;
+
+        /**
+         * @brief Scratch list of (index in the first column, internal ID) pairs, used to compute the runs.
+         *
+         */
+        std::vector<std::pair<size_t, size_t>> order;
+
+        /**
+         * @brief The versions of the processing list and columns the runs were computed for.
+         *
+         */
+        bool cached;
+        size_t cachedMembershipVersion;
+        size_t cachedPoolVersions[COLUMN_COUNT];
+    };
+
+
+    // IMPLEMENTATION
+
+    template <typename... Ts>
+    BatchSystem<Ts...>::BatchSystem()
+    {
+        static_assert(COLUMN_COUNT > 0, "A batch system needs at least one component type");
+
+        int expand[] = { 0, (Require<typename std::remove_const<Ts>::type>(), 0)... };
+        (void)expand;
+
+        cached = false;
+        cachedMembershipVersion = 0;
+        for (size_t i = 0; i < COLUMN_COUNT; ++i)
+            cachedPoolVersions[i] = 0;
+    }
+
+    template <typename... Ts>
+    void BatchSystem<Ts...>::ProcessEntities()
+    {
+        EntityManager* entityManager = GetEntityManager();
+        assert(entityManager != nullptr);
+
+        if (GetEnabledEntityCount() == 0)
+            return;
+
+        Private::ComponentPoolBase* const pools[] = { entityManager->GetPool<typename std::remove_const<Ts>::type>()... };
+        if (!IsCacheValid(pools))
+            UpdateRuns(pools);
+
+        for (size_t i = 0; i < runs.size(); i += COLUMN_COUNT + 1)
+            ProcessRun(pools, &runs[i], typename Private::MakeIndexSequence<COLUMN_COUNT>::Type());
+    }
+
+    template <typename... Ts>
+    void BatchSystem<Ts...>::ProcessEntity(Entity) {}
+
+    template <typename... Ts>
+    void BatchSystem<Ts...>::UpdateRuns(Private::ComponentPoolBase* const* pools)
+    {
+        const std::vector<Entity>& entities = GetEntities();
+        const std::vector<size_t>& internalIds = GetInternalIds();
+
+        // Sort the enabled entities in the order of the first column.
+        order.clear();
+        for (size_t i = 0; i < GetEnabledEntityCount(); ++i)
+        {
+            if (entities[i] != INVALID_ENTITY)
+                order.push_back(std::make_pair(pools[0]->IndexOf(internalIds[i]), internalIds[i]));
+        }
+        std::sort(order.begin(), order.end());
+
+        // Extend the current run as long as the next entity follows the previous one in every column.
+        runs.clear();
+        size_t current = 0;
+        size_t previous[COLUMN_COUNT] = {};
+        for (size_t i = 0; i < order.size(); ++i)
+        {
+            size_t indices[COLUMN_COUNT];
+            bool extends = !runs.empty();
+            for (size_t c = 0; c < COLUMN_COUNT; ++c)
+            {
+                indices[c] = (c == 0) ? order[i].first : pools[c]->IndexOf(order[i].second);
+                assert(indices[c] != Private::ComponentPoolBase::INVALID_INDEX);
+
+                extends = extends && indices[c] == previous[c] + 1;
+                previous[c] = indices[c];
+            }
+
+            if (extends)
+            {
+                ++runs[current];
+            }
+            else
+            {
+                current = runs.size();
+                runs.push_back(1);
+                runs.insert(runs.end(), indices, indices + COLUMN_COUNT);
+            }
+        }
+
+        cached = true;
+        cachedMembershipVersion = GetMembershipVersion();
+        for (size_t c = 0; c < COLUMN_COUNT; ++c)
+            cachedPoolVersions[c] = pools[c]->GetVersion();
+    }
+
+    template <typename... Ts>
+    bool BatchSystem<Ts...>::IsCacheValid(Private::ComponentPoolBase* const* pools) const
+    {
+        if (!cached || cachedMembershipVersion != GetMembershipVersion())
+            return false;
+
+        for (size_t c = 0; c < COLUMN_COUNT; ++c)
+        {
+            if (cachedPoolVersions[c] != pools[c]->GetVersion())
+                return false;
+        }
+
+        return true;
+    }
+
+    template <typename... Ts>
+    template <size_t... Is>
+    void BatchSystem<Ts...>::ProcessRun(Private::ComponentPoolBase* const* pools, const size_t* run, Private::IndexSequence<Is...>)
+    {
+        ProcessBatch(run[0], (static_cast<Private::ComponentPool<typename std::remove_const<Ts>::type>*>(pools[Is])->GetData() + run[1 + Is])...);
+    }
+}
@@ -0,0 +1,352 @@
+#pragma once
+
+#include <cassert>
+#include <cstring>
+#include <type_traits>
+#include "componentpool.h"
+
+namespace ECS
+{
+    /**
+     * @brief Access to the fields of a blocked component of type T, which are spread out over its block.
+     *
+     * The view is null if the entity has no such component. It is valid until the pool is modified.
+     */
+    template <typename T>
+    class BlockedView
+    {
+    public:
+        typedef typename T::Scalar Scalar;
+
+        /**
+         * @brief Constructor. Create a null view.
+         *
+         */
+        BlockedView();
+
+        /**
+         * @brief Constructor. Create a view of the component whose first field is at the given address.
+         *
+         */
+        BlockedView(Scalar* first);
+
+        /**
+         * @brief Check if the view refers to no component.
+         *
+         */
+        bool IsNull() const;
+
+        /**
+         * @brief Get a field of the component, e.g. view.Field(&Position::x).
+         *
+         */
+        Scalar& Field(Scalar T::* field) const;
+
+        /**
+         * @brief Gather the fields of the component into a value.
+         *
+         */
+        T Load() const;
+
+        /**
+         * @brief Scatter the fields of a value into the component.
+         *
+         */
+        void Store(const T& value) const;
+    private:
+        /**
+         * @brief The first field of the component. Field i is at first[i * T::WIDTH].
+         *
+         */
+        Scalar* first;
+    };
+
+    namespace Private
+    {
+        /**
+         * @brief Private type. Stores blocked components of type T in blocks of T::WIDTH, field by field.
+         *
+         * A block holds T::WIDTH components as one array per field. The components are kept in the same order as
+         * the dense array, so the component at dense index i is lane i % WIDTH of block i / WIDTH, and all blocks
+         * but the last are full.
+         */
+        template <typename T>
+        class BlockedComponentPool : public ComponentPoolBase
+        {
+        public:
+            typedef typename T::Scalar Scalar;
+
+            /**
+             * @brief The number of fields of T.
+             *
+             */
+            static const size_t FIELD_COUNT = sizeof(T) / sizeof(Scalar);
+
+            /**
+             * @brief The number of scalars in a block.
+             *
+             */
+            static const size_t BLOCK_SIZE = FIELD_COUNT * T::WIDTH;
+
+            /**
+             * @brief Constructor. Reserve memory for the given number of components.
+             *
+             */
+            BlockedComponentPool(size_t reservedCount);
+
+            /**
+             * @brief Set the component of the entity to a value, adding it if the entity has none.
+             *
+             */
+            BlockedView<T> Add(size_t internalId, const T& value);
+
+            /**
+             * @brief Get the component associated with the entity.
+             *
+             * @return The component, or a null view if the entity has no component in this pool.
+             */
+            BlockedView<T> Get(size_t internalId);
+
+            size_t GetComponentSize() const;
+            void Remove(size_t internalId);
+            void Clone(size_t sourceId, const size_t* targetIds, size_t count);
+            ComponentPoolBase* CreateEmpty(size_t reservedCount) const;
+            void Transfer(size_t internalId, ComponentPoolBase* target, size_t targetId);
+            void Swap(size_t first, size_t second);
+
+            /**
+             * @brief Get the number of blocks.
+             *
+             */
+            size_t GetBlockCount() const;
+
+            /**
+             * @brief Get the first scalar of a block.
+             *
+             */
+            Scalar* GetBlock(size_t block);
+        private:
+            /**
+             * @brief Get a view of the component at a dense index.
+             *
+             */
+            BlockedView<T> At(size_t index);
+
+            /**
+             * @brief Add or drop blocks so that there are just enough for all components.
+             *
+             */
+            void FitBlocks();
+
+            /**
+             * @brief The blocks, one after another.
+             *
+             */
+            Column<Scalar> data;
+        };
+    }
+
+
+    // IMPLEMENTATION
+
+    template <typename T>
+    BlockedView<T>::BlockedView()
+    {
+        first = nullptr;
+    }
+
+    template <typename T>
+    BlockedView<T>::BlockedView(Scalar* first)
+    {
+        this->first = first;
+    }
+
+    template <typename T>
+    bool BlockedView<T>::IsNull() const
+    {
+        return first == nullptr;
+    }
+
+    template <typename T>
+    typename BlockedView<T>::Scalar& BlockedView<T>::Field(Scalar T::* field) const
+    {
+        assert(first != nullptr);
+
+        // Find the position of the field from its offset in a plain value.
+        T probe;
+        size_t offset = static_cast<size_t>(reinterpret_cast<const char*>(&(probe.*field)) - reinterpret_cast<const char*>(&probe));
+        return first[offset / sizeof(Scalar) * T::WIDTH];
+    }
+
+    template <typename T>
+    T BlockedView<T>::Load() const
+    {
+        assert(first != nullptr);
+
+        T value;
+        char* bytes = reinterpret_cast<char*>(&value);
+        for (size_t i = 0; i < sizeof(T) / sizeof(Scalar); ++i)
+            std::memcpy(bytes + i * sizeof(Scalar), first + i * T::WIDTH, sizeof(Scalar));
+        return value;
+    }
+
+    template <typename T>
+    void BlockedView<T>::Store(const T& value) const
+    {
+        assert(first != nullptr);
+
+        const char* bytes = reinterpret_cast<const char*>(&value);
+        for (size_t i = 0; i < sizeof(T) / sizeof(Scalar); ++i)
+            std::memcpy(first + i * T::WIDTH, bytes + i * sizeof(Scalar), sizeof(Scalar));
+    }
+
+    namespace Private
+    {
+        template <typename T>
+        const size_t BlockedComponentPool<T>::FIELD_COUNT;
+
+        template <typename T>
+        const size_t BlockedComponentPool<T>::BLOCK_SIZE;
+
+        template <typename T>
+        BlockedComponentPool<T>::BlockedComponentPool(size_t reservedCount)
+        {
+            static_assert(std::is_trivially_copyable<T>::value, "Blocked components must be trivially copyable");
+            static_assert(sizeof(T) % sizeof(Scalar) == 0, "Blocked components must only have fields of their scalar type");
+            static_assert(T::WIDTH > 0, "The block width must be positive");
+
+            sparse.reserve(reservedCount);
+            dense.reserve(reservedCount);
+            data.Reserve((reservedCount + T::WIDTH - 1) / T::WIDTH * BLOCK_SIZE);
+        }
+
+        template <typename T>
+        BlockedView<T> BlockedComponentPool<T>::Add(size_t internalId, const T& value)
+        {
+            size_t index = IndexOf(internalId);
+            if (index == INVALID_INDEX)
+            {
+                index = Link(internalId);
+                FitBlocks();
+            }
+
+            BlockedView<T> view = At(index);
+            view.Store(value);
+            return view;
+        }
+
+        template <typename T>
+        BlockedView<T> BlockedComponentPool<T>::Get(size_t internalId)
+        {
+            size_t index = IndexOf(internalId);
+            if (index == INVALID_INDEX)
+                return BlockedView<T>();
+
+            return At(index);
+        }
+
+        template <typename T>
+        size_t BlockedComponentPool<T>::GetComponentSize() const
+        {
+            return sizeof(T);
+        }
+
+        template <typename T>
+        void BlockedComponentPool<T>::Remove(size_t internalId)
+        {
+            size_t index = IndexOf(internalId);
+            if (index == INVALID_INDEX)
+                return;
+
+            size_t last = Size() - 1;
+            if (index != last)
+                At(index).Store(At(last).Load());
+            Unlink(internalId);
+            FitBlocks();
+        }
+
+        template <typename T>
+        void BlockedComponentPool<T>::Clone(size_t sourceId, const size_t* targetIds, size_t count)
+        {
+            size_t sourceIndex = IndexOf(sourceId);
+            assert(sourceIndex != INVALID_INDEX);
+
+            const T prototype = At(sourceIndex).Load();
+            for (size_t i = 0; i < count; ++i)
+            {
+                assert(!Has(targetIds[i]));
+                Link(targetIds[i]);
+            }
+
+            FitBlocks();
+            for (size_t i = Size() - count; i < Size(); ++i)
+                At(i).Store(prototype);
+        }
+
+        template <typename T>
+        ComponentPoolBase* BlockedComponentPool<T>::CreateEmpty(size_t reservedCount) const
+        {
+            return new BlockedComponentPool<T>(reservedCount);
+        }
+
+        template <typename T>
+        void BlockedComponentPool<T>::Transfer(size_t internalId, ComponentPoolBase* target, size_t targetId)
+        {
+            size_t index = IndexOf(internalId);
+            assert(index != INVALID_INDEX);
+
+            BlockedComponentPool<T>* targetPool = static_cast<BlockedComponentPool<T>*>(target);
+            assert(!targetPool->Has(targetId));
+
+            targetPool->Add(targetId, At(index).Load());
+            Remove(internalId);
+        }
+
+        template <typename T>
+        void BlockedComponentPool<T>::Swap(size_t first, size_t second)
+        {
+            if (first == second)
+                return;
+
+            T value = At(first).Load();
+            At(first).Store(At(second).Load());
+            At(second).Store(value);
+            SwapLinks(first, second);
+        }
+
+        template <typename T>
+        size_t BlockedComponentPool<T>::GetBlockCount() const
+        {
+            return data.Size() / BLOCK_SIZE;
+        }
+
+        template <typename T>
+        typename BlockedComponentPool<T>::Scalar* BlockedComponentPool<T>::GetBlock(size_t block)
+        {
+            assert(block < GetBlockCount());
+            return data.Data() + block * BLOCK_SIZE;
+        }
+
+        template <typename T>
+        BlockedView<T> BlockedComponentPool<T>::At(size_t index)
+        {
+            return BlockedView<T>(data.Data() + index / T::WIDTH * BLOCK_SIZE + index % T::WIDTH);
+        }
+
+        template <typename T>
+        void BlockedComponentPool<T>::FitBlocks()
+        {
+            size_t required = (Size() + T::WIDTH - 1) / T::WIDTH * BLOCK_SIZE;
+
+            // New blocks are zeroed, so that the unused lanes of the last block hold no garbage.
+            if (data.Size() < required)
+            {
+                size_t added = required - data.Size();
+                std::memset(static_cast<void*>(data.Extend(added)), 0, added * sizeof(Scalar));
+            }
+
+            while (data.Size() > required)
+                data.PopBack();
+        }
+    }
+}
@@ -0,0 +1,377 @@
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <new>
+#include <utility>
+
+namespace ECS
+{
+    namespace Private
+    {
+        /**
+         * @brief Private function. Allocate memory for a buffer from a pool of size classes.
+         *
+         * Blocks are powers of two in size and are reused after being freed, so buffers that grow and shrink
+         * rarely hit the system allocator. Thread safe.
+         *
+         * @param bytes The minimum number of bytes.
+         * @param allocated Set to the usable number of bytes in the block.
+         * @return The block, aligned like malloc.
+         */
+        void* AllocateBuffer(size_t bytes, size_t& allocated);
+
+        /**
+         * @brief Private function. Return a block allocated with AllocateBuffer to the pool.
+         *
+         * @param memory The block.
+         * @param allocated The usable size returned by AllocateBuffer.
+         */
+        void FreeBuffer(void* memory, size_t allocated);
+    }
+
+    /**
+     * @brief A variable-length array of T for use in components, with room for N elements inside the component.
+     *
+     * As long as the buffer holds at most N elements they are stored inline, right in the component storage, so
+     * reading them does not leave the component array. Larger buffers spill to blocks from a pooled heap.
+     *
+     * Example: struct Path : public Component<Path> { Buffer<Waypoint, 8> waypoints; };
+     */
+    template <typename T, size_t N>
+    class Buffer
+    {
+    public:
+        Buffer();
+        Buffer(const Buffer& other);
+        Buffer(Buffer&& other);
+        ~Buffer();
+
+        Buffer& operator=(const Buffer& other);
+        Buffer& operator=(Buffer&& other);
+
+        /**
+         * @brief Get the number of elements.
+         *
+         */
+        size_t Size() const;
+
+        /**
+         * @brief Get the number of elements that fit without growing.
+         *
+         */
+        size_t Capacity() const;
+
+        /**
+         * @brief Check if the elements are stored inside the buffer rather than on the heap.
+         *
+         */
+        bool IsInline() const;
+
+        /**
+         * @brief Make room for at least the given number of elements.
+         *
+         */
+        void Reserve(size_t capacity);
+
+        /**
+         * @brief Append an element.
+         *
+         */
+        void PushBack(const T& element);
+
+        /**
+         * @brief Destroy the last element.
+         *
+         */
+        void PopBack();
+
+        /**
+         * @brief Destroy all elements. Heap memory is kept.
+         *
+         */
+        void Clear();
+
+        T* Data();
+        const T* Data() const;
+        T* begin();
+        T* end();
+        const T* begin() const;
+        const T* end() const;
+        T& operator[](size_t index);
+        const T& operator[](size_t index) const;
+    private:
+        static_assert(N > 0, "A buffer needs an inline capacity of at least one element");
+        static_assert(alignof(T) <= alignof(std::max_align_t), "Over-aligned buffer elements are not supported");
+
+        /**
+         * @brief Move the elements to a heap block with room for the given number of elements.
+         *
+         */
+        void Grow(size_t capacity);
+
+        /**
+         * @brief Destroy the elements and give the heap block back.
+         *
+         */
+        void Release();
+
+        /**
+         * @brief Get the inline storage as elements.
+         *
+         */
+        T* GetInline();
+
+        /**
+         * @brief The heap block, or nullptr while the elements are inline.
+         *
+         */
+        T* heap;
+
+        /**
+         * @brief The usable size of the heap block in bytes.
+         *
+         */
+        size_t heapBytes;
+
+        size_t size;
+        size_t capacity;
+
+        /**
+         * @brief Room for N elements, used while the buffer is inline.
+         *
+         */
+        alignas(T) unsigned char storage[N * sizeof(T)];
+    };
+
+
+    // IMPLEMENTATION
+
+    template <typename T, size_t N>
+    Buffer<T, N>::Buffer()
+    {
+        heap = nullptr;
+        heapBytes = 0;
+        size = 0;
+        capacity = N;
+    }
+
+    template <typename T, size_t N>
+    Buffer<T, N>::Buffer(const Buffer& other)
+    {
+        heap = nullptr;
+        heapBytes = 0;
+        size = 0;
+        capacity = N;
+        *this = other;
+    }
+
+    template <typename T, size_t N>
+    Buffer<T, N>::Buffer(Buffer&& other)
+    {
+        heap = nullptr;
+        heapBytes = 0;
+        size = 0;
+        capacity = N;
+        *this = std::move(other);
+    }
+
+    template <typename T, size_t N>
+    Buffer<T, N>::~Buffer()
+    {
+        Release();
+    }
+
+    template <typename T, size_t N>
+    Buffer<T, N>& Buffer<T, N>::operator=(const Buffer& other)
+    {
+        if (this == &other)
+            return *this;
+
+        Clear();
+        Reserve(other.size);
+        for (size_t i = 0; i < other.size; ++i)
+            new (Data() + i) T(other.Data()[i]);
+        size = other.size;
+        return *this;
+    }
+
+    template <typename T, size_t N>
+    Buffer<T, N>& Buffer<T, N>::operator=(Buffer&& other)
+    {
+        if (this == &other)
+            return *this;
+
+        Release();
+        if (other.heap != nullptr)
+        {
+            // Take over the heap block.
+            heap = other.heap;
+            heapBytes = other.heapBytes;
+            capacity = other.capacity;
+            size = other.size;
+            other.heap = nullptr;
+            other.heapBytes = 0;
+            other.capacity = N;
+            other.size = 0;
+        }
+        else
+        {
+            for (size_t i = 0; i < other.size; ++i)
+                new (GetInline() + i) T(std::move(other.GetInline()[i]));
+            size = other.size;
+            other.Clear();
+        }
+
+        return *this;
+    }
+
+    template <typename T, size_t N>
+    size_t Buffer<T, N>::Size() const
+    {
+        return size;
+    }
+
+    template <typename T, size_t N>
+    size_t Buffer<T, N>::Capacity() const
+    {
+        return capacity;
+    }
+
+    template <typename T, size_t N>
+    bool Buffer<T, N>::IsInline() const
+    {
+        return heap == nullptr;
+    }
+
+    template <typename T, size_t N>
+    void Buffer<T, N>::Reserve(size_t capacity)
+    {
+        if (capacity > this->capacity)
+            Grow(capacity);
+    }
+
+    template <typename T, size_t N>
+    void Buffer<T, N>::PushBack(const T& element)
+    {
+        if (size == capacity)
+        {
+            // Copy first, in case the element lives in this buffer.
+            T copy(element);
+            Grow(capacity * 2);
+            new (Data() + size) T(std::move(copy));
+        }
+        else
+        {
+            new (Data() + size) T(element);
+        }
+
+        ++size;
+    }
+
+    template <typename T, size_t N>
+    void Buffer<T, N>::PopBack()
+    {
+        assert(size > 0);
+        --size;
+        Data()[size].~T();
+    }
+
+    template <typename T, size_t N>
+    void Buffer<T, N>::Clear()
+    {
+        for (size_t i = 0; i < size; ++i)
+            Data()[i].~T();
+        size = 0;
+    }
+
+    template <typename T, size_t N>
+    T* Buffer<T, N>::Data()
+    {
+        return heap != nullptr ? heap : GetInline();
+    }
+
+    template <typename T, size_t N>
+    const T* Buffer<T, N>::Data() const
+    {
+        return heap != nullptr ? heap : reinterpret_cast<const T*>(storage);
+    }
+
+    template <typename T, size_t N>
+    T* Buffer<T, N>::begin()
+    {
+        return Data();
+    }
+
+    template <typename T, size_t N>
+    T* Buffer<T, N>::end()
+    {
+        return Data() + size;
+    }
+
+    template <typename T, size_t N>
+    const T* Buffer<T, N>::begin() const
+    {
+        return Data();
+    }
+
+    template <typename T, size_t N>
+    const T* Buffer<T, N>::end() const
+    {
+        return Data() + size;
+    }
+
+    template <typename T, size_t N>
+    T& Buffer<T, N>::operator[](size_t index)
+    {
+        assert(index < size);
+        return Data()[index];
+    }
+
+    template <typename T, size_t N>
+    const T& Buffer<T, N>::operator[](size_t index) const
+    {
+        assert(index < size);
+        return Data()[index];
+    }
+
+    template <typename T, size_t N>
+    void Buffer<T, N>::Grow(size_t capacity)
+    {
+        size_t allocated;
+        T* moved = static_cast<T*>(Private::AllocateBuffer(capacity * sizeof(T), allocated));
+
+        T* elements = Data();
+        for (size_t i = 0; i < size; ++i)
+        {
+            new (moved + i) T(std::move(elements[i]));
+            elements[i].~T();
+        }
+
+        if (heap != nullptr)
+            Private::FreeBuffer(heap, heapBytes);
+
+        heap = moved;
+        heapBytes = allocated;
+        this->capacity = allocated / sizeof(T);
+    }
+
+    template <typename T, size_t N>
+    void Buffer<T, N>::Release()
+    {
+        Clear();
+        if (heap != nullptr)
+        {
+            Private::FreeBuffer(heap, heapBytes);
+            heap = nullptr;
+            heapBytes = 0;
+            capacity = N;
+        }
+    }
+
+    template <typename T, size_t N>
+    T* Buffer<T, N>::GetInline()
+    {
+        return reinterpret_cast<T*>(storage);
+    }
+}
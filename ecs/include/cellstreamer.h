@@ -0,0 +1,284 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <condition_variable>
+#include <deque>
+#include <istream>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+#include "entity.h"
+#include "component.h"
+#include "componentpool.h"
+#include "entitymanager.h"
+
+namespace ECS
+{
+    namespace Private
+    {
+        /**
+         * @brief Private type. How the cell streamer reads and writes one component type.
+         *
+         */
+        struct StreamedType
+        {
+            uint32_t key;
+            ComponentType componentType;
+            size_t size;
+
+            /**
+             * @brief Get the pool of the type in an entity manager, creating it if needed.
+             *
+             */
+            ComponentPoolBase* (*getPool)(EntityManager* entityManager);
+
+            /**
+             * @brief Add components for a batch of entities to the pool, copied from packed bytes.
+             *
+             */
+            void (*append)(ComponentPoolBase* pool, const size_t* internalIds, const unsigned char* bytes, size_t count);
+
+            /**
+             * @brief Get the bytes of the component of an entity, or nullptr if it has none.
+             *
+             */
+            const unsigned char* (*get)(ComponentPoolBase* pool, size_t internalId);
+        };
+
+        /**
+         * @brief Private type. The entities and components of a cell, deserialized but not yet in an entity manager.
+         *
+         */
+        struct StagedCell
+        {
+            /**
+             * @brief The components of one type, packed in the order of the entities owning them.
+             *
+             */
+            struct Column
+            {
+                const StreamedType* type;
+                std::vector<uint32_t> owners;
+                std::vector<unsigned char> bytes;
+            };
+
+            size_t id;
+            bool failed;
+            size_t entityCount;
+            std::vector<Column> columns;
+        };
+    }
+
+    /**
+     * @brief Loads and unloads groups of entities ("cells") at runtime, reading them from disk on a background thread.
+     *
+     * Load queues a cell file for a worker thread, which deserializes its entities and components into a staging
+     * area without touching the entity manager. Commit then inserts the staged cells on the calling thread, one
+     * batch per cell: the components of a type are appended to their pool in one run, and observers (like system
+     * managers) are notified once per entity with all of its components. Unload removes the entities of a cell in bulk.
+     *
+     * Components are stored as raw bytes, so the streamed types must be trivially copyable. They are registered with
+     * a key that identifies them in cell files, since component type IDs may differ between builds. Files are in
+     * the byte order of the machine that wrote them.
+     *
+     * Everything but the file reading happens on the thread calling the member functions, which must be the thread
+     * using the entity manager.
+     */
+    class CellStreamer
+    {
+    public:
+        /**
+         * @brief Constructor. Start the worker thread.
+         *
+         * @param entityManager The entity manager to insert cells into. Must outlive the streamer.
+         */
+        CellStreamer(EntityManager* entityManager);
+
+        /**
+         * @brief Destructor. Stop the worker thread, dropping cells that have not been loaded yet.
+         *
+         */
+        ~CellStreamer();
+
+        /**
+         * @brief Stream components of type T, identified by the given key in cell files.
+         *
+         * Register all types before loading or saving cells. Components of types that are not registered are
+         * not saved, and skipped when loading.
+         */
+        template <typename T>
+        void RegisterComponent(uint32_t key);
+
+        /**
+         * @brief Write the registered components of some entities as a cell.
+         *
+         */
+        void Save(std::ostream& stream, const std::vector<Entity>& entities) const;
+
+        /**
+         * @brief Queue a cell file to be loaded on the worker thread.
+         *
+         * @param id Identifies the cell. Must not be loaded or queued already.
+         * @param path The file written by Save.
+         */
+        void Load(size_t id, const std::string& path);
+
+        /**
+         * @brief Insert staged cells into the entity manager.
+         *
+         * @param maxCells The maximum number of cells to insert, to spread the work over several frames.
+         * @return The number of cells inserted.
+         */
+        size_t Commit(size_t maxCells = static_cast<size_t>(-1));
+
+        /**
+         * @brief Remove the entities of a loaded cell in bulk.
+         *
+         * Entities of the cell that have been removed or destroyed already are skipped. A cell that is still queued
+         * or staged is dropped instead.
+         */
+        void Unload(size_t id);
+
+        /**
+         * @brief Block until the worker thread has staged all queued cells.
+         *
+         */
+        void Wait();
+
+        /**
+         * @brief Check if a cell has been inserted into the entity manager.
+         *
+         */
+        bool IsLoaded(size_t id) const;
+
+        /**
+         * @brief Check if a cell could not be read. Failed cells are not inserted.
+         *
+         */
+        bool HasFailed(size_t id) const;
+
+        /**
+         * @brief Get the entities of a loaded cell, in the order they were saved.
+         *
+         */
+        const std::vector<Entity>& GetEntities(size_t id) const;
+    private:
+        CellStreamer(const CellStreamer&);
+        CellStreamer& operator=(const CellStreamer&);
+
+        /**
+         * @brief A cell file waiting for the worker thread.
+         *
+         */
+        struct Request
+        {
+            size_t id;
+            std::string path;
+        };
+
+        template <typename T>
+        static Private::ComponentPoolBase* GetPool(EntityManager* entityManager);
+
+        template <typename T>
+        static void Append(Private::ComponentPoolBase* pool, const size_t* internalIds, const unsigned char* bytes, size_t count);
+
+        template <typename T>
+        static const unsigned char* Get(Private::ComponentPoolBase* pool, size_t internalId);
+
+        /**
+         * @brief The loop of the worker thread.
+         *
+         */
+        void Run();
+
+        /**
+         * @brief Deserialize a cell. Called on the worker thread.
+         *
+         * @return False if the stream is not a valid cell.
+         */
+        bool Read(std::istream& stream, Private::StagedCell& cell) const;
+
+        /**
+         * @brief Find a registered type by key.
+         *
+         */
+        const Private::StreamedType* FindType(uint32_t key) const;
+
+        EntityManager* entityManager;
+
+        /**
+         * @brief The registered types. Only read by the worker thread, so they must not change while loading.
+         *
+         */
+        std::vector<Private::StreamedType> types;
+
+        /**
+         * @brief The queued requests and staged cells, shared with the worker thread.
+         *
+         */
+        std::deque<Request> requests;
+        std::deque<Private::StagedCell*> staged;
+        size_t current;
+        bool busy;
+        bool dropCurrent;
+        bool stopping;
+        std::mutex mutex;
+        std::condition_variable wakeWorker;
+        std::condition_variable idle;
+
+        /**
+         * @brief The entities of the loaded cells, and the cells that failed to load.
+         *
+         */
+        std::map<size_t, std::vector<Entity>> loaded;
+        std::map<size_t, bool> failed;
+
+        std::thread worker;
+    };
+
+
+    // IMPLEMENTATION
+
+    template <typename T>
+    void CellStreamer::RegisterComponent(uint32_t key)
+    {
+        static_assert(std::is_trivially_copyable<T>::value, "Streamed components must be trivially copyable");
+        assert(FindType(key) == nullptr);
+
+        Private::StreamedType type;
+        type.key = key;
+        type.componentType = Component<T>::ID;
+        type.size = sizeof(T);
+        type.getPool = &CellStreamer::GetPool<T>;
+        type.append = &CellStreamer::Append<T>;
+        type.get = &CellStreamer::Get<T>;
+
+        std::lock_guard<std::mutex> lock(mutex);
+        types.push_back(type);
+    }
+
+    template <typename T>
+    Private::ComponentPoolBase* CellStreamer::GetPool(EntityManager* entityManager)
+    {
+        return entityManager->GetPool<T>();
+    }
+
+    template <typename T>
+    void CellStreamer::Append(Private::ComponentPoolBase* pool, const size_t* internalIds, const unsigned char* bytes, size_t count)
+    {
+        T* first = static_cast<Private::ComponentPool<T>*>(pool)->Append(internalIds, count);
+        if (count > 0)
+            std::memcpy(static_cast<void*>(first), bytes, count * sizeof(T));
+    }
+
+    template <typename T>
+    const unsigned char* CellStreamer::Get(Private::ComponentPoolBase* pool, size_t internalId)
+    {
+        return reinterpret_cast<const unsigned char*>(static_cast<Private::ComponentPool<T>*>(pool)->Get(internalId));
+    }
+}
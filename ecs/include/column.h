@@ -0,0 +1,338 @@
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <new>
+#include <utility>
+#include "config.h"
+
+namespace ECS
+{
+    namespace Private
+    {
+        /**
+         * @brief Private function. Allocate memory aligned to COLUMN_ALIGNMENT.
+         *
+         * The size is rounded up to a multiple of COLUMN_ALIGNMENT.
+         */
+        void* AllocateColumn(size_t bytes);
+
+        /**
+         * @brief Private function. Free memory allocated with AllocateColumn.
+         *
+         */
+        void FreeColumn(void* memory);
+
+        /**
+         * @brief Private function. Reserve a range of address space without making any of it usable.
+         *
+         * The range starts at a page boundary, and at a huge page boundary if COLUMN_HUGE_PAGES is set.
+         *
+         * @return The start of the range, or nullptr if address space cannot be reserved on this platform.
+         */
+        void* ReserveColumn(size_t bytes);
+
+        /**
+         * @brief Private function. Make more of a reserved range usable, rounding up to whole pages.
+         *
+         * Once a range is committed past the huge page size, it is backed by transparent huge pages where
+         * available, if COLUMN_HUGE_PAGES is set.
+         *
+         * @param memory A range reserved with ReserveColumn.
+         * @param reservedBytes The size of the range.
+         * @param committedBytes The number of bytes at the start of the range that are already usable.
+         * @param bytes The number of bytes at the start of the range that should be usable.
+         * @return The number of usable bytes, or 0 if the memory could not be committed.
+         */
+        size_t CommitColumn(void* memory, size_t reservedBytes, size_t committedBytes, size_t bytes);
+
+        /**
+         * @brief Private function. Give a range reserved with ReserveColumn back to the system.
+         *
+         */
+        void ReleaseColumn(void* memory, size_t reservedBytes);
+
+        /**
+         * @brief Private type. A growable array of T with guaranteed alignment.
+         *
+         * The first element is aligned to COLUMN_ALIGNMENT bytes and the allocation is padded to a multiple
+         * of COLUMN_ALIGNMENT bytes, so SIMD kernels can use aligned loads from the start of the column and
+         * may read (but not write) past the last element up to the next alignment boundary.
+         *
+         * The column first reserves COLUMN_RESERVED_BYTES of address space and commits pages of it as it grows,
+         * so growing within the reservation never moves the elements: pointers to them stay valid, there is no
+         * copy, and memory is not doubled temporarily. If the reservation is exhausted or address space cannot be
+         * reserved, the column falls back to heap allocations, and growing moves all elements to a new one.
+         */
+        template <typename T>
+        class Column
+        {
+        public:
+            Column();
+            ~Column();
+
+            /**
+             * @brief Get the number of elements.
+             *
+             */
+            size_t Size() const;
+
+            /**
+             * @brief Make room for at least the given number of elements without growing again.
+             *
+             */
+            void Reserve(size_t capacity);
+
+            /**
+             * @brief Default construct or destroy elements at the end to make the column the given size.
+             *
+             */
+            void Resize(size_t size);
+
+            /**
+             * @brief Append a default constructed element.
+             *
+             * @return The new element.
+             */
+            T& EmplaceBack();
+
+            /**
+             * @brief Append the given number of elements without constructing them.
+             *
+             * The caller must construct every element in the returned range before using the column again.
+             *
+             * @return The first of the new elements.
+             */
+            T* Extend(size_t count);
+
+            /**
+             * @brief Destroy the last element.
+             *
+             */
+            void PopBack();
+
+            /**
+             * @brief Destroy all elements, keeping the memory.
+             *
+             */
+            void Clear();
+
+            /**
+             * @brief Get the last element.
+             *
+             */
+            T& Back();
+
+            /**
+             * @brief Get the first element. The pointer is aligned to COLUMN_ALIGNMENT.
+             *
+             */
+            T* Data();
+            const T* Data() const;
+
+            T& operator[](size_t index);
+            const T& operator[](size_t index) const;
+        private:
+            Column(const Column&);
+            Column& operator=(const Column&);
+
+            /**
+             * @brief Make sure there is room for the given number of elements, doubling the capacity if needed.
+             *
+             */
+            void Grow(size_t required);
+
+            /**
+             * @brief Free the memory of the elements, which must have been destroyed.
+             *
+             */
+            void Release();
+
+            T* elements;
+            size_t size;
+            size_t capacity;
+
+            /**
+             * @brief The size of the reserved range the elements live in, and how much of it is committed. Both are 0
+             * when the elements are allocated on the heap.
+             *
+             */
+            size_t reservedBytes;
+            size_t committedBytes;
+        };
+
+
+        // IMPLEMENTATION
+
+        template <typename T>
+        Column<T>::Column()
+        {
+            static_assert(COLUMN_ALIGNMENT % alignof(T) == 0, "COLUMN_ALIGNMENT must be a multiple of the component alignment");
+
+            elements = nullptr;
+            size = 0;
+            capacity = 0;
+            reservedBytes = 0;
+            committedBytes = 0;
+        }
+
+        template <typename T>
+        Column<T>::~Column()
+        {
+            for (size_t i = 0; i < size; ++i)
+                elements[i].~T();
+            Release();
+        }
+
+        template <typename T>
+        size_t Column<T>::Size() const
+        {
+            return size;
+        }
+
+        template <typename T>
+        void Column<T>::Reserve(size_t capacity)
+        {
+            if (capacity <= this->capacity)
+                return;
+
+            // Reserve address space the first time memory is needed.
+            if (elements == nullptr && COLUMN_RESERVED_BYTES >= sizeof(T))
+            {
+                elements = static_cast<T*>(ReserveColumn(static_cast<size_t>(COLUMN_RESERVED_BYTES)));
+                if (elements != nullptr)
+                    reservedBytes = static_cast<size_t>(COLUMN_RESERVED_BYTES);
+            }
+
+            // Grow in place while the reservation lasts.
+            if (reservedBytes != 0 && capacity <= reservedBytes / sizeof(T))
+            {
+                size_t committed = CommitColumn(elements, reservedBytes, committedBytes, capacity * sizeof(T));
+                if (committed != 0)
+                {
+                    committedBytes = committed;
+                    this->capacity = committed / sizeof(T);
+                    return;
+                }
+            }
+
+            T* moved = static_cast<T*>(AllocateColumn(capacity * sizeof(T)));
+            for (size_t i = 0; i < size; ++i)
+            {
+                new (moved + i) T(std::move(elements[i]));
+                elements[i].~T();
+            }
+
+            Release();
+            elements = moved;
+            this->capacity = capacity;
+        }
+
+        template <typename T>
+        void Column<T>::Resize(size_t size)
+        {
+            if (size > this->size)
+            {
+                Grow(size);
+                for (size_t i = this->size; i < size; ++i)
+                    new (elements + i) T();
+            }
+            else
+            {
+                for (size_t i = size; i < this->size; ++i)
+                    elements[i].~T();
+            }
+
+            this->size = size;
+        }
+
+        template <typename T>
+        T& Column<T>::EmplaceBack()
+        {
+            Grow(size + 1);
+            T* element = new (elements + size) T();
+            ++size;
+            return *element;
+        }
+
+        template <typename T>
+        T* Column<T>::Extend(size_t count)
+        {
+            Grow(size + count);
+            T* first = elements + size;
+            size += count;
+            return first;
+        }
+
+        template <typename T>
+        void Column<T>::PopBack()
+        {
+            assert(size > 0);
+            --size;
+            elements[size].~T();
+        }
+
+        template <typename T>
+        void Column<T>::Clear()
+        {
+            for (size_t i = 0; i < size; ++i)
+                elements[i].~T();
+            size = 0;
+        }
+
+        template <typename T>
+        T& Column<T>::Back()
+        {
+            assert(size > 0);
+            return elements[size - 1];
+        }
+
+        template <typename T>
+        T* Column<T>::Data()
+        {
+            return elements;
+        }
+
+        template <typename T>
+        const T* Column<T>::Data() const
+        {
+            return elements;
+        }
+
+        template <typename T>
+        T& Column<T>::operator[](size_t index)
+        {
+            assert(index < size);
+            return elements[index];
+        }
+
+        template <typename T>
+        const T& Column<T>::operator[](size_t index) const
+        {
+            assert(index < size);
+            return elements[index];
+        }
+
+        template <typename T>
+        void Column<T>::Grow(size_t required)
+        {
+            if (required <= capacity)
+                return;
+
+            size_t doubled = capacity * 2;
+            Reserve(required > doubled ? required : doubled);
+        }
+
+        template <typename T>
+        void Column<T>::Release()
+        {
+            if (reservedBytes != 0)
+                ReleaseColumn(elements, reservedBytes);
+            else
+                FreeColumn(elements);
+
+            reservedBytes = 0;
+            committedBytes = 0;
+        }
+    }
+}
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <cstddef>
+
 namespace ECS
 {
     template<typename T> class Component;
@@ -9,13 +11,14 @@ namespace ECS
     namespace Private
     {
         /**
-         * @brief Private type. Keeps track of type IDs and allow for component polymorphism.
+         * @brief Private type. Keeps track of type IDs.
+         *
+         * Components are stored by value in per-type pools, so this class has no virtual functions.
+         * This keeps components made of plain data trivially copyable.
          */
         class ComponentBase
         {
             template <typename T> friend class ECS::Component;
-        public:
-            virtual ~ComponentBase() {}
         protected:
             /**
              * @brief Protected constructor. Only inherited classes can be instantiated.
@@ -42,8 +45,6 @@ namespace ECS
     class Component : public Private::ComponentBase
     {
     public:
-        virtual ~Component() {}
-
         /**
          * @brief Type ID for the component. This is increased automatically for every instantiated type of the class.
          */
@@ -56,7 +57,54 @@ namespace ECS
         Component() {}
     };
 
+    /**
+     * @brief A component stored as two separate parts, so that iterating over one part does not load the other.
+     *
+     * Inherit from this class instead of Component to split a large component into the fields that are read every
+     * frame (HotPart) and the rest (ColdPart). The parts are stored in separate columns; the component type itself
+     * is only a tag and is never constructed. Add and get the component with EntityManager::AddSplitComponent and
+     * EntityManager::GetSplitComponent.
+     */
+    template <typename T, typename HotPart, typename ColdPart>
+    class SplitComponent : public Component<T>
+    {
+    public:
+        typedef HotPart Hot;
+        typedef ColdPart Cold;
+    protected:
+        /**
+         * @brief Protected constructor. Only inherited classes can be instantiated.
+         *
+         */
+        SplitComponent() {}
+    };
+
+    /**
+     * @brief A component stored in blocks of BlockWidth components, field by field (array of structures of arrays).
+     *
+     * Inherit from this class instead of Component for small components made only of fields of type ScalarType,
+     * e.g. a position of three floats. Within a block, the first field of all components comes first, then the
+     * second field and so on, so a block can be processed with SIMD instructions without gathering. Add and get
+     * the component with EntityManager::AddBlockedComponent and EntityManager::GetBlockedComponent.
+     */
+    template <typename T, typename ScalarType, size_t BlockWidth>
+    class BlockedComponent : public Component<T>
+    {
+    public:
+        typedef ScalarType Scalar;
+        static const size_t WIDTH = BlockWidth;
+    protected:
+        /**
+         * @brief Protected constructor. Only inherited classes can be instantiated.
+         *
+         */
+        BlockedComponent() {}
+    };
+
     // Increase the type ID for every template instantiation of a component.
     template <typename T>
     const ComponentType Component<T>::ID = Private::ComponentBase::nextTypeId++;
+
+    template <typename T, typename ScalarType, size_t BlockWidth>
+    const size_t BlockedComponent<T, ScalarType, BlockWidth>::WIDTH;
 }
@@ -0,0 +1,461 @@
+#pragma once
+
+#include <cassert>
+#include <cstring>
+#include <atomic>
+#include <algorithm>
+#include <vector>
+#include <type_traits>
+#include "component.h"
+#include "column.h"
+
+namespace ECS
+{
+    namespace Private
+    {
+        /**
+         * @brief Private type. Contiguous storage for all components of one type.
+         *
+         * The pool is a sparse set: a sparse array maps internal entity IDs to indices in a dense array,
+         * and the dense array maps back to internal entity IDs. The concrete pool keeps the component
+         * values in the same order as the dense array, so all components of a type are packed together.
+         *
+         * This base class keeps the type independent bookkeeping and lets the entity manager destroy
+         * and clone components without knowing their concrete type.
+         */
+        class ComponentPoolBase
+        {
+        public:
+            /**
+             * @brief Returned by IndexOf when the entity has no component in this pool.
+             *
+             */
+            static const size_t INVALID_INDEX;
+
+            virtual ~ComponentPoolBase();
+
+            /**
+             * @brief Check if the entity has a component in this pool.
+             *
+             */
+            bool Has(size_t internalId) const;
+
+            /**
+             * @brief Get the index of the entity's component in the dense array.
+             *
+             * @return The dense index or INVALID_INDEX if the entity has no component in this pool.
+             */
+            size_t IndexOf(size_t internalId) const;
+
+            /**
+             * @brief Get the number of components stored in this pool.
+             *
+             */
+            size_t Size() const;
+
+            /**
+             * @brief Get the internal entity ID stored at a dense index.
+             *
+             */
+            size_t GetInternalId(size_t index) const;
+
+            /**
+             * @brief Get a counter that changes every time components are added, removed or moved.
+             *
+             * Used to invalidate cached information about the layout of the pool.
+             */
+            size_t GetVersion() const;
+
+            /**
+             * @brief Get the number of bytes stored per component.
+             *
+             */
+            virtual size_t GetComponentSize() const = 0;
+
+            /**
+             * @brief Destroy the component associated with the entity.
+             *
+             * The last component in the pool is moved into the hole to keep the storage packed.
+             * Does nothing if the entity has no component in this pool.
+             */
+            virtual void Remove(size_t internalId) = 0;
+
+            /**
+             * @brief Copy the component of one entity onto a batch of entities.
+             *
+             * The copies are appended to the pool in one contiguous run, in the order of the targets.
+             * None of the targets may have a component in this pool already.
+             *
+             * @param sourceId The internal ID of the entity to copy from.
+             * @param targetIds The internal IDs of the entities to copy to.
+             * @param count The number of target IDs.
+             */
+            virtual void Clone(size_t sourceId, const size_t* targetIds, size_t count) = 0;
+
+            /**
+             * @brief Create an empty pool storing the same type of components as this one.
+             *
+             */
+            virtual ComponentPoolBase* CreateEmpty(size_t reservedCount) const = 0;
+
+            /**
+             * @brief Move the component of an entity to another entity in another pool of the same type.
+             *
+             * The component is destroyed in this pool. The target entity must not have a component in the target pool.
+             *
+             * @param internalId The internal ID of the entity in this pool.
+             * @param target A pool created with CreateEmpty on this pool, or on a pool of the same type.
+             * @param targetId The internal ID of the entity in the target pool.
+             */
+            virtual void Transfer(size_t internalId, ComponentPoolBase* target, size_t targetId) = 0;
+
+            /**
+             * @brief Swap the components at two dense indices, together with the entities they belong to.
+             *
+             */
+            virtual void Swap(size_t first, size_t second) = 0;
+
+            /**
+             * @brief Prepare for components to be added from several threads at once.
+             *
+             * Reserves room for the given number of components and makes sure no storage has to grow while
+             * entities with internal IDs below the limit are given components. Until EndConcurrent is called,
+             * the pool may only be modified with AddConcurrent.
+             *
+             * @param count The maximum number of components that will be added. Adding more aborts the program.
+             * @param internalIdLimit All entities given components have lower internal IDs than this.
+             */
+            virtual void BeginConcurrent(size_t count, size_t internalIdLimit);
+
+            /**
+             * @brief Make the components added since BeginConcurrent part of the pool.
+             *
+             * Must not be called while any thread is still adding components.
+             */
+            virtual void EndConcurrent();
+        protected:
+            /**
+             * @brief Protected constructor. Only inherited classes can be instantiated.
+             *
+             */
+            ComponentPoolBase();
+
+            /**
+             * @brief Associate an entity with the next free slot at the end of the dense array.
+             *
+             * @return The dense index of the new slot.
+             */
+            size_t Link(size_t internalId);
+
+            /**
+             * @brief Disassociate an entity from its slot, moving the last entity into its place.
+             *
+             * The concrete pool is responsible for moving the component value the same way.
+             */
+            void Unlink(size_t internalId);
+
+            /**
+             * @brief Associate an entity with a slot reserved by BeginConcurrent.
+             *
+             * Lock-free; every call claims a different slot, so calls for different entities may run at the same time.
+             * Aborts if the slots reserved by BeginConcurrent run out.
+             *
+             * @return The dense index of the claimed slot.
+             */
+            size_t LinkConcurrent(size_t internalId);
+
+            /**
+             * @brief Swap the entities at two dense indices.
+             *
+             * The concrete pool is responsible for swapping the component values the same way.
+             */
+            void SwapLinks(size_t first, size_t second);
+
+            /**
+             * @brief Get the number of slots claimed since BeginConcurrent.
+             *
+             */
+            size_t GetConcurrentCount() const;
+
+            /**
+             * @brief Maps internal entity IDs to indices in the dense array.
+             *
+             */
+            std::vector<size_t> sparse;
+
+            /**
+             * @brief Maps indices in the dense array to internal entity IDs.
+             *
+             */
+            std::vector<size_t> dense;
+
+            /**
+             * @brief Increased every time the dense array changes.
+             *
+             */
+            size_t version;
+
+            /**
+             * @brief The next slot to claim with LinkConcurrent, and the end of the reserved slots.
+             *
+             */
+            std::atomic<size_t> concurrentCursor;
+            size_t concurrentLimit;
+        };
+
+        /**
+         * @brief Private type. Stores the components of type T packed in a single array.
+         *
+         */
+        template <typename T>
+        class ComponentPool : public ComponentPoolBase
+        {
+        public:
+            /**
+             * @brief Constructor. Reserve memory for the given number of components.
+             *
+             */
+            ComponentPool(size_t reservedCount);
+
+            /**
+             * @brief Create a default constructed component for the entity.
+             *
+             * If the entity already has a component in this pool, it is reset to a default constructed value.
+             *
+             * @return The component. The pointer is valid until the pool is modified.
+             */
+            T* Add(size_t internalId);
+
+            /**
+             * @brief Get the component associated with the entity.
+             *
+             * @return The component or nullptr if the entity has no component in this pool.
+             */
+            T* Get(size_t internalId);
+
+            size_t GetComponentSize() const;
+            void Remove(size_t internalId);
+
+            /**
+             * @brief Copy the component of one entity onto a batch of entities.
+             *
+             * Trivially copyable types are copied with bulk memcpy, doubling the copied range every step.
+             */
+            void Clone(size_t sourceId, const size_t* targetIds, size_t count);
+
+            ComponentPoolBase* CreateEmpty(size_t reservedCount) const;
+            void Transfer(size_t internalId, ComponentPoolBase* target, size_t targetId);
+            void Swap(size_t first, size_t second);
+
+            /**
+             * @brief Add components for a batch of entities in one contiguous run, without constructing them.
+             *
+             * None of the entities may have a component in this pool already. The caller must construct every
+             * component in the returned range before using the pool again.
+             *
+             * @return The first of the new components, in the order of the entities.
+             */
+            T* Append(const size_t* internalIds, size_t count);
+
+            /**
+             * @brief Create a default constructed component for the entity from any thread.
+             *
+             * Only valid between BeginConcurrent and EndConcurrent. The entity must not have a component in this pool.
+             *
+             * @return The component. The pointer is valid until the pool is modified after EndConcurrent.
+             */
+            T* AddConcurrent(size_t internalId);
+
+            void BeginConcurrent(size_t count, size_t internalIdLimit);
+            void EndConcurrent();
+
+            /**
+             * @brief Get the packed component array. Its order matches the dense array.
+             *
+             * The array is aligned to COLUMN_ALIGNMENT bytes.
+             */
+            T* GetData();
+        private:
+            /**
+             * @brief Construct a range of components as copies of a prototype.
+             *
+             * Overloaded on whether T is trivially copyable.
+             */
+            static void Fill(T* first, size_t count, const T& prototype, std::true_type);
+            static void Fill(T* first, size_t count, const T& prototype, std::false_type);
+
+            /**
+             * @brief The component values, in the same order as the dense array.
+             *
+             */
+            Column<T> data;
+        };
+
+
+        // IMPLEMENTATION
+
+        template <typename T>
+        ComponentPool<T>::ComponentPool(size_t reservedCount)
+        {
+            sparse.reserve(reservedCount);
+            dense.reserve(reservedCount);
+            data.Reserve(reservedCount);
+        }
+
+        template <typename T>
+        T* ComponentPool<T>::Add(size_t internalId)
+        {
+            size_t index = IndexOf(internalId);
+            if (index != INVALID_INDEX)
+            {
+                data[index] = T();
+                return &data[index];
+            }
+
+            Link(internalId);
+            return &data.EmplaceBack();
+        }
+
+        template <typename T>
+        T* ComponentPool<T>::Get(size_t internalId)
+        {
+            size_t index = IndexOf(internalId);
+            if (index == INVALID_INDEX)
+                return nullptr;
+
+            return &data[index];
+        }
+
+        template <typename T>
+        size_t ComponentPool<T>::GetComponentSize() const
+        {
+            return sizeof(T);
+        }
+
+        template <typename T>
+        void ComponentPool<T>::Remove(size_t internalId)
+        {
+            size_t index = IndexOf(internalId);
+            if (index == INVALID_INDEX)
+                return;
+
+            if (index != data.Size() - 1)
+                data[index] = std::move(data.Back());
+            data.PopBack();
+            Unlink(internalId);
+        }
+
+        template <typename T>
+        void ComponentPool<T>::Clone(size_t sourceId, const size_t* targetIds, size_t count)
+        {
+            size_t sourceIndex = IndexOf(sourceId);
+            assert(sourceIndex != INVALID_INDEX);
+
+            if (count == 0)
+                return;
+
+            // Copy the prototype out first, since growing the array may move it.
+            const T prototype = data[sourceIndex];
+
+            T* first = data.Extend(count);
+            Fill(first, count, prototype, std::integral_constant<bool, std::is_trivially_copyable<T>::value>());
+
+            for (size_t i = 0; i < count; ++i)
+            {
+                assert(!Has(targetIds[i]));
+                Link(targetIds[i]);
+            }
+        }
+
+        template <typename T>
+        ComponentPoolBase* ComponentPool<T>::CreateEmpty(size_t reservedCount) const
+        {
+            return new ComponentPool<T>(reservedCount);
+        }
+
+        template <typename T>
+        void ComponentPool<T>::Transfer(size_t internalId, ComponentPoolBase* target, size_t targetId)
+        {
+            size_t index = IndexOf(internalId);
+            assert(index != INVALID_INDEX);
+
+            ComponentPool<T>* targetPool = static_cast<ComponentPool<T>*>(target);
+            assert(!targetPool->Has(targetId));
+
+            targetPool->Link(targetId);
+            new (targetPool->data.Extend(1)) T(std::move(data[index]));
+            Remove(internalId);
+        }
+
+        template <typename T>
+        void ComponentPool<T>::Swap(size_t first, size_t second)
+        {
+            if (first == second)
+                return;
+
+            std::swap(data[first], data[second]);
+            SwapLinks(first, second);
+        }
+
+        template <typename T>
+        T* ComponentPool<T>::Append(const size_t* internalIds, size_t count)
+        {
+            for (size_t i = 0; i < count; ++i)
+            {
+                assert(!Has(internalIds[i]));
+                Link(internalIds[i]);
+            }
+
+            return data.Extend(count);
+        }
+
+        template <typename T>
+        T* ComponentPool<T>::AddConcurrent(size_t internalId)
+        {
+            size_t index = LinkConcurrent(internalId);
+            return new (data.Data() + index) T();
+        }
+
+        template <typename T>
+        void ComponentPool<T>::BeginConcurrent(size_t count, size_t internalIdLimit)
+        {
+            ComponentPoolBase::BeginConcurrent(count, internalIdLimit);
+            data.Reserve(data.Size() + count);
+        }
+
+        template <typename T>
+        void ComponentPool<T>::EndConcurrent()
+        {
+            // The claimed slots have already been constructed by AddConcurrent.
+            data.Extend(GetConcurrentCount() - data.Size());
+            ComponentPoolBase::EndConcurrent();
+        }
+
+        template <typename T>
+        T* ComponentPool<T>::GetData()
+        {
+            return data.Data();
+        }
+
+        template <typename T>
+        void ComponentPool<T>::Fill(T* first, size_t count, const T& prototype, std::true_type)
+        {
+            std::memcpy(first, &prototype, sizeof(T));
+
+            size_t filled = 1;
+            while (filled < count)
+            {
+                size_t step = std::min(filled, count - filled);
+                std::memcpy(first + filled, first, step * sizeof(T));
+                filled += step;
+            }
+        }
+
+        template <typename T>
+        void ComponentPool<T>::Fill(T* first, size_t count, const T& prototype, std::false_type)
+        {
+            for (size_t i = 0; i < count; ++i)
+                new (first + i) T(prototype);
+        }
+    }
+}
@@ -7,4 +7,9 @@ namespace ECS
 
     const int MAX_COMPONENTS = 32;
     const int RESERVED_ENTITY_COUNT = 1024;
+    const int COLUMN_ALIGNMENT = 64;
+    const int QUERY_EVICTION_AGE = 64;
+    const int RESERVED_EVENT_COUNT = 256;
+    const unsigned long long COLUMN_RESERVED_BYTES = 1073741824ULL;
+    const int COLUMN_HUGE_PAGES = 1;
 }
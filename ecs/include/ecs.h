@@ -3,3 +3,19 @@
 #include "entity.h"
 #include "component.h"
 #include "entitymanager.h"
+#include "entityref.h"
+#include "system.h"
+#include "systemmanager.h"
+#include "reactivesystem.h"
+#include "batchsystem.h"
+#include "pipeline.h"
+#include "spawncontext.h"
+#include "shardedworld.h"
+#include "event.h"
+#include "eventbus.h"
+#include "spatialgrid.h"
+#include "buffer.h"
+#include "profiler.h"
+#include "trace.h"
+#include "replay.h"
+#include "cellstreamer.h"
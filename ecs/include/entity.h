@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstdint>
 #include <bitset>
 #include "config.h"
 
@@ -13,15 +14,54 @@ namespace ECS
      */
     typedef uint64_t Entity;
 
+    /**
+     * @brief An entity value that never refers to an entity.
+     *
+     */
+    const Entity INVALID_ENTITY = static_cast<Entity>(-1);
+
     namespace Private
     {
         struct InternalEntity
         {
+            /**
+             * @brief The UUID of the entity currently using this internal ID.
+             *
+             */
+            Entity entity;
+
             /**
              * @brief Defines what components are associated with this entity.
              *
              */
             std::bitset<MAX_COMPONENTS> flags;
+
+            /**
+             * @brief True if the entity is a prefab, a template that is never matched against systems.
+             *
+             */
+            bool prefab;
+
+            /**
+             * @brief False if the entity has been disabled and should not be processed by systems.
+             *
+             */
+            bool enabled;
+
+            /**
+             * @brief True if the entity has been removed and is waiting to be destroyed.
+             *
+             */
+            bool removed;
+
+            /**
+             * @brief Defines what components associated with this entity are disabled.
+             *
+             * Systems treat disabled components as if the entity did not have them.
+             */
+            std::bitset<MAX_COMPONENTS> disabled;
+
+            InternalEntity() : entity(INVALID_ENTITY), prefab(false), enabled(true), removed(false) {}
         };
     }
 }
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <cassert>
+#include <atomic>
 #include <vector>
 #include <map>
 #include <set>
@@ -8,16 +9,43 @@
 #include "config.h"
 #include "entity.h"
 #include "component.h"
+#include "componentpool.h"
+#include "sharedcomponentpool.h"
+#include "splitcomponentpool.h"
+#include "blockedcomponentpool.h"
 #include "entityobserver.h"
+#include "querycache.h"
+#include "snapshot.h"
+#include "indexregistry.h"
+#include "entityref.h"
+#include "hierarchy.h"
+#include "profiler.h"
+#include "trace.h"
 
 namespace ECS
 {
+    class SpawnContext;
+    class ShardedWorld;
+    class CellStreamer;
+
+    namespace Private
+    {
+        struct StagedCell;
+    }
+
     /**
      * @brief Manages all entities and components in the world.
      *
      */
     class EntityManager
     {
+        friend class SystemManager;
+        friend class SpawnContext;
+        friend class ShardedWorld;
+        friend class CellStreamer;
+        friend class Private::IndexRegistry;
+        template <typename... Ts> friend class BatchSystem;
+        template <typename... Stages> friend class Pipeline;
     public:
         /**
          * @brief Constructor. Set default values and reserve memory.
@@ -40,6 +68,40 @@ namespace ECS
          */
         Entity CreateEntity();
 
+        /**
+         * @brief Creates a prefab without components.
+         *
+         * A prefab is a template entity. Components are added to it as usual, but it is not part of
+         * the active entities, it is never processed by systems and observers are not notified about it.
+         * Use Instantiate to create entities from it, and RemoveEntity to get rid of it.
+         *
+         * @return The created prefab.
+         */
+        Entity CreatePrefab();
+
+        /**
+         * @brief Check if an entity is a prefab.
+         *
+         * @return True if the entity was created with CreatePrefab.
+         */
+        bool IsPrefab(Entity entity) const;
+
+        /**
+         * @brief Creates a batch of entities with copies of all components on a prefab.
+         *
+         * The components are cloned one type at a time, so the copies of each type end up next to each
+         * other in storage. Observers are notified once per created entity with EntityCreated followed by
+         * a single ComponentsAdded, instead of once per component.
+         *
+         * Components that have been removed from the prefab (but not destroyed yet) are not copied. Components that are
+         * disabled on the prefab are disabled on the instances as well.
+         *
+         * @param prefab The prefab to copy.
+         * @param count The number of entities to create.
+         * @return The created entities.
+         */
+        std::vector<Entity> Instantiate(Entity prefab, size_t count);
+
         /**
          * @brief Marks an entity and its components for removal and removes it from all systems.
          *
@@ -47,9 +109,17 @@ namespace ECS
          * recycle or remove its components however; this will be done after the current system is finished
          * processing.
          *
+         * The children of the entity, and their children, are removed as well. Removing an entity that has already
+         * been removed but not destroyed yet does nothing.
          */
         void RemoveEntity(Entity entity);
 
+        /**
+         * @brief Marks a batch of entities and their components for removal, like RemoveEntity.
+         *
+         */
+        void RemoveEntities(const std::vector<Entity>& entities);
+
         /**
          * @brief Check if an entity has been removed or destroyed.
          *
@@ -66,6 +136,22 @@ namespace ECS
          */
         bool IsDestroyed(Entity entity);
 
+        /**
+         * @brief Enable or disable an entity.
+         *
+         * Disabled entities keep their components but are not processed by systems. Disabling an entity does not
+         * change what systems it matches; it is only moved to the disabled part of their processing lists, so
+         * toggling it is cheap. Entities are enabled when created.
+         *
+         */
+        void SetEnabled(Entity entity, bool enabled);
+
+        /**
+         * @brief Check if an entity is enabled.
+         *
+         */
+        bool IsEnabled(Entity entity) const;
+
         /**
          * @brief Get the entities that have been created but not removed.
          *
@@ -88,7 +174,9 @@ namespace ECS
         /**
          * @brief Create a component and add it to the entity.
          *
-         * Template type T is the concrete type of the component.
+         * Template type T is the concrete type of the component. Components of the same type are stored
+         * next to each other, so the returned pointer is only valid until another component of type T
+         * is added or destroyed.
          *
          * @return The created component.
          */
@@ -103,6 +191,110 @@ namespace ECS
         template <typename T>
         T* GetComponent(Entity entity);
 
+        /**
+         * @brief Make the entity reference a shared component of type T equal to the given value.
+         *
+         * Shared components are stored once per distinct value and referenced by every entity having that value,
+         * which saves memory for large components that many entities have in common. Values are compared with
+         * operator<, which T must provide. If the entity already has a shared component of type T, it is changed
+         * to the new value.
+         *
+         * A component type is either always shared or never shared. Shared components are read-only; to change the
+         * value of one entity, add the component again with the new value. They are removed with RemoveComponent
+         * and checked for with HasComponent like other components.
+         *
+         * @return The shared value. The pointer is valid as long as any entity references the value.
+         */
+        template <typename T>
+        const T* AddSharedComponent(Entity entity, const T& value);
+
+        /**
+         * @brief Get the shared component of type T on entity.
+         *
+         * @return The shared value or nullptr if no component of type T exists on the entity.
+         */
+        template <typename T>
+        const T* GetSharedComponent(Entity entity);
+
+        /**
+         * @brief Get the number of distinct values of shared component type T.
+         *
+         */
+        template <typename T>
+        size_t GetSharedValueCount();
+
+        /**
+         * @brief Call a function for every distinct value of shared component type T and the entities sharing it.
+         *
+         * The function is called as function(const T& value, const std::vector<Entity>& entities), once per value.
+         * Entities whose component has been removed but not destroyed yet are included. The entity manager must
+         * not be modified from the function.
+         */
+        template <typename T, typename Function>
+        void ForEachSharedGroup(Function function);
+
+        /**
+         * @brief Create a split component of type T with default constructed parts for the entity.
+         *
+         * T must inherit from SplitComponent. Its hot and cold parts are stored in separate columns, so systems that
+         * only touch the hot part do not load the cold part into the cache. If the entity already has a component of
+         * type T, its parts are reset. Split components are removed with RemoveComponent and checked for with
+         * HasComponent like other components, but cannot be owned by groups, indexed or spawned concurrently.
+         *
+         * @return The parts of the component. The pointers are valid until the pool is modified.
+         */
+        template <typename T>
+        SplitView<T> AddSplitComponent(Entity entity);
+
+        /**
+         * @brief Get the split component of type T on entity.
+         *
+         * @return The parts of the component, or a null view if no component of type T exists on the entity.
+         */
+        template <typename T>
+        SplitView<T> GetSplitComponent(Entity entity);
+
+        /**
+         * @brief Call a function with the packed parts of all split components of type T.
+         *
+         * The function is called once as function(size_t count, T::Hot* hot, T::Cold* cold), where both pointers
+         * point to count parts in the same order. Prefabs and components that have been removed but not destroyed
+         * yet are included. Components must not be added or removed from the function.
+         */
+        template <typename T, typename Function>
+        void ProcessSplitComponents(Function function);
+
+        /**
+         * @brief Set the blocked component of type T on the entity to a value, adding it if the entity has none.
+         *
+         * T must inherit from BlockedComponent, be trivially copyable and have only fields of type T::Scalar. The
+         * components are stored in blocks of T::WIDTH field by field, so kernels can process a whole block of a
+         * field at once. Blocked components are removed with RemoveComponent and checked for with HasComponent like
+         * other components, but cannot be owned by groups, indexed or spawned concurrently.
+         *
+         * @return A view of the component. It is valid until the pool is modified.
+         */
+        template <typename T>
+        BlockedView<T> AddBlockedComponent(Entity entity, const T& value = T());
+
+        /**
+         * @brief Get the blocked component of type T on entity.
+         *
+         * @return A view of the component, or a null view if no component of type T exists on the entity.
+         */
+        template <typename T>
+        BlockedView<T> GetBlockedComponent(Entity entity);
+
+        /**
+         * @brief Call a function for every block of blocked components of type T.
+         *
+         * The function is called as function(size_t count, T::Scalar* block), where the first count lanes of the
+         * block are in use. Field i of lane j is block[i * T::WIDTH + j]. Prefabs and components that have been
+         * removed but not destroyed yet are included. Components must not be added or removed from the function.
+         */
+        template <typename T, typename Function>
+        void ForEachBlock(Function function);
+
         /**
          * @brief Mark a component for removal and remove its flag from the entity.
          *
@@ -126,6 +318,24 @@ namespace ECS
         template <typename T>
         bool HasComponent(Entity entity) const;
 
+        /**
+         * @brief Enable or disable a component on the entity.
+         *
+         * Systems treat a disabled component as if the entity did not have it, but the component stays in
+         * storage and can still be accessed with GetComponent. The entity must have the component. Components
+         * are enabled when added.
+         *
+         */
+        template <typename T>
+        void SetComponentEnabled(Entity entity, bool enabled);
+
+        /**
+         * @brief Check if the entity has an enabled component of type T.
+         *
+         */
+        template <typename T>
+        bool IsComponentEnabled(Entity entity) const;
+
         /**
          * @brief Check if the entity has a component that is removed (but not destroyed yet).
          *
@@ -138,194 +348,1166 @@ namespace ECS
         bool IsComponentRemoved(Entity entity) const;
 
         /**
-         * @brief This will destroy all removed entities and components.
+         * @brief Get the active entities having all components in a mask.
          *
-         * This is called on automatically whenever a system has finished processing.
+         * Results are cached by mask and kept up to date as entities and components are added and removed, so
+         * asking for the same mask again only costs a hash lookup. A result that has not been asked for during
+         * QUERY_EVICTION_AGE calls to DestroyRemoved is evicted. Disabled entities and components are included,
+         * like in GetEntityFlag.
+         *
+         * @return The entities, in no particular order. The reference is valid until the next call to DestroyRemoved.
          */
-        void DestroyRemoved();
+        const std::vector<Entity>& Query(const std::bitset<MAX_COMPONENTS>& mask);
 
+        /**
+         * @brief Get the active entities having all the components Ts.
+         *
+         * @see Query
+         */
+        template <typename... Ts>
+        const std::vector<Entity>& Query();
 
         /**
-         * @brief Add an entity observer.
+         * @brief Index the entities with components of type T by the value of a field, using a hash map.
+         *
+         * The index is kept up to date as components are added and removed. Writing to a component does not update
+         * it; call NotifyComponentChanged after changing an indexed field, including right after AddComponent. F must
+         * be hashable with std::hash and comparable with operator==. Prefabs are not indexed.
          *
+         * @param field The indexed field, e.g. &Position::cell.
          */
-        void AddEntityObserver(EntityObserver* observer);
+        template <typename T, typename F>
+        void CreateHashIndex(F T::* field);
 
+        /**
+         * @brief Index the entities with components of type T by the value of a field, using an ordered map.
+         *
+         * Works like CreateHashIndex, but supports range queries with FindInRange. F must be comparable with
+         * operator< and operator==.
+         */
+        template <typename T, typename F>
+        void CreateOrderedIndex(F T::* field);
 
         /**
-         * @brief Remove an entity observer. This should be done if an added observer is deleted.
+         * @brief Get the entities whose component of type T has the given value in an indexed field.
+         *
+         * Uses the hash index on the field if there is one, otherwise the ordered index.
          *
+         * @return The entities, in no particular order. The reference is valid until the index changes.
          */
-        void RemoveEntityObserver(EntityObserver* observer);
+        template <typename T, typename F>
+        const std::vector<Entity>& FindByField(F T::* field, const F& value);
 
+        /**
+         * @brief Append the entities whose component of type T has a value in the range [low, high] in an indexed
+         * field to a list. The field must have an ordered index.
+         *
+         */
+        template <typename T, typename F>
+        void FindInRange(F T::* field, const F& low, const F& high, std::vector<Entity>& result);
 
         /**
-         * @brief See if an entity observer is added to this entity manager.
+         * @brief Track the entity references in a field of component type T.
+         *
+         * When an entity is destroyed by DestroyRemoved, every tracked reference to it is nulled and the observers
+         * are told that the components holding them have changed, after the destruction. Like field indexes, the
+         * index does not see writes to the field; set references with SetReference, or call NotifyComponentChanged
+         * after writing the field. Prefabs are not tracked, but their instances are.
          *
+         * @param field The reference field, e.g. &Turret::target.
          */
-        bool IsObserving(EntityObserver* observer);
-    private:
+        template <typename T>
+        void CreateReferenceIndex(EntityRef T::* field);
+
         /**
-         * @brief References a specific component in the component table.
+         * @brief Make a field of the entity's component of type T refer to another entity, or to nothing with INVALID_ENTITY.
          *
+         * Creates the reference index on the field if there is none, and tells the observers that the component has changed.
          */
-        struct ComponentReference
-        {
-            size_t internalEntityId;
-            ComponentType componentType;
+        template <typename T>
+        void SetReference(Entity entity, EntityRef T::* field, Entity target);
 
-            ComponentReference(size_t internalEntityId, ComponentType componentType);
-            bool operator==(const ComponentReference& rhs) const;
-        };
+        /**
+         * @brief Get the entities whose component of type T refers to the target in a tracked field.
+         *
+         * @return The entities, in no particular order. The reference is valid until the index changes.
+         */
+        template <typename T>
+        const std::vector<Entity>& FindReferences(EntityRef T::* field, Entity target);
 
         /**
-         * @brief Default bitset, used as return value for component flags.
+         * @brief Tell the observers that the component of type T on the entity has been changed.
          *
-         * Used as return value for non-existant entities to be precise.
+         * Updates the field indexes on T.
          */
-        static const std::bitset<MAX_COMPONENTS> ZERO_BITSET;
+        template <typename T>
+        void NotifyComponentChanged(Entity entity);
 
         /**
-         * @brief Maps an Entity UUID to an internal entity ID.
+         * @brief Keep the storage of some component types sorted for fast iteration over entities having all of them.
          *
+         * The group owns the storage of the given types: the entities having all of them (the group members) are
+         * packed at the front of every owned pool, in the same order. The ordering is maintained whenever components
+         * are added or removed, so ProcessGroup can walk the owned arrays in parallel without looking anything up, and
+         * batch systems over the owned types see the members as a single run.
+         *
+         * A component type can be owned by one group only. Shared components cannot be owned. Prefabs are never
+         * members. Disabled entities and components do not affect membership.
          */
-        std::map<Entity, size_t> translator;
+        template <typename... Ts>
+        void CreateGroup();
 
         /**
-         * @brief A vector of all the active entities.
+         * @brief Call a function with the packed components of the members of a group.
          *
-         * The indices in this vector will be recycled whenever an entity is
-         * removed.
+         * The function is called once as function(size_t count, Ts*... components), where every pointer points to
+         * the count components of the members, in the same order for all types. The types must all be owned by the
+         * same group, but do not have to be all of its types. Components must not be added or removed from the
+         * function.
          */
-        std::vector<Private::InternalEntity> entities;
+        template <typename... Ts, typename Function>
+        void ProcessGroup(Function function);
 
         /**
-         * @brief A list of all entities that have been created and not removed.
+         * @brief Make an entity the child of another entity, or a root with INVALID_ENTITY.
          *
-         * This is kept mostly for convenience as it repeats the information that the
-         * translator and entities list provides.
+         * The parent must not be the entity itself or one of its descendants. Removing an entity removes all of
+         * its descendants. Prefabs should not be part of the hierarchy, and migrated entities lose their relationships.
          */
-        std::set<Entity> activeEntities;
+        void SetParent(Entity child, Entity parent);
 
         /**
-         * @brief Maps the tuple (component type, internal entity id) to a component.
+         * @brief Get the parent of an entity, or INVALID_ENTITY if it has none.
          *
          */
-        std::vector<Private::ComponentBase*> components[MAX_COMPONENTS];
+        Entity GetParent(Entity entity) const;
 
         /**
-         * @brief Contains recycled internal entity IDs.
+         * @brief Get the children of an entity, in the order they were added.
          *
-         * When creating a new entity, these IDs will be preferred.
          */
-        std::vector<size_t> recycledIds;
+        std::vector<Entity> GetChildren(Entity entity) const;
 
         /**
-         * @brief Keeps track of all entities to destroy.
+         * @brief Call a function for the components of type T of the hierarchy, parents before children.
          *
-         * Removed entities are destroyed every time a system finishes processing.
-         * Stores external UUIDs (since it needs to change the translator when destroying).
+         * The function is called as function(T& component, const T* parent) for every entity with a parent or
+         * children that has a component of type T, where parent is the component of the entity's parent, or nullptr
+         * if the entity is a root or its parent has no such component. Since every parent is visited before its
+         * children, world transforms can be propagated in a single call.
          *
+         * The pool of T is sorted in breadth-first order of the hierarchy, so the components are visited in one
+         * linear pass. The pool is only sorted again after the hierarchy or the pool changed. T must not be owned
+         * by a group. Components must not be added or removed from the function.
          */
-        std::vector<Entity> entitiesToDestroy;
+        template <typename T, typename Function>
+        void ProcessHierarchy(Function function);
 
         /**
-         * @brief Keeps track of all components to destroy.
+         * @brief This will destroy all removed entities and components.
          *
-         * This vector holds tuples on the form (internalEntityId, componentType). This pair
-         * can be used to find the component in the array.
+         * This is called on automatically whenever a system has finished processing.
+         */
+        void DestroyRemoved();
+
+        /**
+         * @brief Measure every call to DestroyRemoved with a profiler, or stop measuring with nullptr.
          *
-         * Removed components are destroyed every time a system finishes processing.
+         * The calls are recorded with the entity manager as the section. The profiler must outlive the entity manager.
          */
-        std::vector<ComponentReference> componentsToDestroy;
+        void SetProfiler(Profiler* profiler);
 
         /**
-         * @brief The UUID that will be given to the next entity.
+         * @brief Record CreateEntity, RemoveEntity, AddComponent, RemoveComponent and DestroyRemoved calls to a trace,
+         * or stop recording with nullptr.
          *
+         * Every other way of creating entities and adding components is recorded as those calls as well: prefabs,
+         * instances, entities spawned concurrently or streamed in, and shared, split and blocked components. Entities
+         * migrated away are recorded as removed, and migrated entities are recorded as created in the target. The
+         * recorder must outlive the entity manager, or be removed first.
          */
-        Entity nextUUID;
+        void SetRecorder(TraceRecorder* recorder);
 
         /**
-         * @brief The internal ID that will be given to the next entity if it cannot be recycled.
+         * @brief Start creating entities from several threads at once.
          *
+         * Prepares room for the given number of entities and creates one SpawnContext per worker thread. Until
+         * EndConcurrentSpawning is called, entities may only be created through the contexts, and the entity
+         * manager must not be used otherwise, except to call ReserveConcurrentComponents before the workers start.
+         *
+         * @param entityCount The maximum number of entities the contexts will create in total. Creating more aborts the
+         * program, in release builds too.
+         * @param contextCount The number of contexts to create.
          */
-        size_t nextInternalId;
+        void BeginConcurrentSpawning(size_t entityCount, size_t contextCount);
 
         /**
-         * @brief A list of observers that want notifications about changed entities and components.
+         * @brief Reserve room for components of type T to be added through spawn contexts.
+         *
+         * Must be called on the spawning thread after BeginConcurrentSpawning and before the workers start. Shared
+         * components cannot be added concurrently.
          *
+         * @param count The maximum number of components of type T the contexts will add in total.
          */
-        std::set<EntityObserver*> observers;
-    };
+        template <typename T>
+        void ReserveConcurrentComponents(size_t count);
 
+        /**
+         * @brief Get one of the contexts created by BeginConcurrentSpawning.
+         *
+         * Every context must only be used by one thread at a time.
+         */
+        SpawnContext* GetSpawnContext(size_t index);
 
-    // IMPLEMENTATION
+        /**
+         * @brief Stop creating entities concurrently and make the created entities visible.
+         *
+         * Must be called after all worker threads are done with their contexts, which are destroyed. Observers are
+         * notified once per created entity with EntityCreated followed by a single ComponentsAdded.
+         */
+        void EndConcurrentSpawning();
 
-    template <typename T>
-    T* EntityManager::AddComponent(Entity entity)
-    {
-        // TODO: Use a provided allocator instead of using new.
 
-        // Find the internal ID of the entity.
-        auto it = translator.find(entity);
-        assert(it != translator.end());assert(it != translator.end());
+        /**
+         * @brief Create a reader for snapshots of all components of type T.
+         *
+         * Snapshots are opt-in: only types with readers are copied by PublishSnapshots. Every reader belongs to one
+         * reader thread. Readers are owned by the entity manager and live as long as it does. Shared, split and
+         * blocked components cannot be snapshotted.
+         *
+         * @return The reader. It may be handed to another thread.
+         */
+        template <typename T>
+        SnapshotReader<T>* CreateSnapshotReader();
 
-        size_t internalId = it->second;
-        assert(internalId < entities.size());
-        assert(internalId < components[Component<T>::ID].size());
+        /**
+         * @brief Destroy all removed entities and components, then publish a snapshot to every snapshot reader.
+         *
+         * Call this at a frame boundary. The readers see the new snapshots the next time they read, while the
+         * entity manager is free to change the components again right away.
+         */
+        void PublishSnapshots();
 
-        // Create the new component.
-        T* component = new T;
-        components[Component<T>::ID][internalId] = component;
-        entities[internalId].flags.set(Component<T>::ID, true);
+        /**
+         * @brief Add an entity observer.
+         *
+         */
+        void AddEntityObserver(EntityObserver* observer);
 
-        for (auto observer : observers)
-            observer->ComponentAdded(entity, Component<T>::ID);
 
-        return component;
-    }
+        /**
+         * @brief Remove an entity observer. This should be done if an added observer is deleted.
+         *
+         */
+        void RemoveEntityObserver(EntityObserver* observer);
 
-    template <typename T>
-    T* EntityManager::GetComponent(Entity entity)
-    {
-        auto it = translator.find(entity);
-        assert(it != translator.end());
 
-        size_t internalId = it->second;
-        assert(internalId < entities.size());
-        assert(internalId < components[Component<T>::ID].size());
+        /**
+         * @brief See if an entity observer is added to this entity manager.
+         *
+         */
+        bool IsObserving(EntityObserver* observer);
+    private:
+        /**
+         * @brief Get the internal ID of an existing entity.
+         *
+         */
+        size_t GetInternalId(Entity entity) const;
 
-        return static_cast<T*>( components[Component<T>::ID][translator[entity]] );
-    }
+        /**
+         * @brief Get the internal ID for a new entity, recycling one if possible.
+         *
+         */
+        size_t AllocateInternalId(Entity entity);
 
-    template <typename T>
-    void EntityManager::RemoveComponent(Entity entity)
-    {
-        auto it = translator.find(entity);
-        assert(it != translator.end());
+        /**
+         * @brief Take the next UUID. Lock-free.
+         *
+         */
+        Entity NextUUID();
 
-        size_t internalId = it->second;
-        assert(internalId < entities.size());
-        assert(internalId < components[Component<T>::ID].size());
+        /**
+         * @brief Move entities and all their components to another entity manager, keeping their UUIDs.
+         *
+         * The entities are gone from this entity manager at once instead of being destroyed later. Observers of
+         * this entity manager see them removed, and observers of the target see them created.
+         */
+        void MigrateEntities(const std::vector<Entity>& migrated, EntityManager* target);
 
-        componentsToDestroy.push_back(ComponentReference(internalId, Component<T>::ID));
-        entities[internalId].flags.set(Component<T>::ID, false);
+        /**
+         * @brief Move an entity into or out of the groups, given the components it has.
+         *
+         * Pass an empty bitset to take the entity out of all groups.
+         */
+        void UpdateGroups(size_t internalId, const std::bitset<MAX_COMPONENTS>& flags);
 
-        for (auto observer : observers)
-            observer->ComponentRemoved(entity, Component<T>::ID);
-    }
+        /**
+         * @brief Get the group owning all the given types.
+         *
+         */
+        template <typename... Ts>
+        size_t FindGroup() const;
 
-    template <typename T>
-    bool EntityManager::HasComponent(Entity entity) const
+        /**
+         * @brief Get the index of type I on a field, or nullptr if there is none.
+         *
+         */
+        template <typename I, typename T, typename F>
+        I* FindIndex(F T::* field);
+
+        /**
+         * @brief Get the index registry, creating it if needed.
+         *
+         */
+        Private::IndexRegistry* GetIndexRegistry();
+
+        /**
+         * @brief Claim internal IDs for a spawn context, preferring recycled ones. Lock-free.
+         *
+         * Aborts if the IDs reserved by BeginConcurrentSpawning run out.
+         */
+        void ClaimInternalIds(std::vector<size_t>& internalIds, size_t count);
+
+        /**
+         * @brief Create the entities of a staged cell with their components in one batch.
+         *
+         * The components of every type are appended to their pool in one run. Observers are notified after all
+         * entities are in place, once per entity with all of its components.
+         *
+         * @param cell The staged cell.
+         * @param created The created entities are appended to this, in the order of the cell.
+         */
+        void CommitCell(const Private::StagedCell& cell, std::vector<Entity>& created);
+
+        /**
+         * @brief Get the pool storing components of type T, creating it if needed.
+         *
+         */
+        template <typename T>
+        Private::ComponentPool<T>* GetPool();
+
+        /**
+         * @brief Get the pool storing shared components of type T, creating it if needed.
+         *
+         */
+        template <typename T>
+        Private::SharedComponentPool<T>* GetSharedPool();
+
+        /**
+         * @brief Get the pool storing split components of type T, creating it if needed.
+         *
+         */
+        template <typename T>
+        Private::SplitComponentPool<T>* GetSplitPool();
+
+        /**
+         * @brief Get the pool storing blocked components of type T, creating it if needed.
+         *
+         */
+        template <typename T>
+        Private::BlockedComponentPool<T>* GetBlockedPool();
+
+        /**
+         * @brief Record the creation of an entity that already has components, as CreateEntity and AddComponent calls.
+         *
+         */
+        void RecordCreated(Entity entity, size_t internalId);
+
+        /**
+         * @brief Returned by FindGroup and stored in groupOwners for types not owned by a group.
+         *
+         */
+        static const size_t NO_GROUP;
+
+        /**
+         * @brief A set of component types whose storage is sorted by group membership.
+         *
+         */
+        struct Group
+        {
+            /**
+             * @brief The owned component types.
+             *
+             */
+            std::bitset<MAX_COMPONENTS> types;
+
+            /**
+             * @brief The number of members, packed at the front of every owned pool.
+             *
+             */
+            size_t size;
+        };
+
+        /**
+         * @brief References a specific component in the component table.
+         *
+         */
+        struct ComponentReference
+        {
+            size_t internalEntityId;
+            ComponentType componentType;
+
+            ComponentReference(size_t internalEntityId, ComponentType componentType);
+            bool operator==(const ComponentReference& rhs) const;
+        };
+
+        /**
+         * @brief Default bitset, used as return value for component flags.
+         *
+         * Used as return value for non-existant entities to be precise.
+         */
+        static const std::bitset<MAX_COMPONENTS> ZERO_BITSET;
+
+        /**
+         * @brief Maps an Entity UUID to an internal entity ID.
+         *
+         */
+        std::map<Entity, size_t> translator;
+
+        /**
+         * @brief A vector of all the active entities.
+         *
+         * The indices in this vector will be recycled whenever an entity is
+         * removed. It is a column, so growing it during spawn spikes does not move the entities.
+         */
+        Private::Column<Private::InternalEntity> entities;
+
+        /**
+         * @brief A list of all entities that have been created and not removed.
+         *
+         * This is kept mostly for convenience as it repeats the information that the
+         * translator and entities list provides.
+         */
+        std::set<Entity> activeEntities;
+
+        /**
+         * @brief One pool per component type, indexed by component type ID.
+         *
+         * Pools are created the first time a component of their type is added, so unused types are null.
+         */
+        Private::ComponentPoolBase* pools[MAX_COMPONENTS];
+
+        /**
+         * @brief The component types stored in shared pools.
+         *
+         */
+        std::bitset<MAX_COMPONENTS> sharedTypes;
+
+        /**
+         * @brief The component types stored in split or blocked pools.
+         *
+         */
+        std::bitset<MAX_COMPONENTS> layoutTypes;
+
+        /**
+         * @brief The cached query results. Created by the first query.
+         *
+         */
+        Private::QueryCache* queryCache;
+
+        /**
+         * @brief The field indexes. Created by the first index.
+         *
+         */
+        Private::IndexRegistry* indexRegistry;
+
+        /**
+         * @brief The parent/child relationships. Created by the first call to SetParent.
+         *
+         */
+        Private::Hierarchy* hierarchy;
+
+        /**
+         * @brief The snapshot readers and the component type each reads.
+         *
+         */
+        std::vector<std::pair<ComponentType, Private::SnapshotPublisherBase*>> snapshotReaders;
+
+        /**
+         * @brief The number of the last published snapshot frame.
+         *
+         */
+        size_t snapshotFrame;
+
+        /**
+         * @brief Measures DestroyRemoved, or nullptr.
+         *
+         */
+        Profiler* profiler;
+
+        /**
+         * @brief Records the calls made on the entity manager, or nullptr.
+         *
+         */
+        TraceRecorder* recorder;
+
+        /**
+         * @brief The groups created with CreateGroup.
+         *
+         */
+        std::vector<Group> groups;
+
+        /**
+         * @brief The index of the group owning each component type, or NO_GROUP.
+         *
+         */
+        size_t groupOwners[MAX_COMPONENTS];
+
+        /**
+         * @brief Scratch list of entities handed to ForEachSharedGroup. Kept to reuse its memory.
+         *
+         */
+        std::vector<Entity> sharedGroup;
+
+        /**
+         * @brief How many components new pools reserve memory for.
+         *
+         */
+        size_t reservedEntityCount;
+
+        /**
+         * @brief Contains recycled internal entity IDs.
+         *
+         * When creating a new entity, these IDs will be preferred.
+         */
+        std::vector<size_t> recycledIds;
+
+        /**
+         * @brief Keeps track of all entities to destroy.
+         *
+         * Removed entities are destroyed every time a system finishes processing.
+         * Stores external UUIDs (since it needs to change the translator when destroying).
+         *
+         */
+        std::vector<Entity> entitiesToDestroy;
+
+        /**
+         * @brief Keeps track of all components to destroy.
+         *
+         * This vector holds tuples on the form (internalEntityId, componentType). This pair
+         * can be used to find the component in the array.
+         *
+         * Removed components are destroyed every time a system finishes processing.
+         */
+        std::vector<ComponentReference> componentsToDestroy;
+
+        /**
+         * @brief The UUID that will be given to the next entity.
+         *
+         */
+        std::atomic<Entity> nextUUID;
+
+        /**
+         * @brief The difference between consecutive UUIDs. Entity managers sharing a UUID space use interleaved UUIDs.
+         *
+         */
+        Entity uuidStride;
+
+        /**
+         * @brief The internal ID that will be given to the next entity if it cannot be recycled.
+         *
+         */
+        size_t nextInternalId;
+
+        /**
+         * @brief A list of observers that want notifications about changed entities and components.
+         *
+         */
+        std::set<EntityObserver*> observers;
+
+        /**
+         * @brief True between BeginConcurrentSpawning and EndConcurrentSpawning.
+         *
+         */
+        bool spawning;
+
+        /**
+         * @brief The contexts handed out for concurrent spawning.
+         *
+         */
+        std::vector<SpawnContext*> spawnContexts;
+
+        /**
+         * @brief The component types with room reserved for concurrent spawning.
+         *
+         */
+        std::bitset<MAX_COMPONENTS> concurrentTypes;
+
+        /**
+         * @brief The next recycled ID to claim while spawning concurrently. Can run past the end of recycledIds.
+         *
+         */
+        std::atomic<size_t> concurrentRecycledCursor;
+
+        /**
+         * @brief The next new internal ID to claim while spawning concurrently.
+         *
+         */
+        std::atomic<size_t> concurrentNextInternalId;
+
+        /**
+         * @brief The size the entity list was grown to for concurrent spawning. No claimed internal ID reaches it.
+         *
+         */
+        size_t concurrentInternalIdLimit;
+    };
+
+
+    // IMPLEMENTATION
+
+    template <typename T>
+    Private::ComponentPool<T>* EntityManager::GetPool()
+    {
+        assert(!sharedTypes.test(Component<T>::ID));
+        assert(!layoutTypes.test(Component<T>::ID));
+
+        if (pools[Component<T>::ID] == nullptr)
+            pools[Component<T>::ID] = new Private::ComponentPool<T>(reservedEntityCount);
+
+        return static_cast<Private::ComponentPool<T>*>(pools[Component<T>::ID]);
+    }
+
+    template <typename T>
+    Private::SharedComponentPool<T>* EntityManager::GetSharedPool()
+    {
+        if (pools[Component<T>::ID] == nullptr)
+        {
+            pools[Component<T>::ID] = new Private::SharedComponentPool<T>(reservedEntityCount);
+            sharedTypes.set(Component<T>::ID, true);
+        }
+
+        assert(sharedTypes.test(Component<T>::ID));
+        return static_cast<Private::SharedComponentPool<T>*>(pools[Component<T>::ID]);
+    }
+
+    template <typename T>
+    Private::SplitComponentPool<T>* EntityManager::GetSplitPool()
+    {
+        if (pools[Component<T>::ID] == nullptr)
+        {
+            pools[Component<T>::ID] = new Private::SplitComponentPool<T>(reservedEntityCount);
+            layoutTypes.set(Component<T>::ID, true);
+        }
+
+        assert(layoutTypes.test(Component<T>::ID));
+        return static_cast<Private::SplitComponentPool<T>*>(pools[Component<T>::ID]);
+    }
+
+    template <typename T>
+    Private::BlockedComponentPool<T>* EntityManager::GetBlockedPool()
+    {
+        if (pools[Component<T>::ID] == nullptr)
+        {
+            pools[Component<T>::ID] = new Private::BlockedComponentPool<T>(reservedEntityCount);
+            layoutTypes.set(Component<T>::ID, true);
+        }
+
+        assert(layoutTypes.test(Component<T>::ID));
+        return static_cast<Private::BlockedComponentPool<T>*>(pools[Component<T>::ID]);
+    }
+
+    template <typename T>
+    void EntityManager::ReserveConcurrentComponents(size_t count)
+    {
+        assert(spawning);
+        assert(!concurrentTypes.test(Component<T>::ID));
+
+        GetPool<T>()->BeginConcurrent(count, concurrentInternalIdLimit);
+        concurrentTypes.set(Component<T>::ID, true);
+    }
+
+    template <typename T>
+    T* EntityManager::AddComponent(Entity entity)
+    {
+        if (recorder != nullptr)
+            recorder->AddComponent(entity, Component<T>::ID, sizeof(T));
+
+        // Find the internal ID of the entity.
+        auto it = translator.find(entity);
+        assert(it != translator.end());
+
+        size_t internalId = it->second;
+        assert(internalId < entities.Size());
+
+        // If the component was removed but not destroyed yet, it is reset instead of destroyed.
+        Private::ComponentPool<T>* pool = GetPool<T>();
+        if (pool->Has(internalId))
+        {
+            componentsToDestroy.erase(std::remove(componentsToDestroy.begin(), componentsToDestroy.end(), ComponentReference(internalId, Component<T>::ID)),
+                                      componentsToDestroy.end());
+        }
+
+        // Create the new component. Joining a group moves it, so it is looked up again afterwards.
+        T* component = pool->Add(internalId);
+        entities[internalId].flags.set(Component<T>::ID, true);
+        entities[internalId].disabled.set(Component<T>::ID, false);
+        if (groupOwners[Component<T>::ID] != NO_GROUP)
+        {
+            UpdateGroups(internalId, entities[internalId].flags);
+            component = pool->Get(internalId);
+        }
+
+        if (!entities[internalId].prefab)
+        {
+            for (auto observer : observers)
+                observer->ComponentAdded(entity, Component<T>::ID);
+        }
+
+        return component;
+    }
+
+    template <typename T>
+    T* EntityManager::GetComponent(Entity entity)
+    {
+        auto it = translator.find(entity);
+        assert(it != translator.end());
+
+        size_t internalId = it->second;
+        assert(internalId < entities.Size());
+        assert(!sharedTypes.test(Component<T>::ID));
+        assert(!layoutTypes.test(Component<T>::ID));
+
+        Private::ComponentPoolBase* pool = pools[Component<T>::ID];
+        if (pool == nullptr)
+            return nullptr;
+
+        return static_cast<Private::ComponentPool<T>*>(pool)->Get(internalId);
+    }
+
+    template <typename T>
+    const T* EntityManager::AddSharedComponent(Entity entity, const T& value)
+    {
+        if (recorder != nullptr)
+            recorder->AddComponent(entity, Component<T>::ID, sizeof(T));
+
+        auto it = translator.find(entity);
+        assert(it != translator.end());
+
+        size_t internalId = it->second;
+        assert(internalId < entities.Size());
+
+        // If the component was removed but not destroyed yet, it is changed instead of destroyed.
+        Private::SharedComponentPool<T>* pool = GetSharedPool<T>();
+        if (pool->Has(internalId))
+        {
+            componentsToDestroy.erase(std::remove(componentsToDestroy.begin(), componentsToDestroy.end(), ComponentReference(internalId, Component<T>::ID)),
+                                      componentsToDestroy.end());
+        }
+
+        const T* component = pool->Set(internalId, value);
+        bool added = !entities[internalId].flags.test(Component<T>::ID);
+        entities[internalId].flags.set(Component<T>::ID, true);
+        if (added)
+            entities[internalId].disabled.set(Component<T>::ID, false);
+
+        // Changing the value of a shared component does not change what components the entity has.
+        if (added && !entities[internalId].prefab)
+        {
+            for (auto observer : observers)
+                observer->ComponentAdded(entity, Component<T>::ID);
+        }
+
+        return component;
+    }
+
+    template <typename T>
+    const T* EntityManager::GetSharedComponent(Entity entity)
+    {
+        auto it = translator.find(entity);
+        assert(it != translator.end());
+
+        size_t internalId = it->second;
+        assert(internalId < entities.Size());
+
+        Private::ComponentPoolBase* pool = pools[Component<T>::ID];
+        if (pool == nullptr)
+            return nullptr;
+
+        assert(sharedTypes.test(Component<T>::ID));
+        return static_cast<Private::SharedComponentPool<T>*>(pool)->Get(internalId);
+    }
+
+    template <typename T>
+    size_t EntityManager::GetSharedValueCount()
+    {
+        return GetSharedPool<T>()->GetValueCount();
+    }
+
+    template <typename T, typename Function>
+    void EntityManager::ForEachSharedGroup(Function function)
+    {
+        GetSharedPool<T>()->ForEachGroup([&](const T& value, const std::vector<size_t>& internalIds)
+        {
+            sharedGroup.clear();
+            for (auto internalId : internalIds)
+                sharedGroup.push_back(entities[internalId].entity);
+
+            function(value, static_cast<const std::vector<Entity>&>(sharedGroup));
+        });
+    }
+
+    template <typename T>
+    SplitView<T> EntityManager::AddSplitComponent(Entity entity)
+    {
+        if (recorder != nullptr)
+            recorder->AddComponent(entity, Component<T>::ID, sizeof(typename T::Hot) + sizeof(typename T::Cold));
+
+        auto it = translator.find(entity);
+        assert(it != translator.end());
+
+        size_t internalId = it->second;
+        assert(internalId < entities.Size());
+
+        // If the component was removed but not destroyed yet, it is reset instead of destroyed.
+        Private::SplitComponentPool<T>* pool = GetSplitPool<T>();
+        if (pool->Has(internalId))
+        {
+            componentsToDestroy.erase(std::remove(componentsToDestroy.begin(), componentsToDestroy.end(), ComponentReference(internalId, Component<T>::ID)),
+                                      componentsToDestroy.end());
+        }
+
+        SplitView<T> component = pool->Add(internalId);
+        entities[internalId].flags.set(Component<T>::ID, true);
+        entities[internalId].disabled.set(Component<T>::ID, false);
+
+        if (!entities[internalId].prefab)
+        {
+            for (auto observer : observers)
+                observer->ComponentAdded(entity, Component<T>::ID);
+        }
+
+        return component;
+    }
+
+    template <typename T>
+    SplitView<T> EntityManager::GetSplitComponent(Entity entity)
+    {
+        auto it = translator.find(entity);
+        assert(it != translator.end());
+
+        size_t internalId = it->second;
+        assert(internalId < entities.Size());
+
+        Private::ComponentPoolBase* pool = pools[Component<T>::ID];
+        if (pool == nullptr)
+            return SplitView<T>();
+
+        assert(layoutTypes.test(Component<T>::ID));
+        return static_cast<Private::SplitComponentPool<T>*>(pool)->Get(internalId);
+    }
+
+    template <typename T, typename Function>
+    void EntityManager::ProcessSplitComponents(Function function)
+    {
+        Private::SplitComponentPool<T>* pool = GetSplitPool<T>();
+        function(pool->Size(), pool->GetHotData(), pool->GetColdData());
+    }
+
+    template <typename T>
+    BlockedView<T> EntityManager::AddBlockedComponent(Entity entity, const T& value)
+    {
+        if (recorder != nullptr)
+            recorder->AddComponent(entity, Component<T>::ID, sizeof(T));
+
+        auto it = translator.find(entity);
+        assert(it != translator.end());
+
+        size_t internalId = it->second;
+        assert(internalId < entities.Size());
+
+        // If the component was removed but not destroyed yet, it is changed instead of destroyed.
+        Private::BlockedComponentPool<T>* pool = GetBlockedPool<T>();
+        if (pool->Has(internalId))
+        {
+            componentsToDestroy.erase(std::remove(componentsToDestroy.begin(), componentsToDestroy.end(), ComponentReference(internalId, Component<T>::ID)),
+                                      componentsToDestroy.end());
+        }
+
+        BlockedView<T> component = pool->Add(internalId, value);
+        entities[internalId].flags.set(Component<T>::ID, true);
+        entities[internalId].disabled.set(Component<T>::ID, false);
+
+        if (!entities[internalId].prefab)
+        {
+            for (auto observer : observers)
+                observer->ComponentAdded(entity, Component<T>::ID);
+        }
+
+        return component;
+    }
+
+    template <typename T>
+    BlockedView<T> EntityManager::GetBlockedComponent(Entity entity)
+    {
+        auto it = translator.find(entity);
+        assert(it != translator.end());
+
+        size_t internalId = it->second;
+        assert(internalId < entities.Size());
+
+        Private::ComponentPoolBase* pool = pools[Component<T>::ID];
+        if (pool == nullptr)
+            return BlockedView<T>();
+
+        assert(layoutTypes.test(Component<T>::ID));
+        return static_cast<Private::BlockedComponentPool<T>*>(pool)->Get(internalId);
+    }
+
+    template <typename T, typename Function>
+    void EntityManager::ForEachBlock(Function function)
+    {
+        Private::BlockedComponentPool<T>* pool = GetBlockedPool<T>();
+        for (size_t block = 0; block < pool->GetBlockCount(); ++block)
+        {
+            size_t count = std::min(T::WIDTH, pool->Size() - block * T::WIDTH);
+            function(count, pool->GetBlock(block));
+        }
+    }
+
+    template <typename T>
+    void EntityManager::RemoveComponent(Entity entity)
+    {
+        if (recorder != nullptr)
+            recorder->RemoveComponent(entity, Component<T>::ID);
+
+        auto it = translator.find(entity);
+        assert(it != translator.end());
+
+        size_t internalId = it->second;
+        assert(internalId < entities.Size());
+
+        componentsToDestroy.push_back(ComponentReference(internalId, Component<T>::ID));
+        entities[internalId].flags.set(Component<T>::ID, false);
+        entities[internalId].disabled.set(Component<T>::ID, false);
+        if (groupOwners[Component<T>::ID] != NO_GROUP)
+            UpdateGroups(internalId, entities[internalId].flags);
+
+        if (!entities[internalId].prefab)
+        {
+            for (auto observer : observers)
+                observer->ComponentRemoved(entity, Component<T>::ID);
+        }
+    }
+
+    template <typename... Ts>
+    const std::vector<Entity>& EntityManager::Query()
+    {
+        std::bitset<MAX_COMPONENTS> mask;
+        ComponentType types[] = { Component<Ts>::ID... };
+        for (auto type : types)
+            mask.set(type, true);
+
+        return Query(mask);
+    }
+
+    template <typename T>
+    SnapshotReader<T>* EntityManager::CreateSnapshotReader()
+    {
+        assert(!sharedTypes.test(Component<T>::ID));
+        assert(!layoutTypes.test(Component<T>::ID));
+
+        SnapshotReader<T>* reader = new SnapshotReader<T>();
+        snapshotReaders.push_back(std::make_pair(Component<T>::ID, static_cast<Private::SnapshotPublisherBase*>(reader)));
+        return reader;
+    }
+
+    template <typename T, typename F>
+    void EntityManager::CreateHashIndex(F T::* field)
+    {
+        assert((FindIndex<Private::HashIndex<T, F>>(field) == nullptr));
+        GetIndexRegistry()->Add(Component<T>::ID, new Private::HashIndex<T, F>(GetPool<T>(), field));
+    }
+
+    template <typename T, typename F>
+    void EntityManager::CreateOrderedIndex(F T::* field)
+    {
+        assert((FindIndex<Private::OrderedIndex<T, F>>(field) == nullptr));
+        GetIndexRegistry()->Add(Component<T>::ID, new Private::OrderedIndex<T, F>(GetPool<T>(), field));
+    }
+
+    template <typename T, typename F>
+    const std::vector<Entity>& EntityManager::FindByField(F T::* field, const F& value)
+    {
+        Private::HashIndex<T, F>* hashIndex = FindIndex<Private::HashIndex<T, F>>(field);
+        if (hashIndex != nullptr)
+            return hashIndex->Find(value);
+
+        Private::OrderedIndex<T, F>* orderedIndex = FindIndex<Private::OrderedIndex<T, F>>(field);
+        assert(orderedIndex != nullptr);
+        return orderedIndex->Find(value);
+    }
+
+    template <typename T, typename F>
+    void EntityManager::FindInRange(F T::* field, const F& low, const F& high, std::vector<Entity>& result)
+    {
+        Private::OrderedIndex<T, F>* orderedIndex = FindIndex<Private::OrderedIndex<T, F>>(field);
+        assert(orderedIndex != nullptr);
+        orderedIndex->FindInRange(low, high, result);
+    }
+
+    template <typename T>
+    void EntityManager::CreateReferenceIndex(EntityRef T::* field)
+    {
+        assert(FindIndex<Private::ReferenceIndex<T>>(field) == nullptr);
+        GetIndexRegistry()->AddReferenceIndex(new Private::ReferenceIndex<T>(GetPool<T>(), field));
+    }
+
+    template <typename T>
+    void EntityManager::SetReference(Entity entity, EntityRef T::* field, Entity target)
+    {
+        assert(target == INVALID_ENTITY || !IsDestroyed(target));
+
+        if (FindIndex<Private::ReferenceIndex<T>>(field) == nullptr)
+            CreateReferenceIndex(field);
+
+        T* component = GetComponent<T>(entity);
+        assert(component != nullptr);
+
+        component->*field = EntityRef(target);
+        NotifyComponentChanged<T>(entity);
+    }
+
+    template <typename T>
+    const std::vector<Entity>& EntityManager::FindReferences(EntityRef T::* field, Entity target)
+    {
+        Private::ReferenceIndex<T>* index = FindIndex<Private::ReferenceIndex<T>>(field);
+        assert(index != nullptr);
+        return index->FindOwners(target);
+    }
+
+    template <typename T>
+    void EntityManager::NotifyComponentChanged(Entity entity)
+    {
+        size_t internalId = GetInternalId(entity);
+        assert(entities[internalId].flags.test(Component<T>::ID));
+
+        if (!entities[internalId].prefab)
+        {
+            for (auto observer : observers)
+                observer->ComponentChanged(entity, Component<T>::ID);
+        }
+    }
+
+    template <typename I, typename T, typename F>
+    I* EntityManager::FindIndex(F T::* field)
+    {
+        if (indexRegistry == nullptr)
+            return nullptr;
+
+        for (auto index : indexRegistry->GetIndexes(Component<T>::ID))
+        {
+            if (index->GetTypeTag() == &I::Tag && static_cast<I*>(index)->GetField() == field)
+                return static_cast<I*>(index);
+        }
+
+        return nullptr;
+    }
+
+    template <typename... Ts>
+    void EntityManager::CreateGroup()
+    {
+        Group group;
+        group.size = 0;
+        ComponentType types[] = { Component<Ts>::ID... };
+        for (auto type : types)
+        {
+            assert(groupOwners[type] == NO_GROUP);
+            group.types.set(type, true);
+            groupOwners[type] = groups.size();
+        }
+
+        int expand[] = { 0, (GetPool<Ts>(), 0)... };
+        (void)expand;
+        groups.push_back(group);
+
+        // Sort the existing members to the front. Any owned pool lists all candidates.
+        Private::ComponentPoolBase* pool = pools[types[0]];
+        for (size_t i = 0; i < pool->Size(); ++i)
+            UpdateGroups(pool->GetInternalId(i), entities[pool->GetInternalId(i)].flags);
+    }
+
+    template <typename... Ts, typename Function>
+    void EntityManager::ProcessGroup(Function function)
+    {
+        const Group& group = groups[FindGroup<Ts...>()];
+        function(group.size, GetPool<Ts>()->GetData()...);
+    }
+
+    template <typename T, typename Function>
+    void EntityManager::ProcessHierarchy(Function function)
+    {
+        assert(groupOwners[Component<T>::ID] == NO_GROUP);
+        if (hierarchy == nullptr)
+            return;
+
+        Private::ComponentPool<T>* pool = GetPool<T>();
+        const std::vector<size_t>& parents = hierarchy->Sort(pool, Component<T>::ID);
+
+        T* data = pool->GetData();
+        for (size_t i = 0; i < parents.size(); ++i)
+            function(data[i], parents[i] == Private::Hierarchy::NO_PARENT ? nullptr : static_cast<const T*>(&data[parents[i]]));
+    }
+
+    template <typename... Ts>
+    size_t EntityManager::FindGroup() const
+    {
+        ComponentType types[] = { Component<Ts>::ID... };
+        size_t group = groupOwners[types[0]];
+        for (auto type : types)
+        {
+            assert(groupOwners[type] != NO_GROUP);
+            assert(groupOwners[type] == group);
+            (void)type;
+        }
+
+        return group;
+    }
+
+    template <typename T>
+    bool EntityManager::HasComponent(Entity entity) const
+    {
+        auto it = translator.find(entity);
+        assert(it != translator.end());
+
+        size_t internalId = it->second;
+        assert(internalId < entities.Size());
+
+        const Private::ComponentPoolBase* pool = pools[Component<T>::ID];
+        return pool != nullptr && pool->Has(internalId);
+    }
+
+    template <typename T>
+    void EntityManager::SetComponentEnabled(Entity entity, bool enabled)
+    {
+        auto it = translator.find(entity);
+        assert(it != translator.end());
+
+        size_t internalId = it->second;
+        assert(internalId < entities.Size());
+        assert(entities[internalId].flags.test(Component<T>::ID));
+
+        if (entities[internalId].disabled.test(Component<T>::ID) != enabled)
+            return;
+
+        entities[internalId].disabled.set(Component<T>::ID, !enabled);
+
+        if (!entities[internalId].prefab)
+        {
+            for (auto observer : observers)
+                observer->ComponentEnabled(entity, Component<T>::ID, enabled);
+        }
+    }
+
+    template <typename T>
+    bool EntityManager::IsComponentEnabled(Entity entity) const
     {
         auto it = translator.find(entity);
         assert(it != translator.end());
 
         size_t internalId = it->second;
-        assert(internalId < entities.size());
-        assert(internalId < components[Component<T>::ID].size());
+        assert(internalId < entities.Size());
 
-        return components[Component<T>::ID][internalId] != nullptr;
+        return entities[internalId].flags.test(Component<T>::ID) && !entities[internalId].disabled.test(Component<T>::ID);
     }
 
     template <typename T>
@@ -335,11 +1517,10 @@ namespace ECS
         assert(it != translator.end());
 
         size_t internalId = it->second;
-        assert(internalId < entities.size());
-        assert(internalId < components[Component<T>::ID].size());
+        assert(internalId < entities.Size());
 
-        Private::ComponentBase* component = components[Component<T>::ID][internalId];
-        return component != nullptr &&
+        const Private::ComponentPoolBase* pool = pools[Component<T>::ID];
+        return pool != nullptr && pool->Has(internalId) &&
                std::find(componentsToDestroy.begin(), componentsToDestroy.end(), ComponentReference(internalId, Component<T>::ID)) != componentsToDestroy.end();
     }
 }
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <bitset>
+#include "config.h"
 #include "entity.h"
 #include "component.h"
 
@@ -14,6 +16,8 @@ namespace ECS
     class EntityObserver
     {
     public:
+        virtual ~EntityObserver() {}
+
         /**
          * @brief An entity has been created.
          *
@@ -38,6 +42,25 @@ namespace ECS
          */
         virtual void ComponentAdded(ECS::Entity entity, ECS::ComponentType componentType) = 0;
 
+        /**
+         * @brief Several components have been added to an entity at once.
+         *
+         * This is called when an entity is created with all its components in one go, e.g. by
+         * EntityManager::Instantiate. The default implementation calls ComponentAdded for every
+         * component type; override it to handle the whole set at once.
+         *
+         * @param entity The UUID of the target entity.
+         * @param componentTypes The flags of the component types added.
+         */
+        virtual void ComponentsAdded(ECS::Entity entity, const std::bitset<MAX_COMPONENTS>& componentTypes)
+        {
+            for (size_t i = 0; i < componentTypes.size(); ++i)
+            {
+                if (componentTypes.test(i))
+                    ComponentAdded(entity, static_cast<ECS::ComponentType>(i));
+            }
+        }
+
         /**
          * @brief A component has been removed from an entity.
          *
@@ -49,5 +72,33 @@ namespace ECS
          * @param componentType The ID of the component type added.
          */
         virtual void ComponentRemoved(ECS::Entity entity, ECS::ComponentType componentType) = 0;
+
+        /**
+         * @brief An entity has been enabled or disabled. Does nothing by default.
+         *
+         * @param entity The UUID of the target entity.
+         * @param enabled True if the entity was enabled, false if it was disabled.
+         */
+        virtual void EntityEnabled(ECS::Entity, bool) {}
+
+        /**
+         * @brief A component on an entity has been enabled or disabled. Does nothing by default.
+         *
+         * @param entity The UUID of the target entity.
+         * @param componentType The ID of the component type.
+         * @param enabled True if the component was enabled, false if it was disabled.
+         */
+        virtual void ComponentEnabled(ECS::Entity, ECS::ComponentType, bool) {}
+
+        /**
+         * @brief The value of a component on an entity has been changed. Does nothing by default.
+         *
+         * Only called when someone calls EntityManager::NotifyComponentChanged; writing to a component does
+         * not notify anyone by itself.
+         *
+         * @param entity The UUID of the target entity.
+         * @param componentType The ID of the component type.
+         */
+        virtual void ComponentChanged(ECS::Entity, ECS::ComponentType) {}
     };
 }
@@ -0,0 +1,210 @@
+#pragma once
+
+#include <cassert>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+#include "entity.h"
+#include "fieldindex.h"
+
+namespace ECS
+{
+    /**
+     * @brief A component field referring to another entity, e.g. the target of a turret.
+     *
+     * Once references in a field are tracked with EntityManager::CreateReferenceIndex (or set with
+     * EntityManager::SetReference), they are nulled when the entity they refer to is destroyed, and the
+     * components holding them are reported as changed. The referencing components are found through a reverse
+     * index, so destroying an entity costs time in the number of references to it, not the number of components.
+     */
+    class EntityRef
+    {
+    public:
+        /**
+         * @brief Constructor. Create a null reference.
+         *
+         */
+        EntityRef();
+
+        /**
+         * @brief Constructor. Refer to an entity, or to nothing with INVALID_ENTITY.
+         *
+         */
+        EntityRef(Entity target);
+
+        /**
+         * @brief Get the referenced entity, or INVALID_ENTITY if the reference is null.
+         *
+         */
+        Entity Get() const;
+
+        /**
+         * @brief Check if the reference refers to nothing.
+         *
+         */
+        bool IsNull() const;
+
+        bool operator==(const EntityRef& other) const;
+        bool operator!=(const EntityRef& other) const;
+    private:
+        /**
+         * @brief The referenced entity.
+         *
+         */
+        Entity target;
+    };
+
+    namespace Private
+    {
+        /**
+         * @brief Private type. Lets the index registry clear references without knowing the component type.
+         *
+         */
+        class ReferenceIndexBase : public FieldIndexBase
+        {
+        public:
+            /**
+             * @brief Get the type of the components holding the references.
+             *
+             */
+            virtual ComponentType GetComponentType() const = 0;
+
+            /**
+             * @brief Get the entities whose reference refers to the target.
+             *
+             */
+            virtual const std::vector<Entity>& FindOwners(Entity target) const = 0;
+
+            /**
+             * @brief Null the reference of an entity and remove it from the index.
+             *
+             */
+            virtual void Clear(Entity owner, size_t internalId) = 0;
+        };
+
+        /**
+         * @brief Private type. Maps the entities referred to by an EntityRef field of component type T to the
+         * entities referring to them.
+         *
+         * Null references are not indexed.
+         */
+        template <typename T>
+        class ReferenceIndex : public ReferenceIndexBase
+        {
+        public:
+            ReferenceIndex(ComponentPool<T>* pool, EntityRef T::* field);
+
+            /**
+             * @brief The tag of this index type.
+             *
+             */
+            static void Tag();
+
+            TypeTag GetTypeTag() const;
+            void Update(Entity entity, size_t internalId);
+            void Erase(Entity entity);
+            ComponentType GetComponentType() const;
+            const std::vector<Entity>& FindOwners(Entity target) const;
+            void Clear(Entity owner, size_t internalId);
+
+            /**
+             * @brief Get the indexed field.
+             *
+             */
+            EntityRef T::* GetField() const;
+        private:
+            /**
+             * @brief The pool the references are read from.
+             *
+             */
+            ComponentPool<T>* pool;
+
+            /**
+             * @brief The owners by referenced entity.
+             *
+             */
+            HashIndex<T, EntityRef> index;
+        };
+
+
+        // IMPLEMENTATION
+
+        template <typename T>
+        ReferenceIndex<T>::ReferenceIndex(ComponentPool<T>* pool, EntityRef T::* field)
+            : index(pool, field)
+        {
+            this->pool = pool;
+        }
+
+        template <typename T>
+        void ReferenceIndex<T>::Tag() {}
+
+        template <typename T>
+        FieldIndexBase::TypeTag ReferenceIndex<T>::GetTypeTag() const
+        {
+            return &ReferenceIndex<T>::Tag;
+        }
+
+        template <typename T>
+        void ReferenceIndex<T>::Update(Entity entity, size_t internalId)
+        {
+            const T* component = pool->Get(internalId);
+            assert(component != nullptr);
+
+            if ((component->*GetField()).IsNull())
+                index.Erase(entity);
+            else
+                index.Update(entity, internalId);
+        }
+
+        template <typename T>
+        void ReferenceIndex<T>::Erase(Entity entity)
+        {
+            index.Erase(entity);
+        }
+
+        template <typename T>
+        ComponentType ReferenceIndex<T>::GetComponentType() const
+        {
+            return Component<T>::ID;
+        }
+
+        template <typename T>
+        const std::vector<Entity>& ReferenceIndex<T>::FindOwners(Entity target) const
+        {
+            return index.Find(EntityRef(target));
+        }
+
+        template <typename T>
+        void ReferenceIndex<T>::Clear(Entity owner, size_t internalId)
+        {
+            T* component = pool->Get(internalId);
+            assert(component != nullptr);
+
+            component->*GetField() = EntityRef();
+            index.Erase(owner);
+        }
+
+        template <typename T>
+        EntityRef T::* ReferenceIndex<T>::GetField() const
+        {
+            return index.GetField();
+        }
+    }
+}
+
+namespace std
+{
+    /**
+     * @brief Hashes references by the referenced entity, so that EntityRef fields can be used in hash indexes.
+     *
+     */
+    template <>
+    struct hash<ECS::EntityRef>
+    {
+        size_t operator()(const ECS::EntityRef& reference) const
+        {
+            return hash<ECS::Entity>()(reference.Get());
+        }
+    };
+}
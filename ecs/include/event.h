@@ -0,0 +1,59 @@
+#pragma once
+
+namespace ECS
+{
+    template<typename T> class Event;
+
+    typedef unsigned int EventType;
+
+    namespace Private
+    {
+        /**
+         * @brief Private type. Keeps track of event type IDs.
+         *
+         */
+        class EventBase
+        {
+            template <typename T> friend class ECS::Event;
+        protected:
+            /**
+             * @brief Protected constructor. Only inherited classes can be instantiated.
+             *
+             */
+            EventBase() {}
+        private:
+            /**
+             * @brief Increased for every instantiated type of Event.
+             *
+             */
+            static EventType nextTypeId;
+        };
+    }
+
+    /**
+     * @brief An event is a piece of data sent through an EventBus, such as a collision or a damage report.
+     *
+     * Inherit from this class to create your own event types. Pass along the inherited type
+     * as the template parameter.
+     *
+     */
+    template <typename T>
+    class Event : public Private::EventBase
+    {
+    public:
+        /**
+         * @brief Type ID for the event. This is increased automatically for every instantiated type of the class.
+         */
+        static const EventType ID;
+    protected:
+        /**
+         * @brief Protected constructor. Only inherited classes can be instantiated.
+         *
+         */
+        Event() {}
+    };
+
+    // Increase the type ID for every template instantiation of an event.
+    template <typename T>
+    const EventType Event<T>::ID = Private::EventBase::nextTypeId++;
+}
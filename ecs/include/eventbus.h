@@ -0,0 +1,289 @@
+#pragma once
+
+#include <cassert>
+#include <atomic>
+#include <mutex>
+#include <new>
+#include <vector>
+#include "config.h"
+#include "event.h"
+#include "column.h"
+
+namespace ECS
+{
+    /**
+     * @brief A read-only view of the events of one type, stored contiguously.
+     *
+     */
+    template <typename T>
+    class EventSpan
+    {
+    public:
+        EventSpan(const T* events, size_t count);
+
+        /**
+         * @brief Get the number of events.
+         *
+         */
+        size_t Size() const;
+
+        const T* begin() const;
+        const T* end() const;
+        const T& operator[](size_t index) const;
+    private:
+        const T* events;
+        size_t count;
+    };
+
+    namespace Private
+    {
+        /**
+         * @brief Private type. Lets the event bus swap the buffers of a channel without knowing its event type.
+         *
+         */
+        class EventChannelBase
+        {
+        public:
+            virtual ~EventChannelBase() {}
+
+            /**
+             * @brief Make the events published since the last call readable, dropping the ones readable before.
+             *
+             */
+            virtual void Update() = 0;
+        };
+
+        /**
+         * @brief Private type. The two event buffers of one event type.
+         *
+         * Producers claim slots in the writing buffer with an atomic cursor and construct their event in place,
+         * so publishing is lock-free as long as the reserved capacity lasts. Events past the capacity go to an
+         * overflow list behind a mutex, and the capacity is grown at the next update so that the overflow is rare.
+         */
+        template <typename T>
+        class EventChannel : public EventChannelBase
+        {
+        public:
+            EventChannel(size_t reservedCount);
+
+            /**
+             * @brief Add an event to the writing buffer. Can be called from several threads at once.
+             *
+             */
+            void Publish(const T& event);
+
+            /**
+             * @brief Get the events in the reading buffer.
+             *
+             */
+            EventSpan<T> Read() const;
+
+            void Update();
+        private:
+            /**
+             * @brief The events published since the last update, and the events readable until the next one.
+             *
+             */
+            Column<T> buffers[2];
+            size_t writing;
+
+            /**
+             * @brief The number of slots reserved in the writing buffer.
+             *
+             */
+            size_t capacity;
+
+            /**
+             * @brief The next slot to claim in the writing buffer. Can run past the capacity.
+             *
+             */
+            std::atomic<size_t> cursor;
+
+            /**
+             * @brief Events that did not fit in the reserved slots.
+             *
+             */
+            std::vector<T> overflow;
+            std::mutex overflowMutex;
+        };
+    }
+
+    /**
+     * @brief Carries typed events from producers to consumers, one frame at a time.
+     *
+     * Every event type has its own channel with contiguous per-frame buffers. Events published during a frame
+     * become readable when Update is called at the end of the frame, and stay readable until the next Update.
+     * Consumers read all events of a type as one span at whatever point they are scheduled.
+     *
+     * Publish can be called from several threads at once. Register all event types and call Update while no
+     * thread is publishing.
+     */
+    class EventBus
+    {
+    public:
+        EventBus();
+
+        /**
+         * @brief Destructor. Destroys all events.
+         *
+         */
+        ~EventBus();
+
+        /**
+         * @brief Create the channel for events of type T.
+         *
+         * @param reservedCount How many events per frame to reserve memory for to start with.
+         */
+        template <typename T>
+        void RegisterEvent(size_t reservedCount = RESERVED_EVENT_COUNT);
+
+        /**
+         * @brief Publish an event. It becomes readable after the next call to Update.
+         *
+         * The event type must be registered. Lock-free unless more events are published in a frame than there
+         * is memory reserved for.
+         */
+        template <typename T>
+        void Publish(const T& event);
+
+        /**
+         * @brief Get the events of type T published in the previous frame.
+         *
+         * @return The events, in no particular order. The span is valid until the next call to Update.
+         */
+        template <typename T>
+        EventSpan<T> Read() const;
+
+        /**
+         * @brief End the frame: make the events published during it readable, and drop the previous ones.
+         *
+         * Costs O(1) per event type for event types that are trivially destructible.
+         */
+        void Update();
+    private:
+        EventBus(const EventBus&);
+        EventBus& operator=(const EventBus&);
+
+        /**
+         * @brief One channel per event type, indexed by event type ID. Unregistered types are null.
+         *
+         */
+        std::vector<Private::EventChannelBase*> channels;
+    };
+
+
+    // IMPLEMENTATION
+
+    template <typename T>
+    EventSpan<T>::EventSpan(const T* events, size_t count)
+    {
+        this->events = events;
+        this->count = count;
+    }
+
+    template <typename T>
+    size_t EventSpan<T>::Size() const
+    {
+        return count;
+    }
+
+    template <typename T>
+    const T* EventSpan<T>::begin() const
+    {
+        return events;
+    }
+
+    template <typename T>
+    const T* EventSpan<T>::end() const
+    {
+        return events + count;
+    }
+
+    template <typename T>
+    const T& EventSpan<T>::operator[](size_t index) const
+    {
+        assert(index < count);
+        return events[index];
+    }
+
+    namespace Private
+    {
+        template <typename T>
+        EventChannel<T>::EventChannel(size_t reservedCount)
+        {
+            writing = 0;
+            capacity = reservedCount;
+            cursor = 0;
+            buffers[0].Reserve(reservedCount);
+            buffers[1].Reserve(reservedCount);
+        }
+
+        template <typename T>
+        void EventChannel<T>::Publish(const T& event)
+        {
+            size_t index = cursor.fetch_add(1, std::memory_order_relaxed);
+            if (index < capacity)
+            {
+                new (buffers[writing].Data() + index) T(event);
+                return;
+            }
+
+            std::lock_guard<std::mutex> lock(overflowMutex);
+            overflow.push_back(event);
+        }
+
+        template <typename T>
+        EventSpan<T> EventChannel<T>::Read() const
+        {
+            const Column<T>& reading = buffers[1 - writing];
+            return EventSpan<T>(reading.Data(), reading.Size());
+        }
+
+        template <typename T>
+        void EventChannel<T>::Update()
+        {
+            // The claimed slots have already been constructed by Publish.
+            Column<T>& written = buffers[writing];
+            size_t claimed = cursor.load();
+            written.Extend(claimed < capacity ? claimed : capacity);
+
+            for (auto& event : overflow)
+                new (written.Extend(1)) T(event);
+            overflow.clear();
+
+            // Drop the old events and start writing over them. Reserve what the busiest buffer needed, so that
+            // the next frames do not overflow.
+            if (written.Size() > capacity)
+                capacity = written.Size();
+
+            writing = 1 - writing;
+            buffers[writing].Clear();
+            buffers[writing].Reserve(capacity);
+            cursor = 0;
+        }
+    }
+
+    template <typename T>
+    void EventBus::RegisterEvent(size_t reservedCount)
+    {
+        if (Event<T>::ID >= channels.size())
+            channels.resize(Event<T>::ID + 1, nullptr);
+
+        assert(channels[Event<T>::ID] == nullptr);
+        channels[Event<T>::ID] = new Private::EventChannel<T>(reservedCount);
+    }
+
+    template <typename T>
+    void EventBus::Publish(const T& event)
+    {
+        assert(Event<T>::ID < channels.size() && channels[Event<T>::ID] != nullptr);
+        static_cast<Private::EventChannel<T>*>(channels[Event<T>::ID])->Publish(event);
+    }
+
+    template <typename T>
+    EventSpan<T> EventBus::Read() const
+    {
+        assert(Event<T>::ID < channels.size() && channels[Event<T>::ID] != nullptr);
+        return static_cast<const Private::EventChannel<T>*>(channels[Event<T>::ID])->Read();
+    }
+}
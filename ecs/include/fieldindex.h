@@ -0,0 +1,230 @@
+#pragma once
+
+#include <cassert>
+#include <map>
+#include <unordered_map>
+#include <vector>
+#include "entity.h"
+#include "componentpool.h"
+
+namespace ECS
+{
+    namespace Private
+    {
+        /**
+         * @brief Private type. Lets the entity manager maintain field indexes without knowing their types.
+         *
+         */
+        class FieldIndexBase
+        {
+        public:
+            /**
+             * @brief Identifies the concrete type of an index.
+             *
+             */
+            typedef void (*TypeTag)();
+
+            virtual ~FieldIndexBase() {}
+
+            /**
+             * @brief Get the tag of the concrete type of the index.
+             *
+             */
+            virtual TypeTag GetTypeTag() const = 0;
+
+            /**
+             * @brief Index the current value of the entity's component, replacing the value indexed before.
+             *
+             */
+            virtual void Update(Entity entity, size_t internalId) = 0;
+
+            /**
+             * @brief Remove the entity from the index. Does nothing if it is not indexed.
+             *
+             */
+            virtual void Erase(Entity entity) = 0;
+        };
+
+        /**
+         * @brief Private type. Maps the values of field F of component type T to the entities having them.
+         *
+         * Map is a map from F to a list of entities; an unordered map makes a hash index and an ordered map
+         * makes an index that also supports range queries. Adding, changing and removing an entry is O(1) on
+         * top of the map operation, however many entities share a value.
+         */
+        template <typename T, typename F, typename Map>
+        class FieldIndex : public FieldIndexBase
+        {
+        public:
+            FieldIndex(ComponentPool<T>* pool, F T::* field);
+
+            /**
+             * @brief The tag of this index type.
+             *
+             */
+            static void Tag();
+
+            TypeTag GetTypeTag() const;
+            void Update(Entity entity, size_t internalId);
+            void Erase(Entity entity);
+
+            /**
+             * @brief Get the indexed field.
+             *
+             */
+            F T::* GetField() const;
+
+            /**
+             * @brief Get the entities whose field equals the value.
+             *
+             */
+            const std::vector<Entity>& Find(const F& value) const;
+
+            /**
+             * @brief Append the entities whose field is in the range [low, high] to a list. Only for ordered maps.
+             *
+             */
+            void FindInRange(const F& low, const F& high, std::vector<Entity>& result) const;
+        private:
+            /**
+             * @brief The indexed value of an entity and its position in the list of entities with that value.
+             *
+             */
+            struct Record
+            {
+                F value;
+                size_t position;
+            };
+
+            /**
+             * @brief Returned by Find for values no entity has.
+             *
+             */
+            static const std::vector<Entity> EMPTY;
+
+            /**
+             * @brief The pool the field values are read from.
+             *
+             */
+            ComponentPool<T>* pool;
+
+            F T::* field;
+
+            /**
+             * @brief The entities by value.
+             *
+             */
+            Map buckets;
+
+            /**
+             * @brief The indexed entities.
+             *
+             */
+            std::unordered_map<Entity, Record> records;
+        };
+
+        /**
+         * @brief Private type. A field index with O(1) lookups.
+         *
+         */
+        template <typename T, typename F>
+        using HashIndex = FieldIndex<T, F, std::unordered_map<F, std::vector<Entity>>>;
+
+        /**
+         * @brief Private type. A field index with O(log n) lookups and range queries.
+         *
+         */
+        template <typename T, typename F>
+        using OrderedIndex = FieldIndex<T, F, std::map<F, std::vector<Entity>>>;
+
+
+        // IMPLEMENTATION
+
+        template <typename T, typename F, typename Map>
+        const std::vector<Entity> FieldIndex<T, F, Map>::EMPTY;
+
+        template <typename T, typename F, typename Map>
+        FieldIndex<T, F, Map>::FieldIndex(ComponentPool<T>* pool, F T::* field)
+        {
+            this->pool = pool;
+            this->field = field;
+        }
+
+        template <typename T, typename F, typename Map>
+        void FieldIndex<T, F, Map>::Tag() {}
+
+        template <typename T, typename F, typename Map>
+        FieldIndexBase::TypeTag FieldIndex<T, F, Map>::GetTypeTag() const
+        {
+            return &FieldIndex<T, F, Map>::Tag;
+        }
+
+        template <typename T, typename F, typename Map>
+        void FieldIndex<T, F, Map>::Update(Entity entity, size_t internalId)
+        {
+            const T* component = pool->Get(internalId);
+            assert(component != nullptr);
+
+            const F& value = component->*field;
+            auto it = records.find(entity);
+            if (it != records.end())
+            {
+                if (it->second.value == value)
+                    return;
+
+                Erase(entity);
+            }
+
+            std::vector<Entity>& bucket = buckets[value];
+            Record record = { value, bucket.size() };
+            records.insert(std::make_pair(entity, record));
+            bucket.push_back(entity);
+        }
+
+        template <typename T, typename F, typename Map>
+        void FieldIndex<T, F, Map>::Erase(Entity entity)
+        {
+            auto it = records.find(entity);
+            if (it == records.end())
+                return;
+
+            // Move the last entity with the same value into the hole.
+            auto bucket = buckets.find(it->second.value);
+            assert(bucket != buckets.end());
+
+            std::vector<Entity>& entities = bucket->second;
+            Entity moved = entities.back();
+            entities[it->second.position] = moved;
+            records[moved].position = it->second.position;
+            entities.pop_back();
+
+            if (entities.empty())
+                buckets.erase(bucket);
+            records.erase(entity);
+        }
+
+        template <typename T, typename F, typename Map>
+        F T::* FieldIndex<T, F, Map>::GetField() const
+        {
+            return field;
+        }
+
+        template <typename T, typename F, typename Map>
+        const std::vector<Entity>& FieldIndex<T, F, Map>::Find(const F& value) const
+        {
+            auto it = buckets.find(value);
+            if (it == buckets.end())
+                return EMPTY;
+
+            return it->second;
+        }
+
+        template <typename T, typename F, typename Map>
+        void FieldIndex<T, F, Map>::FindInRange(const F& low, const F& high, std::vector<Entity>& result) const
+        {
+            auto end = buckets.upper_bound(high);
+            for (auto it = buckets.lower_bound(low); it != end; ++it)
+                result.insert(result.end(), it->second.begin(), it->second.end());
+        }
+    }
+}
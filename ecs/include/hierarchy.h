@@ -0,0 +1,147 @@
+#pragma once
+
+#include <vector>
+#include <unordered_map>
+#include "config.h"
+#include "component.h"
+
+namespace ECS
+{
+    namespace Private
+    {
+        class ComponentPoolBase;
+
+        /**
+         * @brief Private type. Keeps track of parent/child relationships between entities, by internal ID.
+         *
+         * The members of the hierarchy are kept in breadth-first order, so that every parent comes before its
+         * children. The order is rebuilt lazily after the hierarchy changes. Sort puts the components of a type in
+         * the same order, so that they can be propagated from parents to children in one linear pass.
+         */
+        class Hierarchy
+        {
+        public:
+            /**
+             * @brief Used for entities without a parent.
+             *
+             */
+            static const size_t NO_PARENT;
+
+            Hierarchy();
+
+            /**
+             * @brief Make an entity the child of another, or a root if the parent is NO_PARENT.
+             *
+             * The parent must not be the entity itself or one of its descendants.
+             */
+            void SetParent(size_t child, size_t parent);
+
+            /**
+             * @brief Get the parent of an entity, or NO_PARENT.
+             *
+             */
+            size_t GetParent(size_t internalId) const;
+
+            /**
+             * @brief Get the children of an entity, in the order they were added.
+             *
+             */
+            const std::vector<size_t>& GetChildren(size_t internalId) const;
+
+            /**
+             * @brief Check if an entity has a parent or children.
+             *
+             */
+            bool IsMember(size_t internalId) const;
+
+            /**
+             * @brief Take an entity and all of its descendants out of the hierarchy.
+             *
+             * @param internalId The entity.
+             * @param descendants The internal IDs of the descendants are appended to this, parents before children.
+             */
+            void RemoveSubtree(size_t internalId, std::vector<size_t>& descendants);
+
+            /**
+             * @brief Take an entity out of the hierarchy, turning its children into roots.
+             *
+             */
+            void Detach(size_t internalId);
+
+            /**
+             * @brief Move the components of the members to the front of the pool, in breadth-first order.
+             *
+             * Members without a component in the pool are skipped. The pool is only sorted again if the hierarchy
+             * or the pool has changed since the last call.
+             *
+             * @return For every sorted component, the index of the component of the entity's parent, or NO_PARENT if
+             * the entity is a root or its parent has no component in the pool.
+             */
+            const std::vector<size_t>& Sort(ComponentPoolBase* pool, ComponentType componentType);
+        private:
+            /**
+             * @brief The relationships of one entity.
+             *
+             */
+            struct Node
+            {
+                size_t parent;
+                std::vector<size_t> children;
+            };
+
+            /**
+             * @brief The order a pool was sorted in, and the versions it was sorted for.
+             *
+             */
+            struct SortedPool
+            {
+                std::vector<size_t> parents;
+                size_t hierarchyVersion;
+                size_t poolVersion;
+            };
+
+            /**
+             * @brief Get the node of an entity, creating it if needed.
+             *
+             */
+            Node& GetNode(size_t internalId);
+
+            /**
+             * @brief Take an entity out of the children of its parent.
+             *
+             */
+            void Unparent(size_t internalId);
+
+            /**
+             * @brief Rebuild the breadth-first order of the members if the hierarchy has changed.
+             *
+             */
+            void UpdateOrder();
+
+            /**
+             * @brief The relationships of every member, by internal ID.
+             *
+             */
+            std::unordered_map<size_t, Node> nodes;
+
+            /**
+             * @brief The members in breadth-first order, starting with the roots in order of internal ID.
+             *
+             */
+            std::vector<size_t> order;
+
+            /**
+             * @brief Increased every time the hierarchy changes.
+             *
+             */
+            size_t version;
+            size_t orderVersion;
+
+            /**
+             * @brief The sorted pools, by component type.
+             *
+             */
+            std::unordered_map<ComponentType, SortedPool> sortedPools;
+        };
+    }
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <bitset>
+#include <utility>
+#include <vector>
+#include "config.h"
+#include "entity.h"
+#include "component.h"
+#include "entityobserver.h"
+#include "fieldindex.h"
+#include "entityref.h"
+
+namespace ECS
+{
+    class EntityManager;
+
+    namespace Private
+    {
+        /**
+         * @brief Private type. Owns the field indexes of an entity manager and keeps them up to date.
+         *
+         * The registry observes the entity manager: components are indexed when added or changed and dropped
+         * from the indexes when removed, together with their entity.
+         */
+        class IndexRegistry : public EntityObserver
+        {
+        public:
+            IndexRegistry(EntityManager* entityManager);
+            ~IndexRegistry();
+
+            /**
+             * @brief Take ownership of an index on a component type and index all existing components.
+             *
+             */
+            void Add(ComponentType componentType, FieldIndexBase* index);
+
+            /**
+             * @brief Get the indexes on a component type.
+             *
+             */
+            const std::vector<FieldIndexBase*>& GetIndexes(ComponentType componentType) const;
+
+            /**
+             * @brief Take ownership of a reference index, like Add, and clear its references when their targets are destroyed.
+             *
+             */
+            void AddReferenceIndex(ReferenceIndexBase* index);
+
+            /**
+             * @brief Check if any reference index has been added.
+             *
+             */
+            bool HasReferenceIndexes() const;
+
+            /**
+             * @brief Null all tracked references to an entity.
+             *
+             * @param target The entity that is being destroyed.
+             * @param changed Receives the entity and component type of every cleared reference.
+             */
+            void ClearReferences(Entity target, std::vector<std::pair<Entity, ComponentType>>& changed);
+
+            void EntityCreated(Entity entity);
+            void EntityRemoved(Entity entity);
+            void ComponentAdded(Entity entity, ComponentType componentType);
+            void ComponentRemoved(Entity entity, ComponentType componentType);
+            void ComponentsAdded(Entity entity, const std::bitset<MAX_COMPONENTS>& componentTypes);
+            void ComponentChanged(Entity entity, ComponentType componentType);
+        private:
+            /**
+             * @brief The entity manager whose components are indexed.
+             *
+             */
+            EntityManager* entityManager;
+
+            /**
+             * @brief The indexes by component type.
+             *
+             */
+            std::vector<FieldIndexBase*> indexes[MAX_COMPONENTS];
+
+            /**
+             * @brief The reference indexes, also listed among the indexes of their component types.
+             *
+             */
+            std::vector<ReferenceIndexBase*> referenceIndexes;
+        };
+    }
+}
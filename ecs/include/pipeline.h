@@ -0,0 +1,206 @@
+#pragma once
+
+#include <tuple>
+#include <type_traits>
+#include "system.h"
+#include "entitymanager.h"
+#include "batchsystem.h"
+
+namespace ECS
+{
+    /**
+     * @brief Base class of the stages of a pipeline. The template types are the components the stage works on.
+     *
+     * A stage is a plain class with a non-virtual function Process(Entity entity, Ts*... components), which is
+     * called with the entity's components in the order of the template types. Declare a type const to get
+     * read-only access to it.
+     *
+     * Example: struct Integrate : public PipelineStage<Position, const Velocity>
+     *          { void Process(Entity entity, Position* position, const Velocity* velocity); };
+     */
+    template <typename... Ts>
+    class PipelineStage {};
+
+    /**
+     * @brief A system that runs several stages back to back on every entity, in a single pass over the processing list.
+     *
+     * Running stages A, B and C in one pipeline does the same as running them as separate systems one after
+     * the other, as long as a stage only touches the entity it is given: every entity goes through A, B and C
+     * before the next entity is visited, so its components are fetched while they are still in the cache.
+     * Entities that are removed, disabled or stop matching in one stage are not passed to the later stages.
+     *
+     * The aspect of the pipeline is the union of the component types of its stages, so every stage sees
+     * the same entities. More components can be required or excluded with the usual functions by inheriting.
+     *
+     * Components of the processed types must not be added or destroyed while processing, since that may move
+     * the components passed to the stages.
+     */
+    template <typename... Stages>
+    class Pipeline : public EntitySystem
+    {
+    public:
+        /**
+         * @brief Constructor. Default construct the stages.
+         *
+         */
+        Pipeline();
+
+        /**
+         * @brief Constructor. Copy the given stages.
+         *
+         */
+        Pipeline(const Stages&... stages);
+
+        virtual ~Pipeline() {}
+
+        /**
+         * @brief Get the stage at index I.
+         *
+         */
+        template <size_t I>
+        typename std::tuple_element<I, std::tuple<Stages...>>::type& GetStage();
+
+        /**
+         * @brief Run all stages on one entity.
+         *
+         */
+        void ProcessEntity(Entity entity);
+    protected:
+        /**
+         * @brief Run all stages on every entity in one pass.
+         *
+         */
+        void ProcessEntities();
+    private:
+        static const size_t STAGE_COUNT = sizeof...(Stages);
+
+        /**
+         * @brief Add the component types of a stage to the aspect.
+         *
+         */
+        template <typename... Ts>
+        void RequireStage(PipelineStage<Ts...>*);
+
+        /**
+         * @brief Run all stages on the entity at an index of the processing list.
+         *
+         */
+        template <size_t... Is>
+        void RunStages(size_t index, Private::IndexSequence<Is...>);
+
+        /**
+         * @brief Run all stages on an entity, without checking if it is still processable in between.
+         *
+         */
+        template <size_t... Is>
+        void InvokeStages(Entity entity, size_t internalId, Private::IndexSequence<Is...>);
+
+        /**
+         * @brief Run one stage on the entity at an index of the processing list, if it is still processable.
+         *
+         */
+        template <typename Stage>
+        void RunStage(Stage& stage, size_t index);
+
+        /**
+         * @brief Call the stage with the components of the entity.
+         *
+         */
+        template <typename Stage, typename... Ts>
+        void Invoke(Stage& stage, Entity entity, size_t internalId, PipelineStage<Ts...>*);
+
+        /**
+         * @brief The stages, in the order they are run.
+         *
+         */
+        std::tuple<Stages...> stages;
+    };
+
+
+    // IMPLEMENTATION
+
+    template <typename... Stages>
+    Pipeline<Stages...>::Pipeline()
+    {
+        static_assert(STAGE_COUNT > 0, "A pipeline needs at least one stage");
+
+        int expand[] = { 0, (RequireStage(static_cast<Stages*>(nullptr)), 0)... };
+        (void)expand;
+    }
+
+    template <typename... Stages>
+    Pipeline<Stages...>::Pipeline(const Stages&... stages) : stages(stages...)
+    {
+        static_assert(STAGE_COUNT > 0, "A pipeline needs at least one stage");
+
+        int expand[] = { 0, (RequireStage(static_cast<Stages*>(nullptr)), 0)... };
+        (void)expand;
+    }
+
+    template <typename... Stages>
+    template <size_t I>
+    typename std::tuple_element<I, std::tuple<Stages...>>::type& Pipeline<Stages...>::GetStage()
+    {
+        return std::get<I>(stages);
+    }
+
+    template <typename... Stages>
+    void Pipeline<Stages...>::ProcessEntity(Entity entity)
+    {
+        EntityManager* entityManager = GetEntityManager();
+        assert(entityManager != nullptr);
+
+        size_t internalId = entityManager->GetInternalId(entity);
+        InvokeStages(entity, internalId, typename Private::MakeIndexSequence<STAGE_COUNT>::Type());
+    }
+
+    template <typename... Stages>
+    void Pipeline<Stages...>::ProcessEntities()
+    {
+        // The enabled part of the list does not move while processing, so the count stays the same.
+        size_t count = GetEnabledEntityCount();
+        for (size_t i = 0; i < count; ++i)
+            RunStages(i, typename Private::MakeIndexSequence<STAGE_COUNT>::Type());
+    }
+
+    template <typename... Stages>
+    template <typename... Ts>
+    void Pipeline<Stages...>::RequireStage(PipelineStage<Ts...>*)
+    {
+        int expand[] = { 0, (Require<typename std::remove_const<Ts>::type>(), 0)... };
+        (void)expand;
+    }
+
+    template <typename... Stages>
+    template <size_t... Is>
+    void Pipeline<Stages...>::RunStages(size_t index, Private::IndexSequence<Is...>)
+    {
+        // Braced initializers are evaluated in order, so the stages run in order.
+        int expand[] = { 0, (RunStage(std::get<Is>(stages), index), 0)... };
+        (void)expand;
+    }
+
+    template <typename... Stages>
+    template <size_t... Is>
+    void Pipeline<Stages...>::InvokeStages(Entity entity, size_t internalId, Private::IndexSequence<Is...>)
+    {
+        int expand[] = { 0, (Invoke(std::get<Is>(stages), entity, internalId, &std::get<Is>(stages)), 0)... };
+        (void)expand;
+    }
+
+    template <typename... Stages>
+    template <typename Stage>
+    void Pipeline<Stages...>::RunStage(Stage& stage, size_t index)
+    {
+        if (IsProcessable(index))
+            Invoke(stage, GetEntities()[index], GetInternalIds()[index], &stage);
+    }
+
+    template <typename... Stages>
+    template <typename Stage, typename... Ts>
+    void Pipeline<Stages...>::Invoke(Stage& stage, Entity entity, size_t internalId, PipelineStage<Ts...>*)
+    {
+        EntityManager* entityManager = GetEntityManager();
+        stage.Process(entity, entityManager->GetPool<typename std::remove_const<Ts>::type>()->Get(internalId)...);
+    }
+}
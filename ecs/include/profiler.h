@@ -0,0 +1,158 @@
+#pragma once
+
+#include <cstdint>
+#include <chrono>
+#include <unordered_map>
+
+namespace ECS
+{
+    /**
+     * @brief Measurements of a profiled section, summed over all calls.
+     *
+     */
+    struct ProfileStatistics
+    {
+        /**
+         * @brief The hardware counters that are read. Not all of them may be available; see Profiler::IsAvailable.
+         *
+         */
+        enum Counter
+        {
+            CYCLES,
+            INSTRUCTIONS,
+            L1_MISSES,
+            LLC_MISSES,
+            BRANCH_MISSES,
+            COUNTER_COUNT
+        };
+
+        ProfileStatistics();
+
+        uint64_t calls;
+        uint64_t nanoseconds;
+        uint64_t counters[COUNTER_COUNT];
+    };
+
+    /**
+     * @brief Measures wall time and hardware performance counters of entity systems and entity managers.
+     *
+     * Set a profiler on a SystemManager or EntityManager to measure every call to EntitySystem::Process or
+     * EntityManager::DestroyRemoved. The measurements are summed per section (the system or entity manager)
+     * per frame, and over the lifetime of the profiler. Call NextFrame once per frame.
+     *
+     * On Linux, the counters are read with perf_event_open. They count the thread that created the profiler,
+     * in user space only, so the profiled calls must be made on that thread. Counters that cannot be opened,
+     * for example because of perf_event_paranoid or missing hardware support, read as zero and only the wall
+     * time and number of calls are recorded. Other platforms only record the wall time.
+     */
+    class Profiler
+    {
+    public:
+        /**
+         * @brief A reading of the clock and counters, taken at the start of a section.
+         *
+         */
+        struct Sample
+        {
+            std::chrono::steady_clock::time_point time;
+            uint64_t counters[ProfileStatistics::COUNTER_COUNT];
+            uint64_t enabled;
+            uint64_t running;
+        };
+
+        /**
+         * @brief Constructor. Open the counters for the calling thread.
+         *
+         */
+        Profiler();
+        ~Profiler();
+
+        /**
+         * @brief Check if a counter could be opened.
+         *
+         */
+        bool IsAvailable(ProfileStatistics::Counter counter) const;
+
+        /**
+         * @brief Read the clock and counters.
+         *
+         */
+        void Read(Sample& sample) const;
+
+        /**
+         * @brief Add the time and counts since a sample to the statistics of a section.
+         *
+         * @param section Identifies the section, e.g. the profiled system.
+         * @param begin A sample read at the start of the section.
+         */
+        void Record(const void* section, const Sample& begin);
+
+        /**
+         * @brief Finish the current frame.
+         *
+         * The statistics of the finished frame can be read with GetFrameStatistics until the next call.
+         */
+        void NextFrame();
+
+        /**
+         * @brief Get the number of finished frames.
+         *
+         */
+        size_t GetFrameCount() const;
+
+        /**
+         * @brief Get the statistics of a section in the last finished frame.
+         *
+         * @return The statistics, all zero if the section was not recorded in that frame.
+         */
+        ProfileStatistics GetFrameStatistics(const void* section) const;
+
+        /**
+         * @brief Get the statistics of a section over all frames, including the current one.
+         *
+         */
+        ProfileStatistics GetTotalStatistics(const void* section) const;
+    private:
+        Profiler(const Profiler&);
+        Profiler& operator=(const Profiler&);
+
+        /**
+         * @brief Find the statistics of a section in a map, or all zeros.
+         *
+         */
+        static ProfileStatistics Find(const std::unordered_map<const void*, ProfileStatistics>& statistics, const void* section);
+
+        /**
+         * @brief The file descriptor of the group leader, or -1 if no counter is available.
+         *
+         */
+        int leader;
+
+        /**
+         * @brief The file descriptor of every counter, or -1 if it is not available.
+         *
+         */
+        int descriptors[ProfileStatistics::COUNTER_COUNT];
+
+        /**
+         * @brief The position of every available counter in a group read.
+         *
+         */
+        size_t positions[ProfileStatistics::COUNTER_COUNT];
+
+        /**
+         * @brief The number of available counters.
+         *
+         */
+        size_t openCount;
+
+        /**
+         * @brief The statistics of the current and last frame, and over all frames.
+         *
+         */
+        std::unordered_map<const void*, ProfileStatistics> currentFrame;
+        std::unordered_map<const void*, ProfileStatistics> lastFrame;
+        std::unordered_map<const void*, ProfileStatistics> total;
+        size_t frameCount;
+    };
+}
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <bitset>
+#include <vector>
+#include <unordered_map>
+#include "config.h"
+#include "entity.h"
+#include "component.h"
+#include "entityobserver.h"
+
+namespace ECS
+{
+    class EntityManager;
+
+    namespace Private
+    {
+        /**
+         * @brief Private type. Caches the results of ad-hoc queries for entities by component mask.
+         *
+         * The cache observes the entity manager and updates every cached result as entities and components
+         * are added and removed, so a repeated query costs nothing beyond reading its result. A result that has
+         * not been asked for in QUERY_EVICTION_AGE ticks is evicted.
+         */
+        class QueryCache : public EntityObserver
+        {
+        public:
+            QueryCache(EntityManager* entityManager);
+            ~QueryCache();
+
+            /**
+             * @brief Get the active entities having all components in the mask, computing the result if it is not cached.
+             *
+             * @return The entities, in no particular order. The reference is valid until the result is evicted.
+             */
+            const std::vector<Entity>& Get(const std::bitset<MAX_COMPONENTS>& mask);
+
+            /**
+             * @brief Advance the age of the cache and evict the results that have not been used for too long.
+             *
+             */
+            void Tick();
+
+            /**
+             * @brief Get the number of cached results.
+             *
+             */
+            size_t GetQueryCount() const;
+
+            void EntityCreated(Entity entity);
+            void EntityRemoved(Entity entity);
+            void ComponentAdded(Entity entity, ComponentType componentType);
+            void ComponentRemoved(Entity entity, ComponentType componentType);
+            void ComponentsAdded(Entity entity, const std::bitset<MAX_COMPONENTS>& componentTypes);
+        private:
+            /**
+             * @brief The result of one query.
+             *
+             */
+            struct CachedQuery
+            {
+                /**
+                 * @brief The matching entities.
+                 *
+                 */
+                std::vector<Entity> entities;
+
+                /**
+                 * @brief The index of every matching entity in the entities list.
+                 *
+                 */
+                std::unordered_map<Entity, size_t> indices;
+
+                /**
+                 * @brief The age of the cache when the result was last asked for.
+                 *
+                 */
+                size_t lastUsed;
+            };
+
+            /**
+             * @brief Update the results whose masks include any of the changed component types.
+             *
+             */
+            void Update(Entity entity, const std::bitset<MAX_COMPONENTS>& changed);
+
+            /**
+             * @brief Add an entity to a result, or remove it.
+             *
+             */
+            static void Insert(CachedQuery* query, Entity entity);
+            static void Erase(CachedQuery* query, Entity entity);
+
+            /**
+             * @brief The entity manager whose entities are queried.
+             *
+             */
+            EntityManager* entityManager;
+
+            /**
+             * @brief The cached results by mask.
+             *
+             */
+            std::unordered_map<std::bitset<MAX_COMPONENTS>, CachedQuery*> queries;
+
+            /**
+             * @brief Increased every tick.
+             *
+             */
+            size_t age;
+        };
+    }
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <vector>
+#include "system.h"
+
+namespace ECS
+{
+    /**
+     * @brief A system that reacts to entities starting or stopping to match its aspect.
+     *
+     * Instead of visiting every matching entity, Process hands the system the entities whose matching
+     * status changed since the last call. The changes are recorded by the system manager as they happen, so
+     * processing costs O(changes) rather than O(matched entities).
+     *
+     * The lists are deduplicated: an entity that starts matching and stops again between two calls is
+     * not reported at all, and an entity is never reported more than once per call.
+     *
+     */
+    class ReactiveSystem : public EntitySystem
+    {
+    public:
+        virtual ~ReactiveSystem();
+
+        /**
+         * @brief Process the entities that started matching the aspect since the last call.
+         *
+         * Not called if there are no such entities.
+         *
+         * @param entities The entities, in increasing UUID order.
+         */
+        virtual void ProcessEntered(const std::vector<Entity>& entities) = 0;
+
+        /**
+         * @brief Process the entities that stopped matching the aspect since the last call.
+         *
+         * Not called if there are no such entities. The entities may have been removed, and their components
+         * are destroyed as usual when the entity manager destroys removed entities and components.
+         *
+         * @param entities The entities, in increasing UUID order.
+         */
+        virtual void ProcessExited(const std::vector<Entity>& entities) = 0;
+    protected:
+        /**
+         * @brief Collapse the recorded changes and call ProcessExited and ProcessEntered.
+         *
+         */
+        void ProcessEntities();
+    private:
+        /**
+         * @brief A recorded change of an entity's matching status.
+         *
+         */
+        struct Change
+        {
+            Entity entity;
+            bool matched;
+
+            Change(Entity entity, bool matched);
+            bool operator<(const Change& rhs) const;
+        };
+
+        /**
+         * @brief Not used; reactive systems do not visit every matching entity.
+         *
+         */
+        void ProcessEntity(Entity entity);
+
+        /**
+         * @brief Record a change of an entity's matching status.
+         *
+         */
+        void MembershipChanged(Entity entity, bool matched);
+
+        /**
+         * @brief The changes recorded since the last call to Process, in the order they happened.
+         *
+         */
+        std::vector<Change> changes;
+
+        /**
+         * @brief Scratch lists handed to ProcessEntered and ProcessExited. Kept to reuse their memory.
+         *
+         */
+        std::vector<Entity> entered;
+        std::vector<Entity> exited;
+    };
+}
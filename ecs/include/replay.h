@@ -0,0 +1,115 @@
+#pragma once
+
+#include <cstdint>
+#include <bitset>
+#include <vector>
+#include <unordered_map>
+#include "config.h"
+#include "entity.h"
+#include "component.h"
+#include "trace.h"
+
+namespace ECS
+{
+    /**
+     * @brief The storage a trace is replayed against.
+     *
+     * Implement this to replay traces against an entity manager or any other storage. Component types and
+     * systems are declared before they are used. Entities are the ones returned by CreateEntity.
+     */
+    class ReplayTarget
+    {
+    public:
+        virtual ~ReplayTarget() {}
+
+        /**
+         * @brief A component type with the given size in bytes is used in the trace.
+         *
+         */
+        virtual void DeclareComponent(ComponentType componentType, size_t size) = 0;
+
+        /**
+         * @brief A system with the given masks is used in the trace.
+         *
+         */
+        virtual void DeclareSystem(size_t system, const std::bitset<MAX_COMPONENTS>& aspect, const std::bitset<MAX_COMPONENTS>& exclude, const std::bitset<MAX_COMPONENTS>& anyOf) = 0;
+
+        virtual Entity CreateEntity() = 0;
+        virtual void RemoveEntity(Entity entity) = 0;
+        virtual void AddComponent(Entity entity, ComponentType componentType) = 0;
+        virtual void RemoveComponent(Entity entity, ComponentType componentType) = 0;
+        virtual void DestroyRemoved() = 0;
+        virtual void Process(size_t system) = 0;
+    };
+
+    /**
+     * @brief Replays a trace against a target and measures the latency of every operation.
+     *
+     * Declarations are passed on but not measured.
+     */
+    class TraceReplayer
+    {
+    public:
+        TraceReplayer();
+
+        /**
+         * @brief Replay all operations of a trace.
+         *
+         * Latencies are added to the ones of earlier replays.
+         *
+         * @return False if the trace is malformed or refers to entities that were not created in it.
+         */
+        bool Replay(TraceReader& reader, ReplayTarget& target);
+
+        /**
+         * @brief Get the number of replayed operations of a type.
+         *
+         */
+        size_t GetCount(TraceOperation::Type type) const;
+
+        /**
+         * @brief Get the total time spent in operations of a type.
+         *
+         */
+        uint64_t GetTotalNanoseconds(TraceOperation::Type type) const;
+
+        /**
+         * @brief Get a latency percentile of the operations of a type.
+         *
+         * @param percentile Between 0 and 100; 100 is the slowest operation.
+         * @return The latency in nanoseconds, or 0 if no operation of the type was replayed.
+         */
+        uint64_t GetPercentile(TraceOperation::Type type, double percentile);
+
+        /**
+         * @brief Get the name of an operation type.
+         *
+         */
+        static const char* GetName(TraceOperation::Type type);
+    private:
+        /**
+         * @brief The latency of every replayed operation, by type.
+         *
+         */
+        std::vector<uint64_t> latencies[TraceOperation::TYPE_COUNT];
+
+        /**
+         * @brief Whether the latencies of a type are sorted.
+         *
+         */
+        bool sorted[TraceOperation::TYPE_COUNT];
+
+        /**
+         * @brief Maps the entities of the trace to the entities of the target.
+         *
+         * Removed entities stay mapped until they are destroyed, since components may still be removed from them.
+         */
+        std::unordered_map<Entity, Entity> entities;
+
+        /**
+         * @brief The entities of the trace that were removed since the last DestroyRemoved.
+         *
+         */
+        std::vector<Entity> removedEntities;
+    };
+}
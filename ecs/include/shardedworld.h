@@ -0,0 +1,110 @@
+#pragma once
+
+#include <vector>
+#include <unordered_map>
+#include "config.h"
+#include "entity.h"
+#include "entitymanager.h"
+#include "systemmanager.h"
+
+namespace ECS
+{
+    /**
+     * @brief A world split into several shards, each with its own entity manager and system manager.
+     *
+     * The shards share one UUID space: shard i hands out the UUIDs i, i + n, i + 2n and so on, where n is the
+     * number of shards, so shards can create entities at the same time without coordinating. Shards are fully
+     * independent of each other and can be processed on different threads.
+     *
+     * Entities are moved between shards with Migrate, which keeps their UUIDs. Resolve finds the shard an entity
+     * lives in. Migrating, resolving and DestroyRemoved must not run while any shard is being processed.
+     */
+    class ShardedWorld
+    {
+    public:
+        /**
+         * @brief Returned by Resolve for entities that do not exist in any shard.
+         *
+         */
+        static const size_t INVALID_SHARD;
+
+        /**
+         * @brief Constructor. Creates the shards.
+         *
+         * @param shardCount The number of shards.
+         * @param reservedEntityCount How many entities every shard reserves memory for to start with.
+         */
+        ShardedWorld(size_t shardCount, size_t reservedEntityCount = RESERVED_ENTITY_COUNT);
+
+        /**
+         * @brief Destructor. Deletes all shards and their systems.
+         *
+         */
+        ~ShardedWorld();
+
+        /**
+         * @brief Get the number of shards.
+         *
+         */
+        size_t GetShardCount() const;
+
+        /**
+         * @brief Get the entity manager of a shard.
+         *
+         */
+        EntityManager* GetEntityManager(size_t shard);
+
+        /**
+         * @brief Get the system manager of a shard.
+         *
+         */
+        SystemManager* GetSystemManager(size_t shard);
+
+        /**
+         * @brief Find the shard an entity lives in.
+         *
+         * @return The shard index, or INVALID_SHARD if the entity has been destroyed or never existed.
+         */
+        size_t Resolve(Entity entity) const;
+
+        /**
+         * @brief Move entities with all their components from one shard to another.
+         *
+         * The entities keep their UUIDs. They are removed from the systems of the source shard and matched against
+         * the systems of the target shard. Removed entities cannot be migrated.
+         *
+         * @param entities The entities to move. They must all live in the source shard.
+         * @param from The source shard.
+         * @param to The target shard.
+         */
+        void Migrate(const std::vector<Entity>& entities, size_t from, size_t to);
+
+        /**
+         * @brief Destroy the removed entities and components of all shards.
+         *
+         */
+        void DestroyRemoved();
+    private:
+        ShardedWorld(const ShardedWorld&);
+        ShardedWorld& operator=(const ShardedWorld&);
+
+        /**
+         * @brief Get the shard that created an entity.
+         *
+         */
+        size_t GetHomeShard(Entity entity) const;
+
+        /**
+         * @brief The entity manager and system manager of every shard.
+         *
+         */
+        std::vector<EntityManager*> entityManagers;
+        std::vector<SystemManager*> systemManagers;
+
+        /**
+         * @brief The current shard of every entity that does not live in the shard that created it.
+         *
+         */
+        std::unordered_map<Entity, size_t> migrated;
+    };
+}
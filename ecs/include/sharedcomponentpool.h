@@ -0,0 +1,336 @@
+#pragma once
+
+#include <cassert>
+#include <map>
+#include <vector>
+#include "componentpool.h"
+
+namespace ECS
+{
+    namespace Private
+    {
+        /**
+         * @brief Private type. Stores components of type T that are shared between entities.
+         *
+         * Every distinct value is stored once, together with the list of entities referencing it. Adding a
+         * value that is equal to a stored one (compared with operator<) references the stored value instead of
+         * copying it. A value is destroyed when the last entity referencing it loses the component.
+         *
+         * The entities referencing a value form a group, so that they can be processed together.
+         */
+        template <typename T>
+        class SharedComponentPool : public ComponentPoolBase
+        {
+        public:
+            SharedComponentPool(size_t reservedCount);
+            ~SharedComponentPool();
+
+            /**
+             * @brief Make the entity reference a value equal to the given one.
+             *
+             * If the entity already references a value, that reference is dropped first.
+             *
+             * @return The shared value. The pointer is valid as long as any entity references it.
+             */
+            const T* Set(size_t internalId, const T& value);
+
+            /**
+             * @brief Get the value referenced by the entity.
+             *
+             * @return The shared value or nullptr if the entity has no component in this pool.
+             */
+            const T* Get(size_t internalId) const;
+
+            size_t GetComponentSize() const;
+            void Remove(size_t internalId);
+
+            /**
+             * @brief Make a batch of entities reference the same value as another entity.
+             *
+             */
+            void Clone(size_t sourceId, const size_t* targetIds, size_t count);
+
+            ComponentPoolBase* CreateEmpty(size_t reservedCount) const;
+
+            /**
+             * @brief Make an entity in another pool reference a value equal to the entity's, and drop its reference here.
+             *
+             */
+            void Transfer(size_t internalId, ComponentPoolBase* target, size_t targetId);
+
+            void Swap(size_t first, size_t second);
+
+            /**
+             * @brief Get the number of distinct values stored.
+             *
+             */
+            size_t GetValueCount() const;
+
+            /**
+             * @brief Call a function for every stored value and the internal IDs of the entities referencing it.
+             *
+             * The function is called as function(const T& value, const std::vector<size_t>& internalIds).
+             */
+            template <typename Function>
+            void ForEachGroup(Function function) const;
+        private:
+            /**
+             * @brief A stored value and the entities referencing it.
+             *
+             * The number of members is the reference count of the value.
+             */
+            struct SharedValue
+            {
+                T value;
+                std::vector<size_t> members;
+
+                SharedValue(const T& value) : value(value) {}
+            };
+
+            /**
+             * @brief Orders stored values by the values they point to.
+             *
+             */
+            struct ValueLess
+            {
+                bool operator()(const T* lhs, const T* rhs) const { return *lhs < *rhs; }
+            };
+
+            /**
+             * @brief Find or create the slot of a value equal to the given one.
+             *
+             */
+            size_t Acquire(const T& value);
+
+            /**
+             * @brief Add an entity to the members of a slot and link it in the pool.
+             *
+             */
+            void Reference(size_t internalId, size_t slot);
+
+            /**
+             * @brief Remove the entity at a dense index from the members of its slot, destroying the value if it
+             * was the last member.
+             *
+             */
+            void Release(size_t index);
+
+            /**
+             * @brief The stored values, indexed by slot. Free slots are null.
+             *
+             */
+            std::vector<SharedValue*> values;
+
+            /**
+             * @brief Slots that are free to reuse.
+             *
+             */
+            std::vector<size_t> freeSlots;
+
+            /**
+             * @brief Finds the slot of a stored value.
+             *
+             */
+            std::map<const T*, size_t, ValueLess> lookup;
+
+            /**
+             * @brief The slot referenced by each entity, in the same order as the dense array.
+             *
+             */
+            std::vector<size_t> slots;
+
+            /**
+             * @brief The position of each entity among the members of its slot, in the same order as the dense array.
+             *
+             */
+            std::vector<size_t> positions;
+        };
+
+
+        // IMPLEMENTATION
+
+        template <typename T>
+        SharedComponentPool<T>::SharedComponentPool(size_t reservedCount)
+        {
+            sparse.reserve(reservedCount);
+            dense.reserve(reservedCount);
+            slots.reserve(reservedCount);
+            positions.reserve(reservedCount);
+        }
+
+        template <typename T>
+        SharedComponentPool<T>::~SharedComponentPool()
+        {
+            for (auto value : values)
+                delete value;
+        }
+
+        template <typename T>
+        const T* SharedComponentPool<T>::Set(size_t internalId, const T& value)
+        {
+            // Acquire before releasing, so that setting the same value again does not destroy it.
+            size_t slot = Acquire(value);
+
+            size_t index = IndexOf(internalId);
+            if (index != INVALID_INDEX)
+            {
+                if (slots[index] == slot)
+                    return &values[slot]->value;
+
+                Remove(internalId);
+            }
+
+            Reference(internalId, slot);
+            return &values[slot]->value;
+        }
+
+        template <typename T>
+        const T* SharedComponentPool<T>::Get(size_t internalId) const
+        {
+            size_t index = IndexOf(internalId);
+            if (index == INVALID_INDEX)
+                return nullptr;
+
+            return &values[slots[index]]->value;
+        }
+
+        template <typename T>
+        size_t SharedComponentPool<T>::GetComponentSize() const
+        {
+            return sizeof(T);
+        }
+
+        template <typename T>
+        void SharedComponentPool<T>::Remove(size_t internalId)
+        {
+            size_t index = IndexOf(internalId);
+            if (index == INVALID_INDEX)
+                return;
+
+            Release(index);
+
+            // Move the last entity into the hole, like the dense array does.
+            slots[index] = slots.back();
+            positions[index] = positions.back();
+            slots.pop_back();
+            positions.pop_back();
+            Unlink(internalId);
+        }
+
+        template <typename T>
+        void SharedComponentPool<T>::Clone(size_t sourceId, const size_t* targetIds, size_t count)
+        {
+            size_t sourceIndex = IndexOf(sourceId);
+            assert(sourceIndex != INVALID_INDEX);
+
+            size_t slot = slots[sourceIndex];
+            values[slot]->members.reserve(values[slot]->members.size() + count);
+            for (size_t i = 0; i < count; ++i)
+            {
+                assert(!Has(targetIds[i]));
+                Reference(targetIds[i], slot);
+            }
+        }
+
+        template <typename T>
+        ComponentPoolBase* SharedComponentPool<T>::CreateEmpty(size_t reservedCount) const
+        {
+            return new SharedComponentPool<T>(reservedCount);
+        }
+
+        template <typename T>
+        void SharedComponentPool<T>::Transfer(size_t internalId, ComponentPoolBase* target, size_t targetId)
+        {
+            const T* value = Get(internalId);
+            assert(value != nullptr);
+
+            static_cast<SharedComponentPool<T>*>(target)->Set(targetId, *value);
+            Remove(internalId);
+        }
+
+        template <typename T>
+        void SharedComponentPool<T>::Swap(size_t first, size_t second)
+        {
+            if (first == second)
+                return;
+
+            // The members of a value are internal IDs, so they are not affected.
+            std::swap(slots[first], slots[second]);
+            std::swap(positions[first], positions[second]);
+            SwapLinks(first, second);
+        }
+
+        template <typename T>
+        size_t SharedComponentPool<T>::GetValueCount() const
+        {
+            return lookup.size();
+        }
+
+        template <typename T>
+        template <typename Function>
+        void SharedComponentPool<T>::ForEachGroup(Function function) const
+        {
+            for (auto value : values)
+            {
+                if (value != nullptr)
+                    function(static_cast<const T&>(value->value), static_cast<const std::vector<size_t>&>(value->members));
+            }
+        }
+
+        template <typename T>
+        size_t SharedComponentPool<T>::Acquire(const T& value)
+        {
+            auto it = lookup.find(&value);
+            if (it != lookup.end())
+                return it->second;
+
+            size_t slot;
+            if (freeSlots.empty())
+            {
+                slot = values.size();
+                values.push_back(nullptr);
+            }
+            else
+            {
+                slot = freeSlots.back();
+                freeSlots.pop_back();
+            }
+
+            values[slot] = new SharedValue(value);
+            lookup.insert(std::make_pair(&values[slot]->value, slot));
+            return slot;
+        }
+
+        template <typename T>
+        void SharedComponentPool<T>::Reference(size_t internalId, size_t slot)
+        {
+            std::vector<size_t>& members = values[slot]->members;
+            slots.push_back(slot);
+            positions.push_back(members.size());
+            members.push_back(internalId);
+            Link(internalId);
+        }
+
+        template <typename T>
+        void SharedComponentPool<T>::Release(size_t index)
+        {
+            size_t slot = slots[index];
+            std::vector<size_t>& members = values[slot]->members;
+
+            // Move the last member of the group into the hole.
+            size_t position = positions[index];
+            size_t moved = members.back();
+            members[position] = moved;
+            positions[IndexOf(moved)] = position;
+            members.pop_back();
+
+            if (members.empty())
+            {
+                lookup.erase(&values[slot]->value);
+                delete values[slot];
+                values[slot] = nullptr;
+                freeSlots.push_back(slot);
+            }
+        }
+    }
+}
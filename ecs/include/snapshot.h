@@ -0,0 +1,244 @@
+#pragma once
+
+#include <cassert>
+#include <atomic>
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include "entity.h"
+#include "componentpool.h"
+
+namespace ECS
+{
+    namespace Private
+    {
+        /**
+         * @brief Private type. Lets the entity manager publish snapshots without knowing their component type.
+         *
+         */
+        class SnapshotPublisherBase
+        {
+        public:
+            virtual ~SnapshotPublisherBase() {}
+
+            /**
+             * @brief Copy the components in a pool into a new snapshot and hand it to the reader.
+             *
+             * @param pool The pool to copy, which must be a plain ComponentPool of the reader's type. May be null if no
+             * component of the type has been added yet.
+             * @param entities The entity list of the entity manager, to translate internal IDs to UUIDs.
+             * @param frame The number of the published frame.
+             */
+            virtual void Publish(ComponentPoolBase* pool, const Column<InternalEntity>& entities, size_t frame) = 0;
+        };
+    }
+
+    /**
+     * @brief A copy of all components of type T taken at a frame boundary.
+     *
+     */
+    template <typename T>
+    class Snapshot
+    {
+        template <typename U> friend class SnapshotReader;
+    public:
+        Snapshot();
+
+        /**
+         * @brief Get the number of the frame the snapshot was taken at. Frames are numbered from 1; 0 means empty.
+         *
+         */
+        size_t GetFrame() const;
+
+        /**
+         * @brief Get the number of components in the snapshot.
+         *
+         */
+        size_t Size() const;
+
+        /**
+         * @brief Get the entity owning the component at an index.
+         *
+         */
+        Entity GetEntity(size_t index) const;
+
+        /**
+         * @brief Get the component at an index.
+         *
+         */
+        const T& GetComponent(size_t index) const;
+
+        /**
+         * @brief Find the component of an entity.
+         *
+         * @return The component or nullptr if the entity had no component of type T at the time.
+         */
+        const T* Find(Entity entity) const;
+    private:
+        /**
+         * @brief The entities and their components, in storage order.
+         *
+         */
+        std::vector<Entity> entities;
+        std::vector<T> components;
+
+        /**
+         * @brief (Entity, index) pairs sorted by entity, used by Find.
+         *
+         */
+        std::vector<std::pair<Entity, size_t>> lookup;
+
+        size_t frame;
+    };
+
+    /**
+     * @brief Gives one reader thread lock-free access to the latest published snapshot of component type T.
+     *
+     * Create readers with EntityManager::CreateSnapshotReader and publish with EntityManager::PublishSnapshots.
+     * Every reader is triple buffered: the entity manager writes the next snapshot into one buffer while the reader
+     * holds another, and the third holds the latest published snapshot waiting to be picked up. Neither side ever
+     * waits for the other, so the simulation of frame N + 1 can overlap with the reader working on frame N.
+     *
+     * A reader must only be used by one thread. Give every reader thread its own reader.
+     */
+    template <typename T>
+    class SnapshotReader : public Private::SnapshotPublisherBase
+    {
+        friend class EntityManager;
+    public:
+        /**
+         * @brief Get the latest published snapshot.
+         *
+         * @return The snapshot. It stays unchanged until the next call to Read.
+         */
+        const Snapshot<T>& Read();
+
+        void Publish(Private::ComponentPoolBase* pool, const Private::Column<Private::InternalEntity>& entities, size_t frame);
+    private:
+        /**
+         * @brief Set on the ready index when it holds a snapshot the reader has not picked up yet.
+         *
+         */
+        static const unsigned int FRESH = 4;
+
+        /**
+         * @brief Private constructor. Readers are created by the entity manager.
+         *
+         */
+        SnapshotReader();
+        SnapshotReader(const SnapshotReader&);
+        SnapshotReader& operator=(const SnapshotReader&);
+
+        Snapshot<T> buffers[3];
+
+        /**
+         * @brief The buffer written by the entity manager.
+         *
+         */
+        unsigned int writing;
+
+        /**
+         * @brief The buffer handed out to the reader.
+         *
+         */
+        unsigned int reading;
+
+        /**
+         * @brief The buffer holding the latest published snapshot, possibly marked FRESH.
+         *
+         */
+        std::atomic<unsigned int> ready;
+    };
+
+
+    // IMPLEMENTATION
+
+    template <typename T>
+    Snapshot<T>::Snapshot()
+    {
+        frame = 0;
+    }
+
+    template <typename T>
+    size_t Snapshot<T>::GetFrame() const
+    {
+        return frame;
+    }
+
+    template <typename T>
+    size_t Snapshot<T>::Size() const
+    {
+        return entities.size();
+    }
+
+    template <typename T>
+    Entity Snapshot<T>::GetEntity(size_t index) const
+    {
+        assert(index < entities.size());
+        return entities[index];
+    }
+
+    template <typename T>
+    const T& Snapshot<T>::GetComponent(size_t index) const
+    {
+        assert(index < components.size());
+        return components[index];
+    }
+
+    template <typename T>
+    const T* Snapshot<T>::Find(Entity entity) const
+    {
+        auto it = std::lower_bound(lookup.begin(), lookup.end(), std::make_pair(entity, static_cast<size_t>(0)));
+        if (it == lookup.end() || it->first != entity)
+            return nullptr;
+
+        return &components[it->second];
+    }
+
+    template <typename T>
+    SnapshotReader<T>::SnapshotReader()
+    {
+        writing = 0;
+        reading = 1;
+        ready = 2;
+    }
+
+    template <typename T>
+    const Snapshot<T>& SnapshotReader<T>::Read()
+    {
+        if (ready.load(std::memory_order_relaxed) & FRESH)
+            reading = ready.exchange(reading, std::memory_order_acq_rel) & ~FRESH;
+
+        return buffers[reading];
+    }
+
+    template <typename T>
+    void SnapshotReader<T>::Publish(Private::ComponentPoolBase* pool, const Private::Column<Private::InternalEntity>& entities, size_t frame)
+    {
+        // Reuse the memory of the buffer; after the first few frames nothing is allocated.
+        Snapshot<T>& snapshot = buffers[writing];
+        snapshot.entities.clear();
+        snapshot.components.clear();
+        snapshot.lookup.clear();
+        snapshot.frame = frame;
+
+        if (pool != nullptr)
+        {
+            // Prefabs are not part of the world, so they are left out.
+            const T* data = static_cast<Private::ComponentPool<T>*>(pool)->GetData();
+            for (size_t i = 0; i < pool->Size(); ++i)
+            {
+                const Private::InternalEntity& internalEntity = entities[pool->GetInternalId(i)];
+                if (internalEntity.prefab)
+                    continue;
+
+                snapshot.lookup.push_back(std::make_pair(internalEntity.entity, snapshot.entities.size()));
+                snapshot.entities.push_back(internalEntity.entity);
+                snapshot.components.push_back(data[i]);
+            }
+            std::sort(snapshot.lookup.begin(), snapshot.lookup.end());
+        }
+
+        writing = ready.exchange(writing | FRESH, std::memory_order_acq_rel) & ~FRESH;
+    }
+}
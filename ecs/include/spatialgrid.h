@@ -0,0 +1,409 @@
+#pragma once
+
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include "entity.h"
+#include "component.h"
+#include "entityobserver.h"
+#include "entitymanager.h"
+
+namespace ECS
+{
+    /**
+     * @brief A uniform grid over the entities with a position component of type T, for proximity queries.
+     *
+     * The grid divides space into cubic cells and stores every entity in the cell containing its position, together
+     * with a copy of the position. Queries only visit the cells overlapping the query volume.
+     *
+     * In incremental mode the grid observes the entity manager: entities are inserted when they get a T, moved when
+     * NotifyComponentChanged<T> is called for them, and dropped when they lose it. Writing to a component does not
+     * move the entity by itself. In bulk mode the grid ignores individual changes and is rebuilt from scratch with
+     * Rebuild, which is cheaper when most entities move every frame.
+     *
+     * For 2D worlds, return the same z for every position.
+     */
+    template <typename T>
+    class SpatialGrid : private EntityObserver
+    {
+    public:
+        /**
+         * @brief A position in space.
+         *
+         */
+        struct Point
+        {
+            float x;
+            float y;
+            float z;
+        };
+
+        /**
+         * @brief Extracts the position from a component.
+         *
+         */
+        typedef Point (*PositionFunction)(const T& component);
+
+        /**
+         * @brief How the grid is kept up to date.
+         *
+         */
+        enum Mode
+        {
+            INCREMENTAL,
+            BULK
+        };
+
+        /**
+         * @brief Constructor. Builds the grid from the existing entities.
+         *
+         * @param entityManager The entity manager whose entities are indexed. It must outlive the grid.
+         * @param cellSize The edge length of a cell. Queries are fastest when it is close to the typical query radius.
+         * @param position Extracts the position from a component.
+         * @param mode How the grid is kept up to date.
+         */
+        SpatialGrid(EntityManager* entityManager, float cellSize, PositionFunction position, Mode mode = INCREMENTAL);
+
+        /**
+         * @brief Destructor. Stops observing the entity manager.
+         *
+         */
+        ~SpatialGrid();
+
+        /**
+         * @brief Rebuild the grid from the current positions of all entities with a T.
+         *
+         */
+        void Rebuild();
+
+        /**
+         * @brief Get the entities within a distance of a point.
+         *
+         * @return The entities, in no particular order. The reference is valid until the next query.
+         */
+        const std::vector<Entity>& QueryRadius(const Point& center, float radius);
+
+        /**
+         * @brief Get the entities inside an axis aligned box, including its boundary.
+         *
+         * @return The entities, in no particular order. The reference is valid until the next query.
+         */
+        const std::vector<Entity>& QueryBox(const Point& min, const Point& max);
+
+        /**
+         * @brief Get the number of entities in the grid.
+         *
+         */
+        size_t Size() const;
+    private:
+        SpatialGrid(const SpatialGrid&);
+        SpatialGrid& operator=(const SpatialGrid&);
+
+        /**
+         * @brief An entity in a cell and its position.
+         *
+         */
+        struct Entry
+        {
+            Entity entity;
+            Point point;
+        };
+
+        /**
+         * @brief The cell of an entity and its position among the entries of the cell.
+         *
+         */
+        struct Location
+        {
+            uint64_t cell;
+            size_t position;
+        };
+
+        /**
+         * @brief Get the cell coordinate of a position along one axis.
+         *
+         */
+        int32_t GetCoordinate(float value) const;
+
+        /**
+         * @brief Pack the coordinates of a cell into a key. Every coordinate keeps its low 21 bits.
+         *
+         */
+        static uint64_t GetKey(int32_t x, int32_t y, int32_t z);
+
+        /**
+         * @brief Insert an entity, or move it if it is in the grid already.
+         *
+         */
+        void Insert(Entity entity, const Point& point);
+
+        /**
+         * @brief Remove an entity. Does nothing if it is not in the grid.
+         *
+         */
+        void Erase(Entity entity);
+
+        /**
+         * @brief Fill the result with the entities inside a box, and also inside a sphere if a center is given.
+         *
+         */
+        void Search(const Point& min, const Point& max, const Point* center, float squaredRadius);
+
+        /**
+         * @brief Add the entries of a cell that pass the tests of Search to the result.
+         *
+         */
+        void Collect(const std::vector<Entry>& entries, const Point& min, const Point& max, const Point* center, float squaredRadius);
+
+        void EntityCreated(Entity entity);
+        void EntityRemoved(Entity entity);
+        void ComponentAdded(Entity entity, ComponentType componentType);
+        void ComponentRemoved(Entity entity, ComponentType componentType);
+        void ComponentsAdded(Entity entity, const std::bitset<MAX_COMPONENTS>& componentTypes);
+        void ComponentChanged(Entity entity, ComponentType componentType);
+
+        EntityManager* entityManager;
+        float cellSize;
+        PositionFunction position;
+        Mode mode;
+
+        /**
+         * @brief The entries of every non-empty cell.
+         *
+         */
+        std::unordered_map<uint64_t, std::vector<Entry>> cells;
+
+        /**
+         * @brief Where every entity in the grid is stored.
+         *
+         */
+        std::unordered_map<Entity, Location> locations;
+
+        /**
+         * @brief The result of the last query.
+         *
+         */
+        std::vector<Entity> result;
+    };
+
+
+    // IMPLEMENTATION
+
+    template <typename T>
+    SpatialGrid<T>::SpatialGrid(EntityManager* entityManager, float cellSize, PositionFunction position, Mode mode)
+    {
+        assert(cellSize > 0.0f);
+
+        this->entityManager = entityManager;
+        this->cellSize = cellSize;
+        this->position = position;
+        this->mode = mode;
+
+        Rebuild();
+        if (mode == INCREMENTAL)
+            entityManager->AddEntityObserver(this);
+    }
+
+    template <typename T>
+    SpatialGrid<T>::~SpatialGrid()
+    {
+        entityManager->RemoveEntityObserver(this);
+    }
+
+    template <typename T>
+    void SpatialGrid<T>::Rebuild()
+    {
+        // Keep the memory of the cells that stay in use.
+        for (auto& cell : cells)
+            cell.second.clear();
+        locations.clear();
+
+        for (auto entity : entityManager->template Query<T>())
+            Insert(entity, position(*entityManager->template GetComponent<T>(entity)));
+
+        for (auto it = cells.begin(); it != cells.end();)
+        {
+            if (it->second.empty())
+                it = cells.erase(it);
+            else
+                ++it;
+        }
+    }
+
+    template <typename T>
+    const std::vector<Entity>& SpatialGrid<T>::QueryRadius(const Point& center, float radius)
+    {
+        Point min = { center.x - radius, center.y - radius, center.z - radius };
+        Point max = { center.x + radius, center.y + radius, center.z + radius };
+        Search(min, max, &center, radius * radius);
+        return result;
+    }
+
+    template <typename T>
+    const std::vector<Entity>& SpatialGrid<T>::QueryBox(const Point& min, const Point& max)
+    {
+        Search(min, max, nullptr, 0.0f);
+        return result;
+    }
+
+    template <typename T>
+    size_t SpatialGrid<T>::Size() const
+    {
+        return locations.size();
+    }
+
+    template <typename T>
+    int32_t SpatialGrid<T>::GetCoordinate(float value) const
+    {
+        return static_cast<int32_t>(std::floor(value / cellSize));
+    }
+
+    template <typename T>
+    uint64_t SpatialGrid<T>::GetKey(int32_t x, int32_t y, int32_t z)
+    {
+        const uint64_t MASK = (uint64_t(1) << 21) - 1;
+        return (static_cast<uint64_t>(x) & MASK) |
+               ((static_cast<uint64_t>(y) & MASK) << 21) |
+               ((static_cast<uint64_t>(z) & MASK) << 42);
+    }
+
+    template <typename T>
+    void SpatialGrid<T>::Insert(Entity entity, const Point& point)
+    {
+        uint64_t cell = GetKey(GetCoordinate(point.x), GetCoordinate(point.y), GetCoordinate(point.z));
+
+        auto it = locations.find(entity);
+        if (it != locations.end())
+        {
+            // Moving within the cell only updates the stored position.
+            if (it->second.cell == cell)
+            {
+                cells[cell][it->second.position].point = point;
+                return;
+            }
+
+            Erase(entity);
+        }
+
+        std::vector<Entry>& entries = cells[cell];
+        Location location = { cell, entries.size() };
+        Entry entry = { entity, point };
+        entries.push_back(entry);
+        locations[entity] = location;
+    }
+
+    template <typename T>
+    void SpatialGrid<T>::Erase(Entity entity)
+    {
+        auto it = locations.find(entity);
+        if (it == locations.end())
+            return;
+
+        // Move the last entry of the cell into the hole.
+        auto cell = cells.find(it->second.cell);
+        std::vector<Entry>& entries = cell->second;
+        entries[it->second.position] = entries.back();
+        locations[entries.back().entity].position = it->second.position;
+        entries.pop_back();
+
+        if (entries.empty())
+            cells.erase(cell);
+        locations.erase(entity);
+    }
+
+    template <typename T>
+    void SpatialGrid<T>::Search(const Point& min, const Point& max, const Point* center, float squaredRadius)
+    {
+        result.clear();
+
+        int32_t minX = GetCoordinate(min.x), minY = GetCoordinate(min.y), minZ = GetCoordinate(min.z);
+        int32_t maxX = GetCoordinate(max.x), maxY = GetCoordinate(max.y), maxZ = GetCoordinate(max.z);
+        double cellCount = (double(maxX) - minX + 1) * (double(maxY) - minY + 1) * (double(maxZ) - minZ + 1);
+
+        // Visit the overlapped cells, or all non-empty cells if there are fewer of those.
+        if (cellCount > static_cast<double>(cells.size()))
+        {
+            for (auto& cell : cells)
+                Collect(cell.second, min, max, center, squaredRadius);
+        }
+        else
+        {
+            for (int32_t z = minZ; z <= maxZ; ++z)
+            {
+                for (int32_t y = minY; y <= maxY; ++y)
+                {
+                    for (int32_t x = minX; x <= maxX; ++x)
+                    {
+                        auto it = cells.find(GetKey(x, y, z));
+                        if (it != cells.end())
+                            Collect(it->second, min, max, center, squaredRadius);
+                    }
+                }
+            }
+        }
+    }
+
+    template <typename T>
+    void SpatialGrid<T>::Collect(const std::vector<Entry>& entries, const Point& min, const Point& max, const Point* center, float squaredRadius)
+    {
+        for (auto& entry : entries)
+        {
+            const Point& point = entry.point;
+            if (point.x < min.x || point.x > max.x ||
+                point.y < min.y || point.y > max.y ||
+                point.z < min.z || point.z > max.z)
+            {
+                continue;
+            }
+
+            if (center != nullptr)
+            {
+                float dx = point.x - center->x;
+                float dy = point.y - center->y;
+                float dz = point.z - center->z;
+                if (dx * dx + dy * dy + dz * dz > squaredRadius)
+                    continue;
+            }
+
+            result.push_back(entry.entity);
+        }
+    }
+
+    template <typename T>
+    void SpatialGrid<T>::EntityCreated(Entity) {}
+
+    template <typename T>
+    void SpatialGrid<T>::EntityRemoved(Entity entity)
+    {
+        Erase(entity);
+    }
+
+    template <typename T>
+    void SpatialGrid<T>::ComponentAdded(Entity entity, ComponentType componentType)
+    {
+        ComponentChanged(entity, componentType);
+    }
+
+    template <typename T>
+    void SpatialGrid<T>::ComponentRemoved(Entity entity, ComponentType componentType)
+    {
+        if (componentType == Component<T>::ID)
+            Erase(entity);
+    }
+
+    template <typename T>
+    void SpatialGrid<T>::ComponentsAdded(Entity entity, const std::bitset<MAX_COMPONENTS>& componentTypes)
+    {
+        if (componentTypes.test(Component<T>::ID))
+            ComponentChanged(entity, Component<T>::ID);
+    }
+
+    template <typename T>
+    void SpatialGrid<T>::ComponentChanged(Entity entity, ComponentType componentType)
+    {
+        if (componentType == Component<T>::ID)
+            Insert(entity, position(*entityManager->template GetComponent<T>(entity)));
+    }
+}
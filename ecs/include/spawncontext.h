@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cassert>
+#include <vector>
+#include <utility>
+#include "entity.h"
+#include "component.h"
+#include "entitymanager.h"
+
+namespace ECS
+{
+    /**
+     * @brief Creates entities and components from one worker thread while the entity manager is spawning concurrently.
+     *
+     * Get one context per thread with EntityManager::GetSpawnContext. Different contexts can be used from different
+     * threads at the same time without locking: UUIDs and internal IDs are handed out with atomic counters, and each
+     * context claims internal IDs in chunks into its own free list. Components are written into slots reserved with
+     * EntityManager::ReserveConcurrentComponents.
+     *
+     * The created entities are not visible through the entity manager, and observers are not notified about them,
+     * until EntityManager::EndConcurrentSpawning is called. The context is destroyed at that point.
+     */
+    class SpawnContext
+    {
+        friend class EntityManager;
+    public:
+        /**
+         * @brief How many internal IDs a context claims at a time.
+         *
+         */
+        static const size_t CLAIM_COUNT = 64;
+
+        /**
+         * @brief Creates an entity without components.
+         *
+         * @return The created entity.
+         */
+        Entity CreateEntity();
+
+        /**
+         * @brief Create a component and add it to an entity created by this context.
+         *
+         * Room for the component must have been reserved with EntityManager::ReserveConcurrentComponents, and the
+         * entity must not have a component of type T already.
+         *
+         * @return The created component. The pointer is valid until EndConcurrentSpawning is called.
+         */
+        template <typename T>
+        T* AddComponent(Entity entity);
+    private:
+        /**
+         * @brief Private constructor. Contexts are created by the entity manager.
+         *
+         */
+        SpawnContext(EntityManager* entityManager);
+
+        /**
+         * @brief Get the internal ID of an entity created by this context.
+         *
+         */
+        size_t GetInternalId(Entity entity) const;
+
+        /**
+         * @brief The entity manager this context creates entities in.
+         *
+         */
+        EntityManager* entityManager;
+
+        /**
+         * @brief Internal IDs claimed from the entity manager but not used yet.
+         *
+         */
+        std::vector<size_t> freeIds;
+
+        /**
+         * @brief The (UUID, internal ID) pairs of the created entities.
+         *
+         * UUIDs are increasing, so the list is sorted.
+         */
+        std::vector<std::pair<Entity, size_t>> created;
+    };
+
+
+    // IMPLEMENTATION
+
+    template <typename T>
+    T* SpawnContext::AddComponent(Entity entity)
+    {
+        assert(entityManager->concurrentTypes.test(Component<T>::ID));
+
+        size_t internalId = GetInternalId(entity);
+        Private::InternalEntity& internalEntity = entityManager->entities[internalId];
+        assert(!internalEntity.flags.test(Component<T>::ID));
+
+        internalEntity.flags.set(Component<T>::ID, true);
+        return static_cast<Private::ComponentPool<T>*>(entityManager->pools[Component<T>::ID])->AddConcurrent(internalId);
+    }
+}
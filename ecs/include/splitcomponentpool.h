@@ -0,0 +1,211 @@
+#pragma once
+
+#include <cassert>
+#include "componentpool.h"
+
+namespace ECS
+{
+    /**
+     * @brief Access to the two parts of a split component of type T.
+     *
+     * Both pointers are null if the entity has no such component. They are valid until the pool is modified.
+     */
+    template <typename T>
+    struct SplitView
+    {
+        typename T::Hot* hot;
+        typename T::Cold* cold;
+
+        SplitView() : hot(nullptr), cold(nullptr) {}
+        SplitView(typename T::Hot* hot, typename T::Cold* cold) : hot(hot), cold(cold) {}
+
+        /**
+         * @brief Check if the view refers to no component.
+         *
+         */
+        bool IsNull() const { return hot == nullptr; }
+    };
+
+    namespace Private
+    {
+        /**
+         * @brief Private type. Stores the hot and cold parts of split components of type T in two columns.
+         *
+         * Both columns are kept in the same order as the dense array, so the parts of a component have the same index.
+         */
+        template <typename T>
+        class SplitComponentPool : public ComponentPoolBase
+        {
+        public:
+            typedef typename T::Hot Hot;
+            typedef typename T::Cold Cold;
+
+            /**
+             * @brief Constructor. Reserve memory for the given number of components.
+             *
+             */
+            SplitComponentPool(size_t reservedCount);
+
+            /**
+             * @brief Create a component with default constructed parts for the entity.
+             *
+             * If the entity already has a component in this pool, its parts are reset to default constructed values.
+             */
+            SplitView<T> Add(size_t internalId);
+
+            /**
+             * @brief Get the parts of the component associated with the entity.
+             *
+             * @return The parts, or a null view if the entity has no component in this pool.
+             */
+            SplitView<T> Get(size_t internalId);
+
+            size_t GetComponentSize() const;
+            void Remove(size_t internalId);
+            void Clone(size_t sourceId, const size_t* targetIds, size_t count);
+            ComponentPoolBase* CreateEmpty(size_t reservedCount) const;
+            void Transfer(size_t internalId, ComponentPoolBase* target, size_t targetId);
+            void Swap(size_t first, size_t second);
+
+            /**
+             * @brief Get the packed hot parts. Their order matches the dense array.
+             *
+             */
+            Hot* GetHotData();
+
+            /**
+             * @brief Get the packed cold parts. Their order matches the dense array.
+             *
+             */
+            Cold* GetColdData();
+        private:
+            Column<Hot> hot;
+            Column<Cold> cold;
+        };
+
+
+        // IMPLEMENTATION
+
+        template <typename T>
+        SplitComponentPool<T>::SplitComponentPool(size_t reservedCount)
+        {
+            sparse.reserve(reservedCount);
+            dense.reserve(reservedCount);
+            hot.Reserve(reservedCount);
+            cold.Reserve(reservedCount);
+        }
+
+        template <typename T>
+        SplitView<T> SplitComponentPool<T>::Add(size_t internalId)
+        {
+            size_t index = IndexOf(internalId);
+            if (index != INVALID_INDEX)
+            {
+                hot[index] = Hot();
+                cold[index] = Cold();
+                return SplitView<T>(&hot[index], &cold[index]);
+            }
+
+            Link(internalId);
+            Hot* hotPart = &hot.EmplaceBack();
+            Cold* coldPart = &cold.EmplaceBack();
+            return SplitView<T>(hotPart, coldPart);
+        }
+
+        template <typename T>
+        SplitView<T> SplitComponentPool<T>::Get(size_t internalId)
+        {
+            size_t index = IndexOf(internalId);
+            if (index == INVALID_INDEX)
+                return SplitView<T>();
+
+            return SplitView<T>(&hot[index], &cold[index]);
+        }
+
+        template <typename T>
+        size_t SplitComponentPool<T>::GetComponentSize() const
+        {
+            return sizeof(Hot) + sizeof(Cold);
+        }
+
+        template <typename T>
+        void SplitComponentPool<T>::Remove(size_t internalId)
+        {
+            size_t index = IndexOf(internalId);
+            if (index == INVALID_INDEX)
+                return;
+
+            if (index != hot.Size() - 1)
+            {
+                hot[index] = std::move(hot.Back());
+                cold[index] = std::move(cold.Back());
+            }
+            hot.PopBack();
+            cold.PopBack();
+            Unlink(internalId);
+        }
+
+        template <typename T>
+        void SplitComponentPool<T>::Clone(size_t sourceId, const size_t* targetIds, size_t count)
+        {
+            size_t sourceIndex = IndexOf(sourceId);
+            assert(sourceIndex != INVALID_INDEX);
+
+            // Copy the prototype out first, since growing the columns may move it.
+            const Hot hotPrototype = hot[sourceIndex];
+            const Cold coldPrototype = cold[sourceIndex];
+
+            for (size_t i = 0; i < count; ++i)
+            {
+                assert(!Has(targetIds[i]));
+                Link(targetIds[i]);
+                new (hot.Extend(1)) Hot(hotPrototype);
+                new (cold.Extend(1)) Cold(coldPrototype);
+            }
+        }
+
+        template <typename T>
+        ComponentPoolBase* SplitComponentPool<T>::CreateEmpty(size_t reservedCount) const
+        {
+            return new SplitComponentPool<T>(reservedCount);
+        }
+
+        template <typename T>
+        void SplitComponentPool<T>::Transfer(size_t internalId, ComponentPoolBase* target, size_t targetId)
+        {
+            size_t index = IndexOf(internalId);
+            assert(index != INVALID_INDEX);
+
+            SplitComponentPool<T>* targetPool = static_cast<SplitComponentPool<T>*>(target);
+            assert(!targetPool->Has(targetId));
+
+            targetPool->Link(targetId);
+            new (targetPool->hot.Extend(1)) Hot(std::move(hot[index]));
+            new (targetPool->cold.Extend(1)) Cold(std::move(cold[index]));
+            Remove(internalId);
+        }
+
+        template <typename T>
+        void SplitComponentPool<T>::Swap(size_t first, size_t second)
+        {
+            if (first == second)
+                return;
+
+            std::swap(hot[first], hot[second]);
+            std::swap(cold[first], cold[second]);
+            SwapLinks(first, second);
+        }
+
+        template <typename T>
+        typename SplitComponentPool<T>::Hot* SplitComponentPool<T>::GetHotData()
+        {
+            return hot.Data();
+        }
+
+        template <typename T>
+        typename SplitComponentPool<T>::Cold* SplitComponentPool<T>::GetColdData()
+        {
+            return cold.Data();
+        }
+    }
+}
@@ -1,13 +1,18 @@
 #pragma once
 
-#include <set>
+#include <vector>
+#include <unordered_map>
 #include <bitset>
 #include "config.h"
 #include "entity.h"
+#include "component.h"
+#include "profiler.h"
 
 namespace ECS
 {
     class SystemManager;
+    class EntityManager;
+    class TraceRecorder;
 
     /**
      * @brief An entity system base class.
@@ -27,6 +32,13 @@ namespace ECS
         /**
          * @brief Process all entities matching the set aspect.
          *
+         * This calls ProcessEntities, which by default calls ProcessEntity for every enabled entity in the
+         * processing list. See SetInterval and SetSliceSize for running the system less often or on part of
+         * the entities per call.
+         *
+         * Entities may be added, removed, enabled and disabled while processing. Entities that stop matching are
+         * not visited after they were removed from the processing list. Entities that start matching and entities
+         * that are enabled or disabled while processing are placed in the right part of the list after the pass.
          */
         void Process();
 
@@ -44,7 +56,212 @@ namespace ECS
          *
          */
         const std::bitset<MAX_COMPONENTS>& GetAspect() const;
+
+        /**
+         * @brief Get the components that exclude an entity from the system.
+         *
+         */
+        const std::bitset<MAX_COMPONENTS>& GetExclude() const;
+
+        /**
+         * @brief Get the components of which an entity needs at least one to be processed by the system.
+         *
+         */
+        const std::bitset<MAX_COMPONENTS>& GetAnyOf() const;
+
+        /**
+         * @brief Check if an entity with the given component flags should be processed by this system.
+         *
+         * The entity must have all components in the aspect, none of the components in the exclude mask and,
+         * unless the any-of mask is empty, at least one of the components in the any-of mask.
+         *
+         * @param flags The component flags of the entity.
+         */
+        bool Matches(const std::bitset<MAX_COMPONENTS>& flags) const;
+
+        /**
+         * @brief Check if an entity is in the processing list.
+         *
+         */
+        bool HasEntity(Entity entity) const;
+
+        /**
+         * @brief Get the number of entities in the processing list, including disabled ones.
+         *
+         */
+        size_t GetEntityCount() const;
+
+        /**
+         * @brief Get the number of enabled entities in the processing list.
+         *
+         */
+        size_t GetEnabledEntityCount() const;
+
+        /**
+         * @brief Only do work on every n-th call to Process, starting with the first. 1 runs on every call.
+         *
+         */
+        void SetInterval(size_t interval);
+
+        /**
+         * @brief Visit at most the given number of entities per call to Process. 0 visits all of them.
+         *
+         * The default ProcessEntities then works through the processing list in slices, resuming where the
+         * previous call stopped and starting over when it reaches the end. Every enabled entity is visited once per
+         * round, even if entities are added, removed, enabled or disabled between the calls.
+         */
+        void SetSliceSize(size_t entityCount);
+
+        /**
+         * @brief Stop visiting entities once a call to Process has taken the given number of microseconds. 0 has no limit.
+         *
+         * Slices like SetSliceSize, and can be combined with it. At least one entity is visited per call, and the
+         * clock is checked every few entities, so the budget may be overrun slightly.
+         */
+        void SetTimeBudget(size_t microseconds);
+    protected:
+        /**
+         * @brief Protected constructor. Only inherited classes can be instantiated.
+         *
+         */
+        EntitySystem();
+
+        /**
+         * @brief Get the entity manager this system was registered with, or nullptr if it is not registered yet.
+         *
+         */
+        EntityManager* GetEntityManager() const;
+
+        /**
+         * @brief Do the work of Process.
+         *
+         * The default implementation calls ProcessEntity for every entity in the processing list. Override this
+         * to process the entities another way.
+         */
+        virtual void ProcessEntities();
+
+        /**
+         * @brief Get the current list of entities that match the system.
+         *
+         * The enabled entities come first, followed by the disabled ones; see GetEnabledEntityCount.
+         *
+         * While processing, entities that have been removed from the list are replaced by INVALID_ENTITY
+         * until the pass is finished.
+         */
+        const std::vector<Entity>& GetEntities() const;
+
+        /**
+         * @brief Check if the entity at an index of the processing list should be processed.
+         *
+         * False if the entity is disabled, or was removed from the list during the current pass.
+         */
+        bool IsProcessable(size_t index) const;
+
+        /**
+         * @brief Get the internal IDs of the entities in the processing list, in the same order.
+         *
+         */
+        const std::vector<size_t>& GetInternalIds() const;
+
+        /**
+         * @brief Get a counter that changes every time the processing list changes.
+         *
+         * Used to invalidate information cached about the processing list.
+         */
+        size_t GetMembershipVersion() const;
+
+        /**
+         * @brief Require entities to have a component of type T to be processed by this system.
+         *
+         * The masks should be set up in the constructor, since entities are matched when the system is registered.
+         */
+        template <typename T>
+        void Require();
+
+        /**
+         * @brief Do not process entities that have a component of type T.
+         *
+         */
+        template <typename T>
+        void Exclude();
+
+        /**
+         * @brief Require entities to have a component of type T or any other type added with RequireAnyOf.
+         *
+         */
+        template <typename T>
+        void RequireAnyOf();
     private:
+        /**
+         * @brief Add an entity to the processing list.
+         *
+         * @param entity The entity to add.
+         * @param internalId The internal ID of the entity.
+         * @param enabled True to add the entity to the enabled part of the list, false for the disabled part.
+         * @return True if the entity was added, false if it was in the list already.
+         */
+        bool Insert(Entity entity, size_t internalId, bool enabled);
+
+        /**
+         * @brief Remove an entity from the processing list.
+         *
+         * While processing, the entity is replaced by INVALID_ENTITY instead, so the list does not move under
+         * the processing loop. The list is compacted when processing is finished.
+         *
+         * @return True if the entity was removed, false if it was not in the list.
+         */
+        bool Erase(Entity entity);
+
+        /**
+         * @brief Move an entity in the processing list to the enabled or disabled part of it.
+         *
+         * Does nothing if the entity is not in the list. While processing, the entity is moved when the pass is finished.
+         */
+        void SetEnabled(Entity entity, bool enabled);
+
+        /**
+         * @brief Swap two entries of the processing list.
+         *
+         */
+        void Swap(size_t a, size_t b);
+
+        /**
+         * @brief Check if ProcessEntities should visit the entities in slices.
+         *
+         */
+        bool IsSliced() const;
+
+        /**
+         * @brief Call ProcessEntity for the next slice of the enabled entities.
+         *
+         */
+        void ProcessSlice();
+
+        /**
+         * @brief Move an enabled entity out of the visited part of the list before it leaves the enabled part,
+         * so that no unvisited entity takes its place there.
+         *
+         * @return The new index of the entity.
+         */
+        size_t LeaveVisited(size_t index);
+
+        /**
+         * @brief Remove the placeholders left by entities removed while processing, and move entities that were
+         * added, enabled or disabled while processing to the right part of the list.
+         *
+         */
+        void Compact();
+
+        /**
+         * @brief Called by the system manager when an entity is added to or removed from the processing list.
+         *
+         * Does nothing by default.
+         *
+         * @param entity The entity that was added or removed.
+         * @param matched True if the entity was added, false if it was removed.
+         */
+        virtual void MembershipChanged(Entity entity, bool matched);
+
         /**
          * @brief The aspect of the system.
          *
@@ -54,9 +271,124 @@ namespace ECS
         std::bitset<MAX_COMPONENTS> aspect;
 
         /**
-         * @brief The current set of entities that matches our aspect and should be processed.
+         * @brief Entities with any of these components are not processed by the system.
+         *
+         */
+        std::bitset<MAX_COMPONENTS> exclude;
+
+        /**
+         * @brief If not empty, an entity is required to have at least one of these components to be processed.
+         *
+         */
+        std::bitset<MAX_COMPONENTS> anyOf;
+
+        /**
+         * @brief The entity manager this system was registered with.
+         *
+         */
+        EntityManager* entityManager;
+
+        /**
+         * @brief Measures Process, or nullptr. Set by the system manager.
+         *
+         */
+        Profiler* profiler;
+
+        /**
+         * @brief Records calls to Process, or nullptr. Set by the system manager, together with the index of the
+         * system in the trace.
+         *
+         */
+        TraceRecorder* recorder;
+        size_t traceIndex;
+
+        /**
+         * @brief The current list of entities that matches our aspect and should be processed.
+         *
+         */
+        std::vector<Entity> entities;
+
+        /**
+         * @brief The internal IDs of the entities in the processing list, in the same order.
+         *
+         */
+        std::vector<size_t> internalIds;
+
+        /**
+         * @brief Whether the entities in the processing list are enabled, in the same order.
+         *
+         */
+        std::vector<bool> enabledStates;
+
+        /**
+         * @brief The number of enabled entities, which are at the front of the processing list.
+         *
+         */
+        size_t enabledCount;
+
+        /**
+         * @brief Maps entities in the processing list to their index in it.
+         *
+         */
+        std::unordered_map<Entity, size_t> indices;
+
+        /**
+         * @brief Increased every time the processing list changes.
+         *
+         */
+        size_t membershipVersion;
+
+        /**
+         * @brief Process does work every interval calls. tick counts the calls.
+         *
+         */
+        size_t interval;
+        size_t tick;
+
+        /**
+         * @brief The limits of one slice, or 0 if there is no limit.
+         *
+         */
+        size_t sliceSize;
+        size_t timeBudget;
+
+        /**
+         * @brief The enabled entities before this index have been visited in the current round.
+         *
+         */
+        size_t sliceCursor;
+
+        /**
+         * @brief True while Process is running.
          *
          */
-        std::set<Entity> entities;
+        bool processing;
+
+        /**
+         * @brief True if the list was changed while processing and needs compacting.
+         *
+         */
+        bool needsCompacting;
     };
+
+
+    // IMPLEMENTATION
+
+    template <typename T>
+    void EntitySystem::Require()
+    {
+        aspect.set(Component<T>::ID, true);
+    }
+
+    template <typename T>
+    void EntitySystem::Exclude()
+    {
+        exclude.set(Component<T>::ID, true);
+    }
+
+    template <typename T>
+    void EntitySystem::RequireAnyOf()
+    {
+        anyOf.set(Component<T>::ID, true);
+    }
 }
@@ -2,6 +2,7 @@
 
 #include <vector>
 #include "system.h"
+#include "pipeline.h"
 #include "entityobserver.h"
 
 namespace ECS
@@ -22,12 +23,15 @@ namespace ECS
         /**
          * @brief Create a system manager. Requires access to the entity manager.
          *
+         * The system manager observes the entity manager to keep the processing lists of its systems up to date.
+         * The entity manager must outlive the system manager.
+         *
          * @param entityManager The entity manager this system manager should be associated with.
          */
         SystemManager(EntityManager* entityManager);
 
         /**
-         * @brief Destructor - will delete all systems.
+         * @brief Destructor - will stop observing the entity manager and delete all systems.
          *
          */
         ~SystemManager();
@@ -36,10 +40,34 @@ namespace ECS
          * @brief Registers a system within the manager.
          *
          * This will transfer control of the system from the user to the manager. The manager will delete it later.
+         * The system is given access to the entity manager and matched against all active entities.
          *
          * @param system A heap-allocated entity system.
          */
         void RegisterSystem(EntitySystem* system);
+
+        /**
+         * @brief Create and register a pipeline that runs the given stages in one pass.
+         *
+         * @return The pipeline. It is owned by the manager, like registered systems.
+         */
+        template <typename... Stages>
+        Pipeline<Stages...>* RegisterPipeline();
+
+        /**
+         * @brief Measure every call to Process of the registered systems with a profiler, or stop measuring with nullptr.
+         *
+         * The calls are recorded with the system as the section. Applies to systems registered later as well.
+         * The profiler must outlive the system manager.
+         */
+        void SetProfiler(Profiler* profiler);
+
+        /**
+         * @brief Record every call to Process of the registered systems to a trace, or stop recording with nullptr.
+         *
+         * Systems are identified by the order they were registered in. Applies to systems registered later as well.
+         */
+        void SetRecorder(TraceRecorder* recorder);
     private:
         /**
          * @brief The entity manager this system manager is associated with.
@@ -47,6 +75,18 @@ namespace ECS
          */
         EntityManager* entityManager;
 
+        /**
+         * @brief Given to every registered system, or nullptr.
+         *
+         */
+        Profiler* profiler;
+
+        /**
+         * @brief Given to every registered system, or nullptr.
+         *
+         */
+        TraceRecorder* recorder;
+
         /**
          * @brief The list of systems that should be managed. These are assumed to be heap-allocated and not null.
          *
@@ -77,6 +117,14 @@ namespace ECS
          */
         void ComponentAdded(ECS::Entity entity, ECS::ComponentType componentType);
 
+        /**
+         * @brief Several components have been added to an entity at once. Rematch entity against all system aspects once.
+         *
+         * @param entity The UUID of the target entity.
+         * @param componentTypes The flags of the component types added.
+         */
+        void ComponentsAdded(ECS::Entity entity, const std::bitset<MAX_COMPONENTS>& componentTypes);
+
         /**
          * @brief A component has been removed from an entity. Rematch entity against all system aspects.
          *
@@ -89,11 +137,28 @@ namespace ECS
          */
         void ComponentRemoved(ECS::Entity entity, ECS::ComponentType componentType);
 
+        /**
+         * @brief An entity has been enabled or disabled. Move it to the right part of the systems' processing lists.
+         *
+         * @param entity The UUID of the target entity.
+         * @param enabled True if the entity was enabled, false if it was disabled.
+         */
+        void EntityEnabled(ECS::Entity entity, bool enabled);
+
+        /**
+         * @brief A component has been enabled or disabled. Rematch entity against all system aspects.
+         *
+         * @param entity The UUID of the target entity.
+         * @param componentType The ID of the component type.
+         * @param enabled True if the component was enabled, false if it was disabled.
+         */
+        void ComponentEnabled(ECS::Entity entity, ECS::ComponentType componentType, bool enabled);
+
         /**
          * @brief This will add/remove the entity from appropriate systems.
          *
-         * It will match the components on the given entity against the aspect of all registered systems. If it
-         * matches the aspect, the entity is added, if not, it is removed.
+         * It will match the components on the given entity against the aspect, exclude and any-of masks of all
+         * registered systems. If it matches, the entity is added, if not, it is removed.
          *
          */
         void RematchEntityForAllSystems(Entity entity);
@@ -102,8 +167,22 @@ namespace ECS
          * @brief This will add or remove the entity to/from the given system.
          *
          * @param entity The entity to reconsider
+         * @param internalId The internal ID of the entity
+         * @param entityFlag The enabled component flags of the entity
+         * @param enabled Whether the entity is enabled
          * @param system The system which we will compare against
          */
-        void RematchEntityForSystem(Entity entity, EntitySystem* system);
+        void RematchEntityForSystem(Entity entity, size_t internalId, const std::bitset<MAX_COMPONENTS>& entityFlag, bool enabled, EntitySystem* system);
     };
-}
+
+
+    // IMPLEMENTATION
+
+    template <typename... Stages>
+    Pipeline<Stages...>* SystemManager::RegisterPipeline()
+    {
+        Pipeline<Stages...>* pipeline = new Pipeline<Stages...>();
+        RegisterSystem(pipeline);
+        return pipeline;
+    }
+}
\ No newline at end of file
@@ -0,0 +1,192 @@
+#pragma once
+
+#include <cstdint>
+#include <bitset>
+#include <istream>
+#include <ostream>
+#include <vector>
+#include "config.h"
+#include "entity.h"
+#include "component.h"
+
+namespace ECS
+{
+    class EntitySystem;
+
+    /**
+     * @brief One recorded call in a trace.
+     *
+     */
+    struct TraceOperation
+    {
+        enum Type
+        {
+            CREATE_ENTITY,
+            REMOVE_ENTITY,
+            ADD_COMPONENT,
+            REMOVE_COMPONENT,
+            DESTROY_REMOVED,
+            PROCESS,
+            DECLARE_COMPONENT,
+            DECLARE_SYSTEM,
+            TYPE_COUNT
+        };
+
+        TraceOperation();
+
+        Type type;
+
+        /**
+         * @brief The entity, as it was called when the trace was recorded.
+         *
+         */
+        Entity entity;
+
+        /**
+         * @brief The component type, or the index of the system.
+         *
+         */
+        size_t id;
+
+        /**
+         * @brief The size of the component type. Only set for DECLARE_COMPONENT.
+         *
+         */
+        size_t size;
+
+        /**
+         * @brief The masks of the system. Only set for DECLARE_SYSTEM.
+         *
+         */
+        std::bitset<MAX_COMPONENTS> aspect;
+        std::bitset<MAX_COMPONENTS> exclude;
+        std::bitset<MAX_COMPONENTS> anyOf;
+    };
+
+    /**
+     * @brief Writes the calls made on an entity manager and its systems to a compact binary trace.
+     *
+     * Set a recorder on an EntityManager and a SystemManager to record every CreateEntity, RemoveEntity,
+     * AddComponent, RemoveComponent, DestroyRemoved and EntitySystem::Process call. Prefabs, instances,
+     * migrations and the other ways of creating entities and adding components are recorded as those calls.
+     * Component types and systems are declared in the trace before they are first used, with the size of the
+     * component and the masks of the system, so the trace can be replayed without the original types. See
+     * TraceReplayer.
+     *
+     * Every call is one opcode byte followed by variable-length integers. The trace is buffered and written
+     * to the stream when the buffer is full, on Flush and on destruction.
+     */
+    class TraceRecorder
+    {
+    public:
+        /**
+         * @brief Constructor. Write the trace header to the stream.
+         *
+         * @param stream A binary stream that must outlive the recorder.
+         */
+        TraceRecorder(std::ostream& stream);
+        ~TraceRecorder();
+
+        void CreateEntity(Entity entity);
+        void RemoveEntity(Entity entity);
+        void AddComponent(Entity entity, ComponentType componentType, size_t size);
+        void RemoveComponent(Entity entity, ComponentType componentType);
+        void DestroyRemoved();
+        void Process(size_t systemIndex, const EntitySystem& system);
+
+        /**
+         * @brief Write the buffered trace to the stream.
+         *
+         */
+        void Flush();
+
+        /**
+         * @brief Get the number of recorded calls, not counting declarations.
+         *
+         */
+        size_t GetOperationCount() const;
+    private:
+        TraceRecorder(const TraceRecorder&);
+        TraceRecorder& operator=(const TraceRecorder&);
+
+        /**
+         * @brief Buffer an opcode.
+         *
+         */
+        void WriteType(TraceOperation::Type type);
+
+        /**
+         * @brief Buffer an unsigned integer, seven bits per byte.
+         *
+         */
+        void WriteVarint(uint64_t value);
+
+        /**
+         * @brief Buffer a mask as the number of set bits followed by their indices.
+         *
+         */
+        void WriteMask(const std::bitset<MAX_COMPONENTS>& mask);
+
+        std::ostream& stream;
+        std::vector<char> buffer;
+        size_t operationCount;
+
+        /**
+         * @brief The component types and systems that have been declared in the trace.
+         *
+         */
+        std::bitset<MAX_COMPONENTS> declaredComponents;
+        std::vector<bool> declaredSystems;
+    };
+
+    /**
+     * @brief Reads a trace written by a TraceRecorder.
+     *
+     */
+    class TraceReader
+    {
+    public:
+        /**
+         * @brief Constructor. Read the trace header from the stream.
+         *
+         */
+        TraceReader(std::istream& stream);
+
+        /**
+         * @brief Check if the stream is a trace and no malformed operation has been read.
+         *
+         */
+        bool IsValid() const;
+
+        /**
+         * @brief Read the next operation.
+         *
+         * @return False at the end of the trace, or if the trace is not valid.
+         */
+        bool Next(TraceOperation& operation);
+    private:
+        TraceReader(const TraceReader&);
+        TraceReader& operator=(const TraceReader&);
+
+        /**
+         * @brief Read an unsigned integer written by TraceRecorder::WriteVarint.
+         *
+         */
+        bool ReadVarint(uint64_t& value);
+
+        /**
+         * @brief Read an index and check that it is a valid component type.
+         *
+         */
+        bool ReadComponentType(size_t& componentType);
+
+        /**
+         * @brief Read a mask written by TraceRecorder::WriteMask.
+         *
+         */
+        bool ReadMask(std::bitset<MAX_COMPONENTS>& mask);
+
+        std::istream& stream;
+        bool valid;
+    };
+}
@@ -0,0 +1,70 @@
+#include <cstdlib>
+#include <mutex>
+#include <vector>
+#include "../include/buffer.h"
+
+namespace ECS
+{
+    namespace Private
+    {
+        namespace
+        {
+            /**
+             * @brief The smallest block is 2^MIN_SIZE_CLASS bytes.
+             *
+             */
+            const size_t MIN_SIZE_CLASS = 4;
+            const size_t SIZE_CLASS_COUNT = sizeof(size_t) * 8;
+
+            /**
+             * @brief Freed blocks by size class, ready for reuse.
+             *
+             */
+            std::vector<void*> freeBlocks[SIZE_CLASS_COUNT];
+            std::mutex freeBlocksMutex;
+
+            /**
+             * @brief Get the smallest size class holding the given number of bytes.
+             *
+             */
+            size_t GetSizeClass(size_t bytes)
+            {
+                size_t sizeClass = MIN_SIZE_CLASS;
+                while ((static_cast<size_t>(1) << sizeClass) < bytes)
+                    ++sizeClass;
+                return sizeClass;
+            }
+        }
+
+        void* AllocateBuffer(size_t bytes, size_t& allocated)
+        {
+            size_t sizeClass = GetSizeClass(bytes);
+            allocated = static_cast<size_t>(1) << sizeClass;
+
+            {
+                std::lock_guard<std::mutex> lock(freeBlocksMutex);
+                if (!freeBlocks[sizeClass].empty())
+                {
+                    void* block = freeBlocks[sizeClass].back();
+                    freeBlocks[sizeClass].pop_back();
+                    return block;
+                }
+            }
+
+            void* block = std::malloc(allocated);
+            if (block == nullptr)
+                throw std::bad_alloc();
+
+            return block;
+        }
+
+        void FreeBuffer(void* memory, size_t allocated)
+        {
+            size_t sizeClass = GetSizeClass(allocated);
+            assert((static_cast<size_t>(1) << sizeClass) == allocated);
+
+            std::lock_guard<std::mutex> lock(freeBlocksMutex);
+            freeBlocks[sizeClass].push_back(memory);
+        }
+    }
+}
@@ -0,0 +1,326 @@
+#include <bitset>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+#include "../include/cellstreamer.h"
+
+namespace ECS
+{
+    namespace
+    {
+        /**
+         * @brief Written at the start of every cell file.
+         *
+         */
+        const char CELL_MAGIC[4] = { 'E', 'C', 'S', 'C' };
+        const uint32_t CELL_VERSION = 1;
+
+        template <typename T>
+        void Write(std::ostream& stream, T value)
+        {
+            stream.write(reinterpret_cast<const char*>(&value), sizeof(value));
+        }
+
+        template <typename T>
+        bool Read(std::istream& stream, T& value)
+        {
+            return static_cast<bool>(stream.read(reinterpret_cast<char*>(&value), sizeof(value)));
+        }
+    }
+
+    CellStreamer::CellStreamer(EntityManager* entityManager)
+    {
+        this->entityManager = entityManager;
+        current = 0;
+        busy = false;
+        dropCurrent = false;
+        stopping = false;
+        worker = std::thread(&CellStreamer::Run, this);
+    }
+
+    CellStreamer::~CellStreamer()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wakeWorker.notify_one();
+        worker.join();
+
+        for (auto cell : staged)
+            delete cell;
+    }
+
+    void CellStreamer::Save(std::ostream& stream, const std::vector<Entity>& entities) const
+    {
+        // Layout: header, entity count, type count, then per type: key, size, count, owners and packed components.
+        stream.write(CELL_MAGIC, sizeof(CELL_MAGIC));
+        Write(stream, CELL_VERSION);
+        Write(stream, static_cast<uint64_t>(entities.size()));
+        Write(stream, static_cast<uint64_t>(types.size()));
+
+        std::vector<size_t> internalIds;
+        for (auto entity : entities)
+            internalIds.push_back(entityManager->GetInternalId(entity));
+
+        std::vector<uint32_t> owners;
+        std::vector<const unsigned char*> components;
+        for (auto& type : types)
+        {
+            owners.clear();
+            components.clear();
+            Private::ComponentPoolBase* pool = type.getPool(entityManager);
+            for (size_t i = 0; i < internalIds.size(); ++i)
+            {
+                // Components that were removed but not destroyed yet are not saved.
+                if (!entityManager->entities[internalIds[i]].flags.test(type.componentType))
+                    continue;
+
+                owners.push_back(static_cast<uint32_t>(i));
+                components.push_back(type.get(pool, internalIds[i]));
+            }
+
+            Write(stream, type.key);
+            Write(stream, static_cast<uint64_t>(type.size));
+            Write(stream, static_cast<uint64_t>(owners.size()));
+            stream.write(reinterpret_cast<const char*>(owners.data()), static_cast<std::streamsize>(owners.size() * sizeof(uint32_t)));
+            for (auto component : components)
+                stream.write(reinterpret_cast<const char*>(component), static_cast<std::streamsize>(type.size));
+        }
+    }
+
+    void CellStreamer::Load(size_t id, const std::string& path)
+    {
+        assert(loaded.find(id) == loaded.end());
+        failed.erase(id);
+
+        Request request;
+        request.id = id;
+        request.path = path;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            requests.push_back(request);
+        }
+        wakeWorker.notify_one();
+    }
+
+    size_t CellStreamer::Commit(size_t maxCells)
+    {
+        size_t committed = 0;
+        while (committed < maxCells)
+        {
+            Private::StagedCell* cell;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (staged.empty())
+                    break;
+
+                cell = staged.front();
+                staged.pop_front();
+            }
+
+            if (cell->failed)
+                failed[cell->id] = true;
+            else
+                entityManager->CommitCell(*cell, loaded[cell->id]);
+
+            delete cell;
+            ++committed;
+        }
+
+        return committed;
+    }
+
+    void CellStreamer::Unload(size_t id)
+    {
+        auto it = loaded.find(id);
+        if (it != loaded.end())
+        {
+            // The game may have removed entities of the cell already.
+            std::vector<Entity> remaining;
+            remaining.reserve(it->second.size());
+            for (auto entity : it->second)
+            {
+                if (!entityManager->IsRemoved(entity))
+                    remaining.push_back(entity);
+            }
+
+            entityManager->RemoveEntities(remaining);
+            loaded.erase(it);
+            return;
+        }
+
+        // Drop the cell if it has not been inserted yet.
+        std::lock_guard<std::mutex> lock(mutex);
+        if (busy && current == id)
+            dropCurrent = true;
+        for (auto request = requests.begin(); request != requests.end(); ++request)
+        {
+            if (request->id == id)
+            {
+                requests.erase(request);
+                return;
+            }
+        }
+        for (auto cell = staged.begin(); cell != staged.end(); ++cell)
+        {
+            if ((*cell)->id == id)
+            {
+                delete *cell;
+                staged.erase(cell);
+                return;
+            }
+        }
+    }
+
+    void CellStreamer::Wait()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        idle.wait(lock, [this]() { return requests.empty() && !busy; });
+    }
+
+    bool CellStreamer::IsLoaded(size_t id) const
+    {
+        return loaded.find(id) != loaded.end();
+    }
+
+    bool CellStreamer::HasFailed(size_t id) const
+    {
+        return failed.find(id) != failed.end();
+    }
+
+    const std::vector<Entity>& CellStreamer::GetEntities(size_t id) const
+    {
+        auto it = loaded.find(id);
+        assert(it != loaded.end());
+        return it->second;
+    }
+
+    void CellStreamer::Run()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true)
+        {
+            wakeWorker.wait(lock, [this]() { return stopping || !requests.empty(); });
+            if (stopping)
+                return;
+
+            Request request = requests.front();
+            requests.pop_front();
+            current = request.id;
+            busy = true;
+            dropCurrent = false;
+
+            // Read without holding the lock, so the main thread is never blocked by the disk.
+            lock.unlock();
+            Private::StagedCell* cell = new Private::StagedCell();
+            cell->id = request.id;
+            std::ifstream stream(request.path.c_str(), std::ios::binary);
+            try
+            {
+                cell->failed = !Read(stream, *cell);
+            }
+            catch (const std::exception&)
+            {
+                // Running out of memory fails the cell instead of the thread.
+                cell->columns.clear();
+                cell->failed = true;
+            }
+            lock.lock();
+
+            if (dropCurrent)
+                delete cell;
+            else
+                staged.push_back(cell);
+            busy = false;
+            if (requests.empty())
+                idle.notify_all();
+        }
+    }
+
+    bool CellStreamer::Read(std::istream& stream, Private::StagedCell& cell) const
+    {
+        char magic[sizeof(CELL_MAGIC)];
+        uint32_t version;
+        uint64_t entityCount;
+        uint64_t typeCount;
+        if (!stream.read(magic, sizeof(magic)) || !std::equal(CELL_MAGIC, CELL_MAGIC + sizeof(CELL_MAGIC), magic) ||
+            !ECS::Read(stream, version) || version != CELL_VERSION ||
+            !ECS::Read(stream, entityCount) || !ECS::Read(stream, typeCount))
+        {
+            return false;
+        }
+
+        // Owners are 32 bit indices, so no cell can have more entities.
+        if (entityCount > static_cast<uint64_t>(std::numeric_limits<uint32_t>::max()) + 1)
+            return false;
+
+        // Find out how much data is left, so that no size read from the file can make us allocate more than that.
+        std::streampos start = stream.tellg();
+        if (start == std::streampos(-1) || !stream.seekg(0, std::ios::end))
+            return false;
+        uint64_t remaining = static_cast<uint64_t>(stream.tellg() - start);
+        if (!stream.seekg(start))
+            return false;
+
+        // Every component type may only be listed once, or the same entities would be given its components twice.
+        std::bitset<MAX_COMPONENTS> seenTypes;
+
+        cell.entityCount = static_cast<size_t>(entityCount);
+        for (uint64_t t = 0; t < typeCount; ++t)
+        {
+            uint32_t key;
+            uint64_t size;
+            uint64_t count;
+            const uint64_t headerBytes = sizeof(key) + sizeof(size) + sizeof(count);
+            if (remaining < headerBytes || !ECS::Read(stream, key) || !ECS::Read(stream, size) || !ECS::Read(stream, count) || count > entityCount)
+                return false;
+            remaining -= headerBytes;
+
+            if (count != 0 && (size > remaining || count > remaining / (sizeof(uint32_t) + size)))
+                return false;
+            remaining -= count * (sizeof(uint32_t) + size);
+
+            Private::StagedCell::Column column;
+            column.type = FindType(key);
+            if (column.type != nullptr)
+            {
+                if (column.type->size != size || seenTypes.test(column.type->componentType))
+                    return false;
+                seenTypes.set(column.type->componentType);
+            }
+
+            column.owners.resize(static_cast<size_t>(count));
+            column.bytes.resize(static_cast<size_t>(count * size));
+            if (!stream.read(reinterpret_cast<char*>(column.owners.data()), static_cast<std::streamsize>(count * sizeof(uint32_t))) ||
+                !stream.read(reinterpret_cast<char*>(column.bytes.data()), static_cast<std::streamsize>(count * size)))
+            {
+                return false;
+            }
+
+            // Save writes the owners in increasing order, which also rules out an entity having two components of a type.
+            for (size_t i = 0; i < column.owners.size(); ++i)
+            {
+                if (column.owners[i] >= entityCount || (i > 0 && column.owners[i] <= column.owners[i - 1]))
+                    return false;
+            }
+
+            // Skip types that are not registered.
+            if (column.type != nullptr)
+                cell.columns.push_back(std::move(column));
+        }
+
+        return true;
+    }
+
+    const Private::StreamedType* CellStreamer::FindType(uint32_t key) const
+    {
+        for (auto& type : types)
+        {
+            if (type.key == key)
+                return &type;
+        }
+
+        return nullptr;
+    }
+}
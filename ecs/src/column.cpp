@@ -0,0 +1,131 @@
+#include <cstdlib>
+#include <algorithm>
+#include <cstdint>
+#include "../include/column.h"
+
+#ifdef __linux__
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace ECS
+{
+    namespace Private
+    {
+#ifdef __linux__
+        namespace
+        {
+            /**
+             * @brief The size of a transparent huge page.
+             *
+             */
+            const size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+            size_t GetPageSize()
+            {
+                return static_cast<size_t>(sysconf(_SC_PAGESIZE));
+            }
+
+            size_t RoundUp(size_t value, size_t granularity)
+            {
+                return (value + granularity - 1) / granularity * granularity;
+            }
+        }
+#endif
+
+        void* AllocateColumn(size_t bytes)
+        {
+            static_assert((COLUMN_ALIGNMENT & (COLUMN_ALIGNMENT - 1)) == 0, "COLUMN_ALIGNMENT must be a power of two");
+            const size_t alignment = COLUMN_ALIGNMENT;
+
+            // Over-allocate so that the block can be aligned, and store the original pointer right before it.
+            size_t padded = (bytes + alignment - 1) & ~(alignment - 1);
+            void* block = std::malloc(padded + alignment + sizeof(void*));
+            if (block == nullptr)
+                throw std::bad_alloc();
+
+            uintptr_t start = reinterpret_cast<uintptr_t>(block) + sizeof(void*);
+            uintptr_t aligned = (start + alignment - 1) & ~static_cast<uintptr_t>(alignment - 1);
+            reinterpret_cast<void**>(aligned)[-1] = block;
+            return reinterpret_cast<void*>(aligned);
+        }
+
+        void FreeColumn(void* memory)
+        {
+            if (memory != nullptr)
+                std::free(static_cast<void**>(memory)[-1]);
+        }
+
+        void* ReserveColumn(size_t bytes)
+        {
+#ifdef __linux__
+            size_t pageSize = GetPageSize();
+            if (static_cast<size_t>(COLUMN_ALIGNMENT) > pageSize || bytes == 0)
+                return nullptr;
+
+            // Over-reserve by a huge page and trim both ends, so that huge pages line up with the range.
+            size_t alignment = COLUMN_HUGE_PAGES ? HUGE_PAGE_SIZE : pageSize;
+            bytes = RoundUp(bytes, pageSize);
+            void* mapping = mmap(nullptr, bytes + alignment, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+            if (mapping == MAP_FAILED)
+                return nullptr;
+
+            uintptr_t start = reinterpret_cast<uintptr_t>(mapping);
+            uintptr_t aligned = (start + alignment - 1) & ~static_cast<uintptr_t>(alignment - 1);
+            size_t head = static_cast<size_t>(aligned - start);
+            if (head != 0)
+                munmap(mapping, head);
+            if (alignment - head != 0)
+                munmap(reinterpret_cast<void*>(aligned + bytes), alignment - head);
+
+            return reinterpret_cast<void*>(aligned);
+#else
+            (void)bytes;
+            return nullptr;
+#endif
+        }
+
+        size_t CommitColumn(void* memory, size_t reservedBytes, size_t committedBytes, size_t bytes)
+        {
+#ifdef __linux__
+            // Commit whole huge pages once the column is large enough to use them.
+            size_t granularity = GetPageSize();
+            bool huge = COLUMN_HUGE_PAGES && bytes >= HUGE_PAGE_SIZE;
+            if (huge)
+                granularity = HUGE_PAGE_SIZE;
+
+            size_t target = std::min(RoundUp(bytes, granularity), RoundUp(reservedBytes, GetPageSize()));
+            if (target <= committedBytes)
+                return committedBytes;
+
+            char* start = static_cast<char*>(memory) + committedBytes;
+            if (mprotect(start, target - committedBytes, PROT_READ | PROT_WRITE) != 0)
+                return 0;
+
+            // Ask for huge pages for the whole range once; failing only means small pages are used.
+#ifdef MADV_HUGEPAGE
+            if (huge && committedBytes < HUGE_PAGE_SIZE)
+                madvise(memory, reservedBytes, MADV_HUGEPAGE);
+#endif
+
+            return target;
+#else
+            (void)memory;
+            (void)reservedBytes;
+            (void)committedBytes;
+            (void)bytes;
+            return 0;
+#endif
+        }
+
+        void ReleaseColumn(void* memory, size_t reservedBytes)
+        {
+#ifdef __linux__
+            munmap(memory, RoundUp(reservedBytes, GetPageSize()));
+#else
+            (void)memory;
+            (void)reservedBytes;
+#endif
+        }
+    }
+}
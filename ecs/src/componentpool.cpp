@@ -0,0 +1,124 @@
+#include <cstdlib>
+#include "../include/componentpool.h"
+
+namespace ECS
+{
+    namespace Private
+    {
+        const size_t ComponentPoolBase::INVALID_INDEX = static_cast<size_t>(-1);
+
+
+        ComponentPoolBase::ComponentPoolBase()
+        {
+            version = 0;
+            concurrentCursor = 0;
+            concurrentLimit = 0;
+        }
+
+        ComponentPoolBase::~ComponentPoolBase() {}
+
+        bool ComponentPoolBase::Has(size_t internalId) const
+        {
+            return IndexOf(internalId) != INVALID_INDEX;
+        }
+
+        size_t ComponentPoolBase::IndexOf(size_t internalId) const
+        {
+            if (internalId >= sparse.size())
+                return INVALID_INDEX;
+
+            return sparse[internalId];
+        }
+
+        size_t ComponentPoolBase::Size() const
+        {
+            return dense.size();
+        }
+
+        size_t ComponentPoolBase::GetInternalId(size_t index) const
+        {
+            assert(index < dense.size());
+            return dense[index];
+        }
+
+        size_t ComponentPoolBase::GetVersion() const
+        {
+            return version;
+        }
+
+        size_t ComponentPoolBase::Link(size_t internalId)
+        {
+            if (internalId >= sparse.size())
+                sparse.resize(internalId + 1, INVALID_INDEX);
+
+            assert(sparse[internalId] == INVALID_INDEX);
+
+            size_t index = dense.size();
+            sparse[internalId] = index;
+            dense.push_back(internalId);
+            ++version;
+            return index;
+        }
+
+        void ComponentPoolBase::Unlink(size_t internalId)
+        {
+            size_t index = IndexOf(internalId);
+            assert(index != INVALID_INDEX);
+
+            size_t moved = dense.back();
+            dense[index] = moved;
+            sparse[moved] = index;
+            dense.pop_back();
+            sparse[internalId] = INVALID_INDEX;
+            ++version;
+        }
+
+        void ComponentPoolBase::SwapLinks(size_t first, size_t second)
+        {
+            assert(first < dense.size() && second < dense.size());
+
+            std::swap(dense[first], dense[second]);
+            sparse[dense[first]] = first;
+            sparse[dense[second]] = second;
+            ++version;
+        }
+
+        void ComponentPoolBase::BeginConcurrent(size_t count, size_t internalIdLimit)
+        {
+            if (internalIdLimit > sparse.size())
+                sparse.resize(internalIdLimit, INVALID_INDEX);
+
+            concurrentCursor = dense.size();
+            concurrentLimit = dense.size() + count;
+            dense.resize(concurrentLimit, INVALID_INDEX);
+        }
+
+        void ComponentPoolBase::EndConcurrent()
+        {
+            dense.resize(GetConcurrentCount());
+            concurrentCursor = 0;
+            concurrentLimit = 0;
+            ++version;
+        }
+
+        size_t ComponentPoolBase::LinkConcurrent(size_t internalId)
+        {
+            size_t index = concurrentCursor.fetch_add(1, std::memory_order_relaxed);
+            assert(internalId < sparse.size() && sparse[internalId] == INVALID_INDEX);
+
+            // Writing past the reserved slots would corrupt memory other threads are using, so do not carry on.
+            if (index >= concurrentLimit)
+                std::abort();
+
+            // Every caller owns a different slot and entity, so the writes do not race.
+            sparse[internalId] = index;
+            dense[index] = internalId;
+            return index;
+        }
+
+        size_t ComponentPoolBase::GetConcurrentCount() const
+        {
+            return std::min(concurrentCursor.load(), concurrentLimit);
+        }
+    }
+}
@@ -1,8 +1,12 @@
+#include <cstdlib>
 #include "../include/entitymanager.h"
+#include "../include/spawncontext.h"
+#include "../include/cellstreamer.h"
 
 namespace ECS
 {
     const std::bitset<MAX_COMPONENTS> EntityManager::ZERO_BITSET;
+    const size_t EntityManager::NO_GROUP = static_cast<size_t>(-1);
 
 
     EntityManager::ComponentReference::ComponentReference(size_t internalEntityId, ComponentType componentType)
@@ -21,47 +25,55 @@ namespace ECS
     EntityManager::EntityManager(size_t reservedEntityCount)
     {
         nextUUID = 0;
+        uuidStride = 1;
         nextInternalId = 0;
-
-        entities.reserve(reservedEntityCount);
+        spawning = false;
+        queryCache = nullptr;
+        indexRegistry = nullptr;
+        hierarchy = nullptr;
+        snapshotFrame = 0;
+        profiler = nullptr;
+        recorder = nullptr;
+        concurrentRecycledCursor = 0;
+        concurrentNextInternalId = 0;
+        concurrentInternalIdLimit = 0;
+        this->reservedEntityCount = reservedEntityCount;
+
+        entities.Reserve(reservedEntityCount);
         for (size_t i = 0; i < MAX_COMPONENTS; ++i)
-            components[i].reserve(reservedEntityCount);
+        {
+            pools[i] = nullptr;
+            groupOwners[i] = NO_GROUP;
+        }
     }
 
     EntityManager::~EntityManager()
     {
-        // TODO: Use custom deallocator.
+        for (auto context : spawnContexts)
+            delete context;
+        delete queryCache;
+        delete indexRegistry;
+        delete hierarchy;
+        for (auto& reader : snapshotReaders)
+            delete reader.second;
+
         for (size_t i = 0; i < MAX_COMPONENTS; ++i)
-        {
-            for (size_t k = 0; k < entities.size(); ++k)
-            {
-                delete components[i][k];
-            }
-        }
+            delete pools[i];
     }
 
     Entity EntityManager::CreateEntity()
     {
-        Entity entity = nextUUID++;
-        size_t internalId;
-        if (recycledIds.empty())
-        {
-            // Choose a new internal ID.
-            internalId = nextInternalId++;
-            entities.push_back(Private::InternalEntity());
-            for (size_t i = 0; i < MAX_COMPONENTS; ++i)
-                components[i].push_back(nullptr);
-        }
-        else
-        {
-            // Use a recycled internal ID.
-            internalId = recycledIds.back();
-            recycledIds.pop_back();
-        }
+        assert(!spawning);
+
+        Entity entity = NextUUID();
+        size_t internalId = AllocateInternalId(entity);
 
         translator[entity] = internalId;
         activeEntities.insert(entity);
 
+        if (recorder != nullptr)
+            recorder->CreateEntity(entity);
+
         // Notify all observers of the created entity.
         for (auto observer : observers)
             observer->EntityCreated(entity);
@@ -69,22 +81,138 @@ namespace ECS
         return entity;
     }
 
-    void EntityManager::RemoveEntity(Entity entity)
+    Entity EntityManager::CreatePrefab()
+    {
+        assert(!spawning);
+
+        Entity prefab = NextUUID();
+        size_t internalId = AllocateInternalId(prefab);
+
+        translator[prefab] = internalId;
+        entities[internalId].prefab = true;
+
+        if (recorder != nullptr)
+            recorder->CreateEntity(prefab);
+
+        return prefab;
+    }
+
+    bool EntityManager::IsPrefab(Entity entity) const
+    {
+        auto it = translator.find(entity);
+        if (it == translator.end())
+            return false;
+
+        size_t internalId = it->second;
+        assert(internalId < entities.Size());
+
+        return entities[internalId].prefab;
+    }
+
+    std::vector<Entity> EntityManager::Instantiate(Entity prefab, size_t count)
     {
-        // TODO: Remove entity from systems
+        auto it = translator.find(prefab);
+        assert(it != translator.end());
+
+        size_t prefabId = it->second;
+        assert(prefabId < entities.Size());
+        assert(entities[prefabId].prefab);
+        assert(!spawning);
+
+        // Copy the flags, since allocating internal IDs may grow the entity list.
+        const std::bitset<MAX_COMPONENTS> flags = entities[prefabId].flags;
+        const std::bitset<MAX_COMPONENTS> disabled = entities[prefabId].disabled;
+
+        std::vector<Entity> instances(count);
+        std::vector<size_t> internalIds(count);
+        entities.Reserve(entities.Size() + count);
+        for (size_t i = 0; i < count; ++i)
+        {
+            instances[i] = NextUUID();
+            internalIds[i] = AllocateInternalId(instances[i]);
+            entities[internalIds[i]].flags = flags;
+            entities[internalIds[i]].disabled = disabled;
+
+            // UUIDs are increasing, so the new entities always go at the end.
+            translator.insert(translator.end(), std::make_pair(instances[i], internalIds[i]));
+            activeEntities.insert(activeEntities.end(), instances[i]);
+        }
+
+        // Clone one component type at a time, so that every pool is appended to in one run.
+        for (size_t i = 0; i < MAX_COMPONENTS; ++i)
+        {
+            if (flags.test(i))
+                pools[i]->Clone(prefabId, internalIds.data(), count);
+        }
 
+        if (!groups.empty())
+        {
+            for (auto internalId : internalIds)
+                UpdateGroups(internalId, flags);
+        }
+
+        if (recorder != nullptr)
+        {
+            for (size_t i = 0; i < count; ++i)
+                RecordCreated(instances[i], internalIds[i]);
+        }
+
+        // Notify all observers of the created entities and their components.
+        for (auto entity : instances)
+        {
+            for (auto observer : observers)
+            {
+                observer->EntityCreated(entity);
+                observer->ComponentsAdded(entity, flags);
+            }
+        }
+
+        return instances;
+    }
+
+    void EntityManager::RemoveEntity(Entity entity)
+    {
         auto it = translator.find(entity);
         assert(it != translator.end());
 
         size_t internalId = it->second;
-        assert(internalId < entities.size());
+        assert(internalId < entities.Size());
+
+        // Removing a parent also removes its children, so an entity may be removed again before it is destroyed.
+        if (entities[internalId].removed)
+            return;
+
+        if (recorder != nullptr)
+            recorder->RemoveEntity(entity);
 
-        entitiesToDestroy.push_back(internalId);
+        entitiesToDestroy.push_back(entity);
+        entities[internalId].removed = true;
         entities[internalId].flags.reset();
+        if (!groups.empty())
+            UpdateGroups(internalId, ZERO_BITSET);
         activeEntities.erase(entity);
 
-        for (auto observer : observers)
-            observer->EntityRemoved(entity);
+        if (!entities[internalId].prefab)
+        {
+            for (auto observer : observers)
+                observer->EntityRemoved(entity);
+        }
+
+        // Remove the whole subtree. The descendants have left the hierarchy, so this does not recurse further.
+        if (hierarchy != nullptr && hierarchy->IsMember(internalId))
+        {
+            std::vector<size_t> descendants;
+            hierarchy->RemoveSubtree(internalId, descendants);
+            for (auto descendant : descendants)
+                RemoveEntity(entities[descendant].entity);
+        }
+    }
+
+    void EntityManager::RemoveEntities(const std::vector<Entity>& entities)
+    {
+        entitiesToDestroy.reserve(entitiesToDestroy.size() + entities.size());
+        for (auto entity : entities)
+            RemoveEntity(entity);
     }
 
     bool EntityManager::IsRemoved(Entity entity)
@@ -96,10 +224,10 @@ namespace ECS
             return true;
 
         size_t internalId = it->second;
-        assert(internalId < entities.size());
+        assert(internalId < entities.Size());
 
         // If the entity is in the destroy list, it has been removed; return true.
-        return std::find(entitiesToDestroy.begin(), entitiesToDestroy.end(), internalId) != entitiesToDestroy.end();
+        return entities[internalId].removed;
     }
 
     bool EntityManager::IsDestroyed(Entity entity)
@@ -107,6 +235,26 @@ namespace ECS
         return translator.find(entity) == translator.end();
     }
 
+    void EntityManager::SetEnabled(Entity entity, bool enabled)
+    {
+        size_t internalId = GetInternalId(entity);
+        if (entities[internalId].enabled == enabled)
+            return;
+
+        entities[internalId].enabled = enabled;
+
+        if (!entities[internalId].prefab)
+        {
+            for (auto observer : observers)
+                observer->EntityEnabled(entity, enabled);
+        }
+    }
+
+    bool EntityManager::IsEnabled(Entity entity) const
+    {
+        return entities[GetInternalId(entity)].enabled;
+    }
+
     const std::set<Entity>& EntityManager::GetActiveEntities() const
     {
         return activeEntities;
@@ -119,14 +267,30 @@ namespace ECS
             return ZERO_BITSET;
 
         size_t internalId = it->second;
-        assert(internalId < entities.size());
+        assert(internalId < entities.Size());
 
         return entities[internalId].flags;
     }
 
     void EntityManager::DestroyRemoved()
     {
-        // TODO: Use custom deallocator instead of delete
+        assert(!spawning);
+
+        if (recorder != nullptr)
+            recorder->DestroyRemoved();
+
+        Profiler::Sample begin;
+        if (profiler != nullptr)
+            profiler->Read(begin);
+
+        // Null the references to the removed entities. The references held by removed entities and components are
+        // no longer indexed.
+        std::vector<std::pair<Entity, ComponentType>> clearedReferences;
+        if (indexRegistry != nullptr && indexRegistry->HasReferenceIndexes())
+        {
+            for (Entity entity : entitiesToDestroy)
+                indexRegistry->ClearReferences(entity, clearedReferences);
+        }
 
         // Destroy all removed entities.
         for (Entity entity : entitiesToDestroy)
@@ -136,21 +300,259 @@ namespace ECS
             // Destroy all components associated with the entity.
             for (size_t i = 0; i < MAX_COMPONENTS; ++i)
             {
-                delete components[i][internalId];
-                components[i][internalId] = nullptr;
+                if (pools[i] != nullptr)
+                    pools[i]->Remove(internalId);
             }
 
             // Reset and recycle
-            entities[internalId].flags.reset();
+            entities[internalId] = Private::InternalEntity();
             translator.erase(entity);
             recycledIds.push_back(internalId);
         }
 
-        // Destroy all removed components.
+        // Destroy all removed components. Components of destroyed entities are already gone.
         for (auto componentKey : componentsToDestroy)
         {
-            delete components[componentKey.componentType][componentKey.internalEntityId];
-            components[componentKey.componentType][componentKey.internalEntityId] = nullptr;
+            if (pools[componentKey.componentType] != nullptr)
+                pools[componentKey.componentType]->Remove(componentKey.internalEntityId);
+        }
+
+        entitiesToDestroy.clear();
+        componentsToDestroy.clear();
+
+        // Report the cleared references once everything is destroyed, so that observers may remove entities.
+        for (auto& reference : clearedReferences)
+        {
+            for (auto observer : observers)
+                observer->ComponentChanged(reference.first, reference.second);
+        }
+
+        if (queryCache != nullptr)
+            queryCache->Tick();
+
+        if (profiler != nullptr)
+            profiler->Record(this, begin);
+    }
+
+    void EntityManager::SetProfiler(Profiler* profiler)
+    {
+        this->profiler = profiler;
+    }
+
+    void EntityManager::SetRecorder(TraceRecorder* recorder)
+    {
+        this->recorder = recorder;
+    }
+
+    void EntityManager::SetParent(Entity child, Entity parent)
+    {
+        if (hierarchy == nullptr)
+            hierarchy = new Private::Hierarchy();
+
+        size_t parentId = (parent == INVALID_ENTITY) ? Private::Hierarchy::NO_PARENT : GetInternalId(parent);
+        hierarchy->SetParent(GetInternalId(child), parentId);
+    }
+
+    Entity EntityManager::GetParent(Entity entity) const
+    {
+        if (hierarchy == nullptr)
+            return INVALID_ENTITY;
+
+        size_t parent = hierarchy->GetParent(GetInternalId(entity));
+        return parent == Private::Hierarchy::NO_PARENT ? INVALID_ENTITY : entities[parent].entity;
+    }
+
+    std::vector<Entity> EntityManager::GetChildren(Entity entity) const
+    {
+        std::vector<Entity> children;
+        if (hierarchy == nullptr)
+            return children;
+
+        for (auto child : hierarchy->GetChildren(GetInternalId(entity)))
+            children.push_back(entities[child].entity);
+        return children;
+    }
+
+    Private::IndexRegistry* EntityManager::GetIndexRegistry()
+    {
+        if (indexRegistry == nullptr)
+        {
+            indexRegistry = new Private::IndexRegistry(this);
+            AddEntityObserver(indexRegistry);
+        }
+
+        return indexRegistry;
+    }
+
+    void EntityManager::PublishSnapshots()
+    {
+        DestroyRemoved();
+
+        ++snapshotFrame;
+        for (auto& reader : snapshotReaders)
+        {
+            // The type may have been given another kind of pool after the reader was created. Readers only know how
+            // to copy from plain pools, so they get an empty snapshot instead.
+            bool plain = !sharedTypes.test(reader.first) && !layoutTypes.test(reader.first);
+            assert(plain);
+            reader.second->Publish(plain ? pools[reader.first] : nullptr, entities, snapshotFrame);
+        }
+    }
+
+    const std::vector<Entity>& EntityManager::Query(const std::bitset<MAX_COMPONENTS>& mask)
+    {
+        if (queryCache == nullptr)
+        {
+            queryCache = new Private::QueryCache(this);
+            AddEntityObserver(queryCache);
+        }
+
+        return queryCache->Get(mask);
+    }
+
+    void EntityManager::BeginConcurrentSpawning(size_t entityCount, size_t contextCount)
+    {
+        assert(!spawning);
+        spawning = true;
+
+        // Grow the entity list up front so that the contexts can write to their own slots without it moving.
+        // Every context may be left holding a partly used claim, so there must be room for those as well.
+        concurrentRecycledCursor = 0;
+        concurrentNextInternalId = nextInternalId;
+        concurrentInternalIdLimit = nextInternalId + entityCount + contextCount * SpawnContext::CLAIM_COUNT;
+        entities.Resize(concurrentInternalIdLimit);
+
+        for (size_t i = 0; i < contextCount; ++i)
+            spawnContexts.push_back(new SpawnContext(this));
+    }
+
+    SpawnContext* EntityManager::GetSpawnContext(size_t index)
+    {
+        assert(spawning && index < spawnContexts.size());
+        return spawnContexts[index];
+    }
+
+    void EntityManager::EndConcurrentSpawning()
+    {
+        assert(spawning);
+        spawning = false;
+
+        // Drop the recycled IDs that were claimed, and shrink the entity list to the new IDs that were claimed.
+        size_t claimedRecycled = std::min(concurrentRecycledCursor.load(), recycledIds.size());
+        recycledIds.erase(recycledIds.begin(), recycledIds.begin() + static_cast<std::ptrdiff_t>(claimedRecycled));
+        nextInternalId = concurrentNextInternalId;
+        entities.Resize(nextInternalId);
+
+        // Collect the created entities, and recycle the IDs that were claimed but not used.
+        std::vector<std::pair<Entity, size_t>> created;
+        for (auto context : spawnContexts)
+        {
+            created.insert(created.end(), context->created.begin(), context->created.end());
+            recycledIds.insert(recycledIds.end(), context->freeIds.begin(), context->freeIds.end());
+            delete context;
+        }
+        spawnContexts.clear();
+
+        for (size_t i = 0; i < MAX_COMPONENTS; ++i)
+        {
+            if (concurrentTypes.test(i))
+                pools[i]->EndConcurrent();
+        }
+        concurrentTypes.reset();
+
+        if (!groups.empty())
+        {
+            for (auto& entity : created)
+                UpdateGroups(entity.second, entities[entity.second].flags);
+        }
+
+        // UUIDs handed out while spawning are higher than all earlier ones, so sorted they go at the end.
+        std::sort(created.begin(), created.end());
+        for (auto& entity : created)
+        {
+            translator.insert(translator.end(), entity);
+            activeEntities.insert(activeEntities.end(), entity.first);
+            if (recorder != nullptr)
+                RecordCreated(entity.first, entity.second);
+        }
+
+        // Notify all observers of the created entities and their components.
+        for (auto& entity : created)
+        {
+            const std::bitset<MAX_COMPONENTS>& flags = entities[entity.second].flags;
+            for (auto observer : observers)
+            {
+                observer->EntityCreated(entity.first);
+                if (flags.any())
+                    observer->ComponentsAdded(entity.first, flags);
+            }
+        }
+    }
+
+    void EntityManager::CommitCell(const Private::StagedCell& cell, std::vector<Entity>& created)
+    {
+        assert(!spawning);
+
+        size_t first = created.size();
+        std::vector<size_t> internalIds(cell.entityCount);
+        for (size_t i = 0; i < cell.entityCount; ++i)
+        {
+            Entity entity = NextUUID();
+            internalIds[i] = AllocateInternalId(entity);
+            created.push_back(entity);
+        }
+
+        // Append the components of every type in one run.
+        std::vector<size_t> ownerIds;
+        for (auto& column : cell.columns)
+        {
+            ComponentType type = column.type->componentType;
+            assert(!sharedTypes.test(type) && !layoutTypes.test(type));
+
+            ownerIds.clear();
+            for (auto owner : column.owners)
+            {
+                ownerIds.push_back(internalIds[owner]);
+                entities[internalIds[owner]].flags.set(type);
+            }
+
+            column.type->append(column.type->getPool(this), ownerIds.data(), column.bytes.data(), ownerIds.size());
+        }
+
+        if (!groups.empty())
+        {
+            for (auto internalId : internalIds)
+                UpdateGroups(internalId, entities[internalId].flags);
+        }
+
+        // New UUIDs are higher than all earlier ones, so they go at the end.
+        for (size_t i = 0; i < cell.entityCount; ++i)
+        {
+            translator.insert(translator.end(), std::make_pair(created[first + i], internalIds[i]));
+            activeEntities.insert(activeEntities.end(), created[first + i]);
+        }
+
+        if (recorder != nullptr)
+        {
+            for (size_t i = 0; i < cell.entityCount; ++i)
+                recorder->CreateEntity(created[first + i]);
+            for (auto& column : cell.columns)
+            {
+                for (auto owner : column.owners)
+                    recorder->AddComponent(created[first + owner], column.type->componentType, column.type->size);
+            }
+        }
+
+        // Notify all observers of the created entities and their components.
+        for (size_t i = 0; i < cell.entityCount; ++i)
+        {
+            const std::bitset<MAX_COMPONENTS>& flags = entities[internalIds[i]].flags;
+            for (auto observer : observers)
+            {
+                observer->EntityCreated(created[first + i]);
+                if (flags.any())
+                    observer->ComponentsAdded(created[first + i], flags);
+            }
         }
     }
 
@@ -168,4 +570,220 @@ namespace ECS
     {
         return observers.find(observer) != observers.end();
     }
+
+    size_t EntityManager::GetInternalId(Entity entity) const
+    {
+        auto it = translator.find(entity);
+        assert(it != translator.end());
+
+        size_t internalId = it->second;
+        assert(internalId < entities.Size());
+
+        return internalId;
+    }
+
+    size_t EntityManager::AllocateInternalId(Entity entity)
+    {
+        size_t internalId;
+        if (recycledIds.empty())
+        {
+            // Choose a new internal ID.
+            internalId = nextInternalId++;
+            entities.EmplaceBack();
+        }
+        else
+        {
+            // Use a recycled internal ID.
+            internalId = recycledIds.back();
+            recycledIds.pop_back();
+        }
+
+        entities[internalId].entity = entity;
+        return internalId;
+    }
+
+    Entity EntityManager::NextUUID()
+    {
+        return nextUUID.fetch_add(uuidStride, std::memory_order_relaxed);
+    }
+
+    void EntityManager::MigrateEntities(const std::vector<Entity>& migrated, EntityManager* target)
+    {
+        assert(target != this);
+        assert(!spawning && !target->spawning);
+
+        // Create the entities in the target first, with the same state.
+        std::vector<size_t> sourceIds(migrated.size());
+        std::vector<size_t> targetIds(migrated.size());
+        std::bitset<MAX_COMPONENTS> types;
+        for (size_t i = 0; i < migrated.size(); ++i)
+        {
+            sourceIds[i] = GetInternalId(migrated[i]);
+            assert(std::find(entitiesToDestroy.begin(), entitiesToDestroy.end(), migrated[i]) == entitiesToDestroy.end());
+
+            Private::InternalEntity& internalEntity = entities[sourceIds[i]];
+            targetIds[i] = target->AllocateInternalId(migrated[i]);
+            Private::InternalEntity& targetEntity = target->entities[targetIds[i]];
+            targetEntity.flags = internalEntity.flags;
+            targetEntity.disabled = internalEntity.disabled;
+            targetEntity.enabled = internalEntity.enabled;
+            targetEntity.prefab = internalEntity.prefab;
+            types |= internalEntity.flags;
+
+            target->translator[migrated[i]] = targetIds[i];
+            if (!targetEntity.prefab)
+                target->activeEntities.insert(migrated[i]);
+        }
+
+        // Take the entities out of the groups here, so that removing their components does not break the ordering.
+        if (!groups.empty())
+        {
+            for (auto internalId : sourceIds)
+                UpdateGroups(internalId, ZERO_BITSET);
+        }
+
+        // Move one component type at a time, so that every target pool is appended to in one run. Components that
+        // have been removed but not destroyed yet are left behind and destroyed below.
+        for (size_t type = 0; type < MAX_COMPONENTS; ++type)
+        {
+            if (!types.test(type))
+                continue;
+
+            if (target->pools[type] == nullptr)
+            {
+                target->pools[type] = pools[type]->CreateEmpty(target->reservedEntityCount);
+                target->sharedTypes.set(type, sharedTypes.test(type));
+                target->layoutTypes.set(type, layoutTypes.test(type));
+            }
+            assert(target->sharedTypes.test(type) == sharedTypes.test(type));
+            assert(target->layoutTypes.test(type) == layoutTypes.test(type));
+
+            for (size_t i = 0; i < migrated.size(); ++i)
+            {
+                if (entities[sourceIds[i]].flags.test(type))
+                    pools[type]->Transfer(sourceIds[i], target->pools[type], targetIds[i]);
+            }
+        }
+
+        if (!target->groups.empty())
+        {
+            for (size_t i = 0; i < migrated.size(); ++i)
+                target->UpdateGroups(targetIds[i], target->entities[targetIds[i]].flags);
+        }
+
+        // The entities leave this trace as removed entities and enter the target's as created ones.
+        if (recorder != nullptr)
+        {
+            for (auto entity : migrated)
+                recorder->RemoveEntity(entity);
+        }
+        if (target->recorder != nullptr)
+        {
+            for (size_t i = 0; i < migrated.size(); ++i)
+                target->RecordCreated(migrated[i], targetIds[i]);
+        }
+
+        // Get rid of the entities in this entity manager right away, since their UUIDs live on in the target.
+        for (size_t i = 0; i < migrated.size(); ++i)
+        {
+            size_t internalId = sourceIds[i];
+            bool prefab = entities[internalId].prefab;
+            if (hierarchy != nullptr)
+                hierarchy->Detach(internalId);
+
+            for (size_t type = 0; type < MAX_COMPONENTS; ++type)
+            {
+                if (pools[type] != nullptr)
+                    pools[type]->Remove(internalId);
+            }
+
+            componentsToDestroy.erase(std::remove_if(componentsToDestroy.begin(), componentsToDestroy.end(),
+                                                     [internalId](const ComponentReference& reference) { return reference.internalEntityId == internalId; }),
+                                      componentsToDestroy.end());
+            entities[internalId] = Private::InternalEntity();
+            translator.erase(migrated[i]);
+            activeEntities.erase(migrated[i]);
+            recycledIds.push_back(internalId);
+
+            if (!prefab)
+            {
+                for (auto observer : observers)
+                    observer->EntityRemoved(migrated[i]);
+            }
+        }
+
+        // Notify the observers of the target of the created entities and their components.
+        for (size_t i = 0; i < migrated.size(); ++i)
+        {
+            const Private::InternalEntity& targetEntity = target->entities[targetIds[i]];
+            if (targetEntity.prefab)
+                continue;
+
+            for (auto observer : target->observers)
+            {
+                observer->EntityCreated(migrated[i]);
+                if (targetEntity.flags.any())
+                    observer->ComponentsAdded(migrated[i], targetEntity.flags);
+            }
+        }
+    }
+
+    void EntityManager::RecordCreated(Entity entity, size_t internalId)
+    {
+        recorder->CreateEntity(entity);
+        for (size_t type = 0; type < MAX_COMPONENTS; ++type)
+        {
+            if (entities[internalId].flags.test(type))
+                recorder->AddComponent(entity, static_cast<ComponentType>(type), pools[type]->GetComponentSize());
+        }
+    }
+
+    void EntityManager::UpdateGroups(size_t internalId, const std::bitset<MAX_COMPONENTS>& flags)
+    {
+        for (auto& group : groups)
+        {
+            size_t first = 0;
+            while (!group.types.test(first))
+                ++first;
+
+            bool member = pools[first]->IndexOf(internalId) < group.size;
+            bool matches = (flags & group.types) == group.types && !entities[internalId].prefab;
+            if (member == matches)
+                continue;
+
+            // Joining swaps the entity to the end of the members, leaving swaps it with the last member.
+            if (!matches)
+                --group.size;
+
+            for (size_t type = first; type < MAX_COMPONENTS; ++type)
+            {
+                if (group.types.test(type))
+                    pools[type]->Swap(pools[type]->IndexOf(internalId), group.size);
+            }
+
+            if (matches)
+                ++group.size;
+        }
+    }
+
+    void EntityManager::ClaimInternalIds(std::vector<size_t>& internalIds, size_t count)
+    {
+        // Take recycled IDs first. The cursor may run past the end, in which case the rest are new IDs.
+        size_t cursor = concurrentRecycledCursor.fetch_add(count, std::memory_order_relaxed);
+        size_t first = std::min(cursor, recycledIds.size());
+        size_t last = std::min(cursor + count, recycledIds.size());
+        internalIds.insert(internalIds.end(), recycledIds.begin() + static_cast<std::ptrdiff_t>(first), recycledIds.begin() + static_cast<std::ptrdiff_t>(last));
+
+        size_t remaining = count - (last - first);
+        if (remaining > 0)
+        {
+            // The entity list was grown up front and must not move while other threads write to it, so do not carry on.
+            size_t firstNew = concurrentNextInternalId.fetch_add(remaining, std::memory_order_relaxed);
+            if (firstNew + remaining > concurrentInternalIdLimit)
+                std::abort();
+
+            for (size_t i = 0; i < remaining; ++i)
+                internalIds.push_back(firstNew + i);
+        }
+    }
 }
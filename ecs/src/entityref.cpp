@@ -0,0 +1,34 @@
+#include "../include/entityref.h"
+
+namespace ECS
+{
+    EntityRef::EntityRef()
+    {
+        target = INVALID_ENTITY;
+    }
+
+    EntityRef::EntityRef(Entity target)
+    {
+        this->target = target;
+    }
+
+    Entity EntityRef::Get() const
+    {
+        return target;
+    }
+
+    bool EntityRef::IsNull() const
+    {
+        return target == INVALID_ENTITY;
+    }
+
+    bool EntityRef::operator==(const EntityRef& other) const
+    {
+        return target == other.target;
+    }
+
+    bool EntityRef::operator!=(const EntityRef& other) const
+    {
+        return target != other.target;
+    }
+}
@@ -0,0 +1,9 @@
+#include "../include/event.h"
+
+namespace ECS
+{
+    namespace Private
+    {
+        unsigned int EventBase::nextTypeId = 0;
+    }
+}
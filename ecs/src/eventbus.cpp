@@ -0,0 +1,21 @@
+#include "../include/eventbus.h"
+
+namespace ECS
+{
+    EventBus::EventBus() {}
+
+    EventBus::~EventBus()
+    {
+        for (auto channel : channels)
+            delete channel;
+    }
+
+    void EventBus::Update()
+    {
+        for (auto channel : channels)
+        {
+            if (channel != nullptr)
+                channel->Update();
+        }
+    }
+}
@@ -0,0 +1,185 @@
+#include <cassert>
+#include <algorithm>
+#include "../include/hierarchy.h"
+#include "../include/componentpool.h"
+
+namespace ECS
+{
+    namespace Private
+    {
+        const size_t Hierarchy::NO_PARENT = static_cast<size_t>(-1);
+
+        Hierarchy::Hierarchy()
+        {
+            version = 1;
+            orderVersion = 0;
+        }
+
+        void Hierarchy::SetParent(size_t child, size_t parent)
+        {
+            assert(child != parent);
+            if (GetParent(child) == parent)
+                return;
+
+            if (parent != NO_PARENT)
+            {
+                // Refuse to create a cycle.
+                for (size_t ancestor = parent; ancestor != NO_PARENT; ancestor = GetParent(ancestor))
+                    assert(ancestor != child);
+            }
+
+            Unparent(child);
+            if (parent != NO_PARENT)
+            {
+                GetNode(child).parent = parent;
+                GetNode(parent).children.push_back(child);
+            }
+
+            // Drop nodes that are not members anymore.
+            auto it = nodes.find(child);
+            if (it != nodes.end() && it->second.parent == NO_PARENT && it->second.children.empty())
+                nodes.erase(it);
+
+            ++version;
+        }
+
+        size_t Hierarchy::GetParent(size_t internalId) const
+        {
+            auto it = nodes.find(internalId);
+            return it == nodes.end() ? NO_PARENT : it->second.parent;
+        }
+
+        const std::vector<size_t>& Hierarchy::GetChildren(size_t internalId) const
+        {
+            static const std::vector<size_t> NO_CHILDREN;
+
+            auto it = nodes.find(internalId);
+            return it == nodes.end() ? NO_CHILDREN : it->second.children;
+        }
+
+        bool Hierarchy::IsMember(size_t internalId) const
+        {
+            return nodes.find(internalId) != nodes.end();
+        }
+
+        void Hierarchy::RemoveSubtree(size_t internalId, std::vector<size_t>& descendants)
+        {
+            if (!IsMember(internalId))
+                return;
+
+            Unparent(internalId);
+
+            // Walk the subtree breadth-first, erasing the nodes as they are visited.
+            size_t first = descendants.size();
+            std::vector<size_t> children;
+            children.swap(nodes[internalId].children);
+            nodes.erase(internalId);
+            descendants.insert(descendants.end(), children.begin(), children.end());
+
+            for (size_t i = first; i < descendants.size(); ++i)
+            {
+                auto it = nodes.find(descendants[i]);
+                children.swap(it->second.children);
+                nodes.erase(it);
+                descendants.insert(descendants.end(), children.begin(), children.end());
+                children.clear();
+            }
+
+            ++version;
+        }
+
+        void Hierarchy::Detach(size_t internalId)
+        {
+            auto it = nodes.find(internalId);
+            if (it == nodes.end())
+                return;
+
+            std::vector<size_t> children = it->second.children;
+            for (auto child : children)
+                SetParent(child, NO_PARENT);
+            SetParent(internalId, NO_PARENT);
+        }
+
+        const std::vector<size_t>& Hierarchy::Sort(ComponentPoolBase* pool, ComponentType componentType)
+        {
+            SortedPool& sorted = sortedPools[componentType];
+            if (sorted.hierarchyVersion == version && sorted.poolVersion == pool->GetVersion())
+                return sorted.parents;
+
+            UpdateOrder();
+
+            // Swap the components of the members to the front, in order.
+            size_t count = 0;
+            for (auto internalId : order)
+            {
+                size_t index = pool->IndexOf(internalId);
+                if (index == ComponentPoolBase::INVALID_INDEX)
+                    continue;
+
+                pool->Swap(count, index);
+                ++count;
+            }
+
+            // Parents come first, so their components have been placed already.
+            sorted.parents.resize(count);
+            for (size_t i = 0; i < count; ++i)
+            {
+                size_t parent = GetParent(pool->GetInternalId(i));
+                size_t parentIndex = parent == NO_PARENT ? ComponentPoolBase::INVALID_INDEX : pool->IndexOf(parent);
+                sorted.parents[i] = parentIndex == ComponentPoolBase::INVALID_INDEX ? NO_PARENT : parentIndex;
+            }
+
+            sorted.hierarchyVersion = version;
+            sorted.poolVersion = pool->GetVersion();
+            return sorted.parents;
+        }
+
+        Hierarchy::Node& Hierarchy::GetNode(size_t internalId)
+        {
+            auto it = nodes.find(internalId);
+            if (it != nodes.end())
+                return it->second;
+
+            Node& node = nodes[internalId];
+            node.parent = NO_PARENT;
+            return node;
+        }
+
+        void Hierarchy::Unparent(size_t internalId)
+        {
+            auto it = nodes.find(internalId);
+            if (it == nodes.end() || it->second.parent == NO_PARENT)
+                return;
+
+            size_t parent = it->second.parent;
+            it->second.parent = NO_PARENT;
+
+            std::vector<size_t>& siblings = nodes[parent].children;
+            siblings.erase(std::find(siblings.begin(), siblings.end(), internalId));
+            if (siblings.empty() && nodes[parent].parent == NO_PARENT)
+                nodes.erase(parent);
+        }
+
+        void Hierarchy::UpdateOrder()
+        {
+            if (orderVersion == version)
+                return;
+
+            order.clear();
+            for (auto& node : nodes)
+            {
+                if (node.second.parent == NO_PARENT)
+                    order.push_back(node.first);
+            }
+            std::sort(order.begin(), order.end());
+
+            for (size_t i = 0; i < order.size(); ++i)
+            {
+                const std::vector<size_t>& children = nodes[order[i]].children;
+                order.insert(order.end(), children.begin(), children.end());
+            }
+
+            orderVersion = version;
+        }
+    }
+}
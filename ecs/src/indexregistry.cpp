@@ -0,0 +1,112 @@
+#include "../include/indexregistry.h"
+#include "../include/entitymanager.h"
+
+namespace ECS
+{
+    namespace Private
+    {
+        IndexRegistry::IndexRegistry(EntityManager* entityManager)
+        {
+            this->entityManager = entityManager;
+        }
+
+        IndexRegistry::~IndexRegistry()
+        {
+            for (size_t i = 0; i < MAX_COMPONENTS; ++i)
+            {
+                for (auto index : indexes[i])
+                    delete index;
+            }
+        }
+
+        void IndexRegistry::Add(ComponentType componentType, FieldIndexBase* index)
+        {
+            indexes[componentType].push_back(index);
+
+            // Index the components that are already there, leaving out prefabs and removed components.
+            ComponentPoolBase* pool = entityManager->pools[componentType];
+            for (size_t i = 0; i < pool->Size(); ++i)
+            {
+                size_t internalId = pool->GetInternalId(i);
+                const InternalEntity& internalEntity = entityManager->entities[internalId];
+                if (!internalEntity.prefab && internalEntity.flags.test(componentType))
+                    index->Update(internalEntity.entity, internalId);
+            }
+        }
+
+        const std::vector<FieldIndexBase*>& IndexRegistry::GetIndexes(ComponentType componentType) const
+        {
+            return indexes[componentType];
+        }
+
+        void IndexRegistry::AddReferenceIndex(ReferenceIndexBase* index)
+        {
+            Add(index->GetComponentType(), index);
+            referenceIndexes.push_back(index);
+        }
+
+        bool IndexRegistry::HasReferenceIndexes() const
+        {
+            return !referenceIndexes.empty();
+        }
+
+        void IndexRegistry::ClearReferences(Entity target, std::vector<std::pair<Entity, ComponentType>>& changed)
+        {
+            for (auto index : referenceIndexes)
+            {
+                // Clearing a reference removes its owner from the index and may free the list, so look it up every time.
+                while (!index->FindOwners(target).empty())
+                {
+                    Entity owner = index->FindOwners(target).back();
+                    index->Clear(owner, entityManager->GetInternalId(owner));
+                    changed.push_back(std::make_pair(owner, index->GetComponentType()));
+                }
+            }
+        }
+
+        void IndexRegistry::EntityCreated(Entity) {}
+
+        void IndexRegistry::EntityRemoved(Entity entity)
+        {
+            for (size_t i = 0; i < MAX_COMPONENTS; ++i)
+            {
+                for (auto index : indexes[i])
+                    index->Erase(entity);
+            }
+        }
+
+        void IndexRegistry::ComponentAdded(Entity entity, ComponentType componentType)
+        {
+            ComponentChanged(entity, componentType);
+        }
+
+        void IndexRegistry::ComponentRemoved(Entity entity, ComponentType componentType)
+        {
+            for (auto index : indexes[componentType])
+                index->Erase(entity);
+        }
+
+        void IndexRegistry::ComponentsAdded(Entity entity, const std::bitset<MAX_COMPONENTS>& componentTypes)
+        {
+            size_t internalId = entityManager->GetInternalId(entity);
+            for (size_t i = 0; i < MAX_COMPONENTS; ++i)
+            {
+                if (!componentTypes.test(i))
+                    continue;
+
+                for (auto index : indexes[i])
+                    index->Update(entity, internalId);
+            }
+        }
+
+        void IndexRegistry::ComponentChanged(Entity entity, ComponentType componentType)
+        {
+            if (indexes[componentType].empty())
+                return;
+
+            size_t internalId = entityManager->GetInternalId(entity);
+            for (auto index : indexes[componentType])
+                index->Update(entity, internalId);
+        }
+    }
+}
@@ -0,0 +1,202 @@
+#include "../include/profiler.h"
+
+#ifdef __linux__
+#include <cstring>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+namespace ECS
+{
+    namespace
+    {
+#ifdef __linux__
+        /**
+         * @brief The perf event type and config of every counter.
+         *
+         */
+        const uint32_t COUNTER_TYPES[ProfileStatistics::COUNTER_COUNT] =
+        {
+            PERF_TYPE_HARDWARE,
+            PERF_TYPE_HARDWARE,
+            PERF_TYPE_HW_CACHE,
+            PERF_TYPE_HARDWARE,
+            PERF_TYPE_HARDWARE
+        };
+
+        const uint64_t COUNTER_CONFIGS[ProfileStatistics::COUNTER_COUNT] =
+        {
+            PERF_COUNT_HW_CPU_CYCLES,
+            PERF_COUNT_HW_INSTRUCTIONS,
+            PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16),
+            PERF_COUNT_HW_CACHE_MISSES,
+            PERF_COUNT_HW_BRANCH_MISSES
+        };
+
+        /**
+         * @brief Open a counter for the calling thread, in the group of the given leader.
+         *
+         * @return The file descriptor or -1 on failure.
+         */
+        int OpenCounter(size_t counter, int leader)
+        {
+            perf_event_attr attributes;
+            std::memset(&attributes, 0, sizeof(attributes));
+            attributes.size = sizeof(attributes);
+            attributes.type = COUNTER_TYPES[counter];
+            attributes.config = COUNTER_CONFIGS[counter];
+            attributes.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+            attributes.disabled = (leader == -1) ? 1 : 0;
+            attributes.exclude_kernel = 1;
+            attributes.exclude_hv = 1;
+
+            return static_cast<int>(syscall(__NR_perf_event_open, &attributes, 0, -1, leader, 0));
+        }
+#endif
+    }
+
+    ProfileStatistics::ProfileStatistics()
+    {
+        calls = 0;
+        nanoseconds = 0;
+        for (size_t i = 0; i < COUNTER_COUNT; ++i)
+            counters[i] = 0;
+    }
+
+    Profiler::Profiler()
+    {
+        leader = -1;
+        openCount = 0;
+        frameCount = 0;
+        for (size_t i = 0; i < ProfileStatistics::COUNTER_COUNT; ++i)
+        {
+            descriptors[i] = -1;
+            positions[i] = 0;
+        }
+
+#ifdef __linux__
+        // The first counter that opens leads the group, so all counters are scheduled together.
+        for (size_t i = 0; i < ProfileStatistics::COUNTER_COUNT; ++i)
+        {
+            descriptors[i] = OpenCounter(i, leader);
+            if (descriptors[i] == -1)
+                continue;
+
+            if (leader == -1)
+                leader = descriptors[i];
+            positions[i] = openCount++;
+        }
+
+        if (leader != -1)
+        {
+            ioctl(leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+            ioctl(leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+        }
+#endif
+    }
+
+    Profiler::~Profiler()
+    {
+#ifdef __linux__
+        for (size_t i = 0; i < ProfileStatistics::COUNTER_COUNT; ++i)
+        {
+            if (descriptors[i] != -1)
+                close(descriptors[i]);
+        }
+#endif
+    }
+
+    bool Profiler::IsAvailable(ProfileStatistics::Counter counter) const
+    {
+        return descriptors[counter] != -1;
+    }
+
+    void Profiler::Read(Sample& sample) const
+    {
+        for (size_t i = 0; i < ProfileStatistics::COUNTER_COUNT; ++i)
+            sample.counters[i] = 0;
+        sample.enabled = 0;
+        sample.running = 0;
+
+#ifdef __linux__
+        if (leader != -1)
+        {
+            // Group read layout: count, time enabled, time running, then one value per counter.
+            uint64_t values[3 + ProfileStatistics::COUNTER_COUNT];
+            ssize_t expected = static_cast<ssize_t>((3 + openCount) * sizeof(uint64_t));
+            if (read(leader, values, sizeof(values)) == expected)
+            {
+                sample.enabled = values[1];
+                sample.running = values[2];
+                for (size_t i = 0; i < ProfileStatistics::COUNTER_COUNT; ++i)
+                {
+                    if (descriptors[i] != -1)
+                        sample.counters[i] = values[3 + positions[i]];
+                }
+            }
+        }
+#endif
+
+        // Read the clock last, so that reading the counters is not part of the measured time.
+        sample.time = std::chrono::steady_clock::now();
+    }
+
+    void Profiler::Record(const void* section, const Sample& begin)
+    {
+        Sample end;
+        Read(end);
+
+        ProfileStatistics delta;
+        delta.calls = 1;
+        delta.nanoseconds = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(end.time - begin.time).count());
+
+        // If the counters were multiplexed with other events, scale them up to the time they were enabled.
+        uint64_t enabled = end.enabled - begin.enabled;
+        uint64_t running = end.running - begin.running;
+        double scale = (running > 0 && running < enabled) ? static_cast<double>(enabled) / static_cast<double>(running) : 1.0;
+        for (size_t i = 0; i < ProfileStatistics::COUNTER_COUNT; ++i)
+            delta.counters[i] = static_cast<uint64_t>(static_cast<double>(end.counters[i] - begin.counters[i]) * scale);
+
+        ProfileStatistics* targets[] = { &currentFrame[section], &total[section] };
+        for (auto target : targets)
+        {
+            target->calls += delta.calls;
+            target->nanoseconds += delta.nanoseconds;
+            for (size_t i = 0; i < ProfileStatistics::COUNTER_COUNT; ++i)
+                target->counters[i] += delta.counters[i];
+        }
+    }
+
+    void Profiler::NextFrame()
+    {
+        lastFrame.swap(currentFrame);
+        currentFrame.clear();
+        ++frameCount;
+    }
+
+    size_t Profiler::GetFrameCount() const
+    {
+        return frameCount;
+    }
+
+    ProfileStatistics Profiler::GetFrameStatistics(const void* section) const
+    {
+        return Find(lastFrame, section);
+    }
+
+    ProfileStatistics Profiler::GetTotalStatistics(const void* section) const
+    {
+        return Find(total, section);
+    }
+
+    ProfileStatistics Profiler::Find(const std::unordered_map<const void*, ProfileStatistics>& statistics, const void* section)
+    {
+        auto it = statistics.find(section);
+        if (it == statistics.end())
+            return ProfileStatistics();
+
+        return it->second;
+    }
+}
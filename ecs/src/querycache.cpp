@@ -0,0 +1,133 @@
+#include "../include/querycache.h"
+#include "../include/entitymanager.h"
+
+namespace ECS
+{
+    namespace Private
+    {
+        QueryCache::QueryCache(EntityManager* entityManager)
+        {
+            this->entityManager = entityManager;
+            age = 0;
+        }
+
+        QueryCache::~QueryCache()
+        {
+            for (auto& query : queries)
+                delete query.second;
+        }
+
+        const std::vector<Entity>& QueryCache::Get(const std::bitset<MAX_COMPONENTS>& mask)
+        {
+            auto it = queries.find(mask);
+            if (it == queries.end())
+            {
+                // Compute the result once; it is kept up to date from here on.
+                CachedQuery* query = new CachedQuery;
+                for (auto entity : entityManager->GetActiveEntities())
+                {
+                    if ((entityManager->GetEntityFlag(entity) & mask) == mask)
+                        Insert(query, entity);
+                }
+
+                it = queries.insert(std::make_pair(mask, query)).first;
+            }
+
+            it->second->lastUsed = age;
+            return it->second->entities;
+        }
+
+        void QueryCache::Tick()
+        {
+            ++age;
+            for (auto it = queries.begin(); it != queries.end();)
+            {
+                if (age - it->second->lastUsed > static_cast<size_t>(QUERY_EVICTION_AGE))
+                {
+                    delete it->second;
+                    it = queries.erase(it);
+                }
+                else
+                {
+                    ++it;
+                }
+            }
+        }
+
+        size_t QueryCache::GetQueryCount() const
+        {
+            return queries.size();
+        }
+
+        void QueryCache::EntityCreated(Entity entity)
+        {
+            // Only the empty mask matches an entity without components.
+            Update(entity, std::bitset<MAX_COMPONENTS>());
+        }
+
+        void QueryCache::EntityRemoved(Entity entity)
+        {
+            for (auto& query : queries)
+                Erase(query.second, entity);
+        }
+
+        void QueryCache::ComponentAdded(Entity entity, ComponentType componentType)
+        {
+            std::bitset<MAX_COMPONENTS> changed;
+            changed.set(componentType, true);
+            Update(entity, changed);
+        }
+
+        void QueryCache::ComponentRemoved(Entity entity, ComponentType componentType)
+        {
+            std::bitset<MAX_COMPONENTS> changed;
+            changed.set(componentType, true);
+            Update(entity, changed);
+        }
+
+        void QueryCache::ComponentsAdded(Entity entity, const std::bitset<MAX_COMPONENTS>& componentTypes)
+        {
+            Update(entity, componentTypes);
+        }
+
+        void QueryCache::Update(Entity entity, const std::bitset<MAX_COMPONENTS>& changed)
+        {
+            const std::bitset<MAX_COMPONENTS>& flags = entityManager->GetEntityFlag(entity);
+            for (auto& query : queries)
+            {
+                const std::bitset<MAX_COMPONENTS>& mask = query.first;
+                if (mask.any() && (mask & changed).none())
+                    continue;
+
+                if ((flags & mask) == mask)
+                    Insert(query.second, entity);
+                else
+                    Erase(query.second, entity);
+            }
+        }
+
+        void QueryCache::Insert(CachedQuery* query, Entity entity)
+        {
+            if (query->indices.find(entity) != query->indices.end())
+                return;
+
+            query->indices[entity] = query->entities.size();
+            query->entities.push_back(entity);
+        }
+
+        void QueryCache::Erase(CachedQuery* query, Entity entity)
+        {
+            auto it = query->indices.find(entity);
+            if (it == query->indices.end())
+                return;
+
+            // Move the last entity into the hole.
+            size_t index = it->second;
+            Entity moved = query->entities.back();
+            query->entities[index] = moved;
+            query->indices[moved] = index;
+            query->entities.pop_back();
+            query->indices.erase(entity);
+        }
+    }
+}
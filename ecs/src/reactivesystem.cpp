@@ -0,0 +1,58 @@
+#include <algorithm>
+#include "../include/reactivesystem.h"
+
+namespace ECS
+{
+    ReactiveSystem::Change::Change(Entity entity, bool matched)
+    {
+        this->entity = entity;
+        this->matched = matched;
+    }
+
+    bool ReactiveSystem::Change::operator<(const Change& rhs) const
+    {
+        return entity < rhs.entity;
+    }
+
+
+    ReactiveSystem::~ReactiveSystem() {}
+
+    void ReactiveSystem::ProcessEntities()
+    {
+        // Group the changes per entity, keeping the order in which they happened.
+        std::stable_sort(changes.begin(), changes.end());
+
+        entered.clear();
+        exited.clear();
+        for (size_t first = 0; first < changes.size(); )
+        {
+            size_t last = first;
+            while (last + 1 < changes.size() && changes[last + 1].entity == changes[first].entity)
+                ++last;
+
+            // Changes alternate for an entity, so the first one tells whether it matched before and the
+            // last one whether it matches now.
+            bool matchedBefore = !changes[first].matched;
+            bool matchesNow = changes[last].matched;
+            if (!matchedBefore && matchesNow)
+                entered.push_back(changes[first].entity);
+            else if (matchedBefore && !matchesNow)
+                exited.push_back(changes[first].entity);
+
+            first = last + 1;
+        }
+        changes.clear();
+
+        if (!exited.empty())
+            ProcessExited(exited);
+        if (!entered.empty())
+            ProcessEntered(entered);
+    }
+
+    void ReactiveSystem::ProcessEntity(Entity) {}
+
+    void ReactiveSystem::MembershipChanged(Entity entity, bool matched)
+    {
+        changes.push_back(Change(entity, matched));
+    }
+}
@@ -0,0 +1,125 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include "../include/replay.h"
+
+namespace ECS
+{
+    TraceReplayer::TraceReplayer()
+    {
+        for (size_t i = 0; i < TraceOperation::TYPE_COUNT; ++i)
+            sorted[i] = true;
+    }
+
+    bool TraceReplayer::Replay(TraceReader& reader, ReplayTarget& target)
+    {
+        TraceOperation operation;
+        while (reader.Next(operation))
+        {
+            // Look up the entity before starting the clock.
+            Entity entity = INVALID_ENTITY;
+            if (operation.type == TraceOperation::REMOVE_ENTITY || operation.type == TraceOperation::ADD_COMPONENT || operation.type == TraceOperation::REMOVE_COMPONENT)
+            {
+                auto it = entities.find(operation.entity);
+                if (it == entities.end())
+                    return false;
+
+                entity = it->second;
+                if (operation.type == TraceOperation::REMOVE_ENTITY)
+                    removedEntities.push_back(operation.entity);
+            }
+            else if (operation.type == TraceOperation::DESTROY_REMOVED)
+            {
+                for (auto removed : removedEntities)
+                    entities.erase(removed);
+                removedEntities.clear();
+            }
+
+            ComponentType componentType = static_cast<ComponentType>(operation.id);
+            std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+            switch (operation.type)
+            {
+            case TraceOperation::CREATE_ENTITY:
+                entities[operation.entity] = target.CreateEntity();
+                break;
+            case TraceOperation::REMOVE_ENTITY:
+                target.RemoveEntity(entity);
+                break;
+            case TraceOperation::ADD_COMPONENT:
+                target.AddComponent(entity, componentType);
+                break;
+            case TraceOperation::REMOVE_COMPONENT:
+                target.RemoveComponent(entity, componentType);
+                break;
+            case TraceOperation::DESTROY_REMOVED:
+                target.DestroyRemoved();
+                break;
+            case TraceOperation::PROCESS:
+                target.Process(operation.id);
+                break;
+            case TraceOperation::DECLARE_COMPONENT:
+                target.DeclareComponent(componentType, operation.size);
+                continue;
+            case TraceOperation::DECLARE_SYSTEM:
+                target.DeclareSystem(operation.id, operation.aspect, operation.exclude, operation.anyOf);
+                continue;
+            default:
+                return false;
+            }
+            std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+            latencies[operation.type].push_back(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count()));
+            sorted[operation.type] = false;
+        }
+
+        return reader.IsValid();
+    }
+
+    size_t TraceReplayer::GetCount(TraceOperation::Type type) const
+    {
+        return latencies[type].size();
+    }
+
+    uint64_t TraceReplayer::GetTotalNanoseconds(TraceOperation::Type type) const
+    {
+        uint64_t total = 0;
+        for (auto latency : latencies[type])
+            total += latency;
+        return total;
+    }
+
+    uint64_t TraceReplayer::GetPercentile(TraceOperation::Type type, double percentile)
+    {
+        std::vector<uint64_t>& values = latencies[type];
+        if (values.empty())
+            return 0;
+
+        if (!sorted[type])
+        {
+            std::sort(values.begin(), values.end());
+            sorted[type] = true;
+        }
+
+        // Nearest rank.
+        double rank = percentile / 100.0 * static_cast<double>(values.size());
+        size_t index = rank <= 1.0 ? 0 : static_cast<size_t>(std::ceil(rank)) - 1;
+        return values[std::min(index, values.size() - 1)];
+    }
+
+    const char* TraceReplayer::GetName(TraceOperation::Type type)
+    {
+        static const char* const NAMES[TraceOperation::TYPE_COUNT] =
+        {
+            "CreateEntity",
+            "RemoveEntity",
+            "AddComponent",
+            "RemoveComponent",
+            "DestroyRemoved",
+            "Process",
+            "DeclareComponent",
+            "DeclareSystem"
+        };
+
+        return type < TraceOperation::TYPE_COUNT ? NAMES[type] : "Unknown";
+    }
+}
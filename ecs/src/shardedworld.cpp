@@ -0,0 +1,98 @@
+#include "../include/shardedworld.h"
+
+namespace ECS
+{
+    const size_t ShardedWorld::INVALID_SHARD = static_cast<size_t>(-1);
+
+
+    ShardedWorld::ShardedWorld(size_t shardCount, size_t reservedEntityCount)
+    {
+        assert(shardCount > 0);
+
+        for (size_t i = 0; i < shardCount; ++i)
+        {
+            EntityManager* entityManager = new EntityManager(reservedEntityCount);
+            entityManager->nextUUID = static_cast<Entity>(i);
+            entityManager->uuidStride = static_cast<Entity>(shardCount);
+
+            entityManagers.push_back(entityManager);
+            systemManagers.push_back(new SystemManager(entityManager));
+        }
+    }
+
+    ShardedWorld::~ShardedWorld()
+    {
+        // The system managers observe the entity managers, so they go first.
+        for (auto systemManager : systemManagers)
+            delete systemManager;
+        for (auto entityManager : entityManagers)
+            delete entityManager;
+    }
+
+    size_t ShardedWorld::GetShardCount() const
+    {
+        return entityManagers.size();
+    }
+
+    EntityManager* ShardedWorld::GetEntityManager(size_t shard)
+    {
+        assert(shard < entityManagers.size());
+        return entityManagers[shard];
+    }
+
+    SystemManager* ShardedWorld::GetSystemManager(size_t shard)
+    {
+        assert(shard < systemManagers.size());
+        return systemManagers[shard];
+    }
+
+    size_t ShardedWorld::Resolve(Entity entity) const
+    {
+        auto it = migrated.find(entity);
+        size_t shard = (it != migrated.end()) ? it->second : GetHomeShard(entity);
+
+        if (entityManagers[shard]->IsDestroyed(entity))
+            return INVALID_SHARD;
+
+        return shard;
+    }
+
+    void ShardedWorld::Migrate(const std::vector<Entity>& entities, size_t from, size_t to)
+    {
+        assert(from < entityManagers.size() && to < entityManagers.size());
+        if (from == to)
+            return;
+
+        entityManagers[from]->MigrateEntities(entities, entityManagers[to]);
+
+        for (auto entity : entities)
+        {
+            if (GetHomeShard(entity) == to)
+                migrated.erase(entity);
+            else
+                migrated[entity] = to;
+        }
+    }
+
+    void ShardedWorld::DestroyRemoved()
+    {
+        for (size_t shard = 0; shard < entityManagers.size(); ++shard)
+        {
+            // Forget migrated entities that are about to be destroyed. Only the removed entities are looked at, so
+            // the cost does not grow with the number of entities that have ever been migrated.
+            for (auto entity : entityManagers[shard]->entitiesToDestroy)
+            {
+                auto it = migrated.find(entity);
+                if (it != migrated.end() && it->second == shard)
+                    migrated.erase(it);
+            }
+
+            entityManagers[shard]->DestroyRemoved();
+        }
+    }
+
+    size_t ShardedWorld::GetHomeShard(Entity entity) const
+    {
+        return static_cast<size_t>(entity % entityManagers.size());
+    }
+}
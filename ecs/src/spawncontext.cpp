@@ -0,0 +1,38 @@
+#include "../include/spawncontext.h"
+
+namespace ECS
+{
+    const size_t SpawnContext::CLAIM_COUNT;
+
+
+    SpawnContext::SpawnContext(EntityManager* entityManager)
+    {
+        this->entityManager = entityManager;
+        freeIds.reserve(CLAIM_COUNT);
+    }
+
+    Entity SpawnContext::CreateEntity()
+    {
+        Entity entity = entityManager->NextUUID();
+
+        if (freeIds.empty())
+            entityManager->ClaimInternalIds(freeIds, CLAIM_COUNT);
+
+        size_t internalId = freeIds.back();
+        freeIds.pop_back();
+
+        // The slot is owned by this context until the spawning ends, so it can be written without locking.
+        entityManager->entities[internalId].entity = entity;
+        created.push_back(std::make_pair(entity, internalId));
+
+        return entity;
+    }
+
+    size_t SpawnContext::GetInternalId(Entity entity) const
+    {
+        auto it = std::lower_bound(created.begin(), created.end(), std::make_pair(entity, static_cast<size_t>(0)));
+        assert(it != created.end() && it->first == entity);
+
+        return it->second;
+    }
+}
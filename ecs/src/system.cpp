@@ -1,20 +1,335 @@
+#include <cassert>
+#include <algorithm>
+#include <chrono>
 #include "../include/system.h"
+#include "../include/trace.h"
 
 namespace ECS
 {
+    namespace
+    {
+        /**
+         * @brief The number of entities visited between checks of the time budget.
+         *
+         */
+        const size_t TIME_CHECK_INTERVAL = 8;
+    }
+
+    EntitySystem::EntitySystem()
+    {
+        entityManager = nullptr;
+        profiler = nullptr;
+        recorder = nullptr;
+        traceIndex = 0;
+        enabledCount = 0;
+        membershipVersion = 0;
+        interval = 1;
+        tick = 0;
+        sliceSize = 0;
+        timeBudget = 0;
+        sliceCursor = 0;
+        processing = false;
+        needsCompacting = false;
+    }
+
     EntitySystem::~EntitySystem() {}
 
     void EntitySystem::Process()
     {
-        // TODO: Figure out a way of looping properly when entities can be added/removed in every ProcessEntity.
-        for (auto entity : entities)
-        {
-            ProcessEntity(entity);
-        }
+        if (recorder != nullptr)
+            recorder->Process(traceIndex, *this);
+
+        if (tick++ % interval != 0)
+            return;
+
+        Profiler::Sample begin;
+        if (profiler != nullptr)
+            profiler->Read(begin);
+
+        processing = true;
+        ProcessEntities();
+        processing = false;
+
+        if (needsCompacting)
+            Compact();
+
+        if (profiler != nullptr)
+            profiler->Record(this, begin);
     }
 
     const std::bitset<MAX_COMPONENTS>& EntitySystem::GetAspect() const
     {
         return aspect;
     }
+
+    const std::bitset<MAX_COMPONENTS>& EntitySystem::GetExclude() const
+    {
+        return exclude;
+    }
+
+    const std::bitset<MAX_COMPONENTS>& EntitySystem::GetAnyOf() const
+    {
+        return anyOf;
+    }
+
+    bool EntitySystem::HasEntity(Entity entity) const
+    {
+        return indices.find(entity) != indices.end();
+    }
+
+    size_t EntitySystem::GetEntityCount() const
+    {
+        return indices.size();
+    }
+
+    size_t EntitySystem::GetEnabledEntityCount() const
+    {
+        return enabledCount;
+    }
+
+    void EntitySystem::SetInterval(size_t interval)
+    {
+        assert(interval > 0);
+        this->interval = interval;
+        tick = 0;
+    }
+
+    void EntitySystem::SetSliceSize(size_t entityCount)
+    {
+        sliceSize = entityCount;
+    }
+
+    void EntitySystem::SetTimeBudget(size_t microseconds)
+    {
+        timeBudget = microseconds;
+    }
+
+    EntityManager* EntitySystem::GetEntityManager() const
+    {
+        return entityManager;
+    }
+
+    void EntitySystem::ProcessEntities()
+    {
+        if (IsSliced())
+        {
+            ProcessSlice();
+            return;
+        }
+
+        // The enabled part of the list does not move while processing, so the count stays the same.
+        for (size_t i = 0; i < enabledCount; ++i)
+        {
+            if (IsProcessable(i))
+                ProcessEntity(entities[i]);
+        }
+    }
+
+    const std::vector<Entity>& EntitySystem::GetEntities() const
+    {
+        return entities;
+    }
+
+    bool EntitySystem::IsProcessable(size_t index) const
+    {
+        return entities[index] != INVALID_ENTITY && enabledStates[index];
+    }
+
+    const std::vector<size_t>& EntitySystem::GetInternalIds() const
+    {
+        return internalIds;
+    }
+
+    size_t EntitySystem::GetMembershipVersion() const
+    {
+        return membershipVersion;
+    }
+
+    bool EntitySystem::Insert(Entity entity, size_t internalId, bool enabled)
+    {
+        if (!indices.insert(std::make_pair(entity, entities.size())).second)
+            return false;
+
+        entities.push_back(entity);
+        internalIds.push_back(internalId);
+        enabledStates.push_back(enabled);
+        ++membershipVersion;
+
+        if (processing)
+        {
+            // Leave the entity at the end; it is moved to the right part of the list after the pass.
+            needsCompacting = true;
+        }
+        else if (enabled)
+        {
+            Swap(entities.size() - 1, enabledCount);
+            ++enabledCount;
+        }
+
+        return true;
+    }
+
+    bool EntitySystem::Erase(Entity entity)
+    {
+        auto it = indices.find(entity);
+        if (it == indices.end())
+            return false;
+
+        size_t index = it->second;
+        ++membershipVersion;
+
+        if (processing)
+        {
+            // Leave a placeholder so that the processing loop is not disturbed.
+            indices.erase(it);
+            entities[index] = INVALID_ENTITY;
+            needsCompacting = true;
+            return true;
+        }
+
+        // Move the entity to the end of the enabled part, then to the end of the list.
+        if (index < enabledCount)
+        {
+            index = LeaveVisited(index);
+            --enabledCount;
+            Swap(index, enabledCount);
+            index = enabledCount;
+        }
+        Swap(index, entities.size() - 1);
+
+        indices.erase(entity);
+        entities.pop_back();
+        internalIds.pop_back();
+        enabledStates.pop_back();
+        return true;
+    }
+
+    void EntitySystem::SetEnabled(Entity entity, bool enabled)
+    {
+        auto it = indices.find(entity);
+        if (it == indices.end())
+            return;
+
+        size_t index = it->second;
+        if (enabledStates[index] == enabled)
+            return;
+
+        enabledStates[index] = enabled;
+        ++membershipVersion;
+
+        if (processing)
+        {
+            needsCompacting = true;
+        }
+        else if (enabled)
+        {
+            Swap(index, enabledCount);
+            ++enabledCount;
+        }
+        else
+        {
+            index = LeaveVisited(index);
+            --enabledCount;
+            Swap(index, enabledCount);
+        }
+    }
+
+    void EntitySystem::Swap(size_t a, size_t b)
+    {
+        if (a == b)
+            return;
+
+        std::swap(entities[a], entities[b]);
+        std::swap(internalIds[a], internalIds[b]);
+        bool state = enabledStates[a];
+        enabledStates[a] = enabledStates[b];
+        enabledStates[b] = state;
+
+        indices[entities[a]] = a;
+        indices[entities[b]] = b;
+    }
+
+    bool EntitySystem::IsSliced() const
+    {
+        return sliceSize > 0 || timeBudget > 0;
+    }
+
+    void EntitySystem::ProcessSlice()
+    {
+        // Start a new round when the previous one is finished.
+        if (sliceCursor >= enabledCount)
+            sliceCursor = 0;
+
+        std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + std::chrono::microseconds(timeBudget);
+        size_t end = (sliceSize > 0) ? std::min(enabledCount, sliceCursor + sliceSize) : enabledCount;
+        size_t visited = 0;
+
+        // The cursor is advanced before visiting, so that entities removed or disabled by ProcessEntity are behind it.
+        while (sliceCursor < end)
+        {
+            size_t i = sliceCursor++;
+            if (IsProcessable(i))
+                ProcessEntity(entities[i]);
+
+            if (timeBudget > 0 && ++visited % TIME_CHECK_INTERVAL == 0 && std::chrono::steady_clock::now() >= deadline)
+                break;
+        }
+    }
+
+    size_t EntitySystem::LeaveVisited(size_t index)
+    {
+        if (index >= sliceCursor)
+            return index;
+
+        // Trade places with the last visited entity, which stays in the visited part.
+        --sliceCursor;
+        Swap(index, sliceCursor);
+        return sliceCursor;
+    }
+
+    void EntitySystem::Compact()
+    {
+        // Rebuild the list with the enabled entities first, keeping the order within each part.
+        size_t visited = 0;
+        std::vector<Entity> compactedEntities;
+        std::vector<size_t> compactedInternalIds;
+        compactedEntities.reserve(indices.size());
+        compactedInternalIds.reserve(indices.size());
+
+        for (int pass = 0; pass < 2; ++pass)
+        {
+            bool enabled = (pass == 0);
+            for (size_t i = 0; i < entities.size(); ++i)
+            {
+                if (entities[i] == INVALID_ENTITY || enabledStates[i] != enabled)
+                    continue;
+
+                if (enabled && i < sliceCursor)
+                    ++visited;
+                indices[entities[i]] = compactedEntities.size();
+                compactedEntities.push_back(entities[i]);
+                compactedInternalIds.push_back(internalIds[i]);
+            }
+
+            if (enabled)
+                enabledCount = compactedEntities.size();
+        }
+
+        entities.swap(compactedEntities);
+        internalIds.swap(compactedInternalIds);
+        enabledStates.assign(entities.size(), false);
+        std::fill(enabledStates.begin(), enabledStates.begin() + static_cast<std::ptrdiff_t>(enabledCount), true);
+        sliceCursor = visited;
+        needsCompacting = false;
+        ++membershipVersion;
+    }
+
+    void EntitySystem::MembershipChanged(Entity, bool) {}
+
+    bool EntitySystem::Matches(const std::bitset<MAX_COMPONENTS>& flags) const
+    {
+        return (flags & aspect) == aspect &&
+               (flags & exclude).none() &&
+               (anyOf.none() || (flags & anyOf).any());
+    }
 }
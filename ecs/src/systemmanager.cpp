@@ -6,10 +6,15 @@ namespace ECS
     SystemManager::SystemManager(EntityManager* entityManager)
     {
         this->entityManager = entityManager;
+        profiler = nullptr;
+        recorder = nullptr;
+        entityManager->AddEntityObserver(this);
     }
 
     SystemManager::~SystemManager()
     {
+        entityManager->RemoveEntityObserver(this);
+
         for (size_t i = 0; i < systems.size(); ++i)
             delete systems[i];
     }
@@ -17,14 +22,34 @@ namespace ECS
     void SystemManager::RegisterSystem(EntitySystem* system)
     {
         systems.push_back(system);
+        system->entityManager = entityManager;
+        system->profiler = profiler;
+        system->recorder = recorder;
+        system->traceIndex = systems.size() - 1;
 
         const std::set<Entity>& activeEntities = entityManager->GetActiveEntities();
         for (auto entity : activeEntities)
         {
-            RematchEntityForSystem(entity, system);
+            size_t internalId = entityManager->GetInternalId(entity);
+            const Private::InternalEntity& internalEntity = entityManager->entities[internalId];
+            RematchEntityForSystem(entity, internalId, internalEntity.flags & ~internalEntity.disabled, internalEntity.enabled, system);
         }
     }
 
+    void SystemManager::SetProfiler(Profiler* profiler)
+    {
+        this->profiler = profiler;
+        for (auto system : systems)
+            system->profiler = profiler;
+    }
+
+    void SystemManager::SetRecorder(TraceRecorder* recorder)
+    {
+        this->recorder = recorder;
+        for (auto system : systems)
+            system->recorder = recorder;
+    }
+
     void SystemManager::EntityCreated(ECS::Entity) {}
 
     void SystemManager::EntityRemoved(ECS::Entity entity)
@@ -32,7 +57,8 @@ namespace ECS
         // Remove the entity from all systems.
         for (auto system : systems)
         {
-            system->entities.erase(entity);
+            if (system->Erase(entity))
+                system->MembershipChanged(entity, false);
         }
     }
 
@@ -41,31 +67,54 @@ namespace ECS
         RematchEntityForAllSystems(entity);
     }
 
+    void SystemManager::ComponentsAdded(ECS::Entity entity, const std::bitset<MAX_COMPONENTS>&)
+    {
+        RematchEntityForAllSystems(entity);
+    }
+
     void SystemManager::ComponentRemoved(ECS::Entity entity, ECS::ComponentType)
     {
         RematchEntityForAllSystems(entity);
     }
 
+    void SystemManager::EntityEnabled(ECS::Entity entity, bool enabled)
+    {
+        // The entity still matches the same systems, so it only moves within their processing lists.
+        for (auto system : systems)
+        {
+            system->SetEnabled(entity, enabled);
+        }
+    }
+
+    void SystemManager::ComponentEnabled(ECS::Entity entity, ECS::ComponentType, bool)
+    {
+        RematchEntityForAllSystems(entity);
+    }
+
     void SystemManager::RematchEntityForAllSystems(ECS::Entity entity)
     {
+        // Look the entity up once for all systems. Disabled components are treated as missing.
+        size_t internalId = entityManager->GetInternalId(entity);
+        const Private::InternalEntity& internalEntity = entityManager->entities[internalId];
+        const std::bitset<MAX_COMPONENTS> entityFlag = internalEntity.flags & ~internalEntity.disabled;
+
         for (auto system = systems.begin(); system != systems.end(); system++)
         {
-            RematchEntityForSystem(entity, *system);
+            RematchEntityForSystem(entity, internalId, entityFlag, internalEntity.enabled, *system);
         }
     }
 
-    void SystemManager::RematchEntityForSystem(Entity entity, EntitySystem* system)
+    void SystemManager::RematchEntityForSystem(Entity entity, size_t internalId, const std::bitset<MAX_COMPONENTS>& entityFlag, bool enabled, EntitySystem* system)
     {
-        const std::bitset<MAX_COMPONENTS>& entityFlag = entityManager->GetEntityFlag(entity);
-        const std::bitset<MAX_COMPONENTS>& systemAspect = system->GetAspect();
-
-        if ((entityFlag & systemAspect) == systemAspect)
+        if (system->Matches(entityFlag))
         {
-            system->entities.insert(entity);
+            if (system->Insert(entity, internalId, enabled))
+                system->MembershipChanged(entity, true);
         }
         else
         {
-            system->entities.erase(entity);
+            if (system->Erase(entity))
+                system->MembershipChanged(entity, false);
         }
     }
 }
@@ -0,0 +1,251 @@
+#include "../include/trace.h"
+#include "../include/system.h"
+
+namespace ECS
+{
+    namespace
+    {
+        /**
+         * @brief Written at the start of every trace.
+         *
+         */
+        const char TRACE_MAGIC[4] = { 'E', 'C', 'S', 'T' };
+        const char TRACE_VERSION = 1;
+
+        /**
+         * @brief The buffer is written to the stream when it grows beyond this size.
+         *
+         */
+        const size_t FLUSH_SIZE = 64 * 1024;
+    }
+
+    TraceOperation::TraceOperation()
+    {
+        type = TYPE_COUNT;
+        entity = INVALID_ENTITY;
+        id = 0;
+        size = 0;
+    }
+
+    TraceRecorder::TraceRecorder(std::ostream& stream) : stream(stream)
+    {
+        operationCount = 0;
+        buffer.reserve(FLUSH_SIZE + 64);
+        buffer.insert(buffer.end(), TRACE_MAGIC, TRACE_MAGIC + sizeof(TRACE_MAGIC));
+        buffer.push_back(TRACE_VERSION);
+    }
+
+    TraceRecorder::~TraceRecorder()
+    {
+        Flush();
+    }
+
+    void TraceRecorder::CreateEntity(Entity entity)
+    {
+        WriteType(TraceOperation::CREATE_ENTITY);
+        WriteVarint(entity);
+    }
+
+    void TraceRecorder::RemoveEntity(Entity entity)
+    {
+        WriteType(TraceOperation::REMOVE_ENTITY);
+        WriteVarint(entity);
+    }
+
+    void TraceRecorder::AddComponent(Entity entity, ComponentType componentType, size_t size)
+    {
+        if (!declaredComponents.test(componentType))
+        {
+            declaredComponents.set(componentType);
+            buffer.push_back(static_cast<char>(TraceOperation::DECLARE_COMPONENT));
+            WriteVarint(componentType);
+            WriteVarint(size);
+        }
+
+        WriteType(TraceOperation::ADD_COMPONENT);
+        WriteVarint(entity);
+        WriteVarint(componentType);
+    }
+
+    void TraceRecorder::RemoveComponent(Entity entity, ComponentType componentType)
+    {
+        WriteType(TraceOperation::REMOVE_COMPONENT);
+        WriteVarint(entity);
+        WriteVarint(componentType);
+    }
+
+    void TraceRecorder::DestroyRemoved()
+    {
+        WriteType(TraceOperation::DESTROY_REMOVED);
+    }
+
+    void TraceRecorder::Process(size_t systemIndex, const EntitySystem& system)
+    {
+        if (systemIndex >= declaredSystems.size())
+            declaredSystems.resize(systemIndex + 1, false);
+
+        if (!declaredSystems[systemIndex])
+        {
+            declaredSystems[systemIndex] = true;
+            buffer.push_back(static_cast<char>(TraceOperation::DECLARE_SYSTEM));
+            WriteVarint(systemIndex);
+            WriteMask(system.GetAspect());
+            WriteMask(system.GetExclude());
+            WriteMask(system.GetAnyOf());
+        }
+
+        WriteType(TraceOperation::PROCESS);
+        WriteVarint(systemIndex);
+    }
+
+    void TraceRecorder::Flush()
+    {
+        stream.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+        stream.flush();
+        buffer.clear();
+    }
+
+    size_t TraceRecorder::GetOperationCount() const
+    {
+        return operationCount;
+    }
+
+    void TraceRecorder::WriteType(TraceOperation::Type type)
+    {
+        // Flush before starting an operation, so the buffer never has to grow in the middle of one.
+        if (buffer.size() >= FLUSH_SIZE)
+            Flush();
+
+        buffer.push_back(static_cast<char>(type));
+        ++operationCount;
+    }
+
+    void TraceRecorder::WriteVarint(uint64_t value)
+    {
+        while (value >= 0x80)
+        {
+            buffer.push_back(static_cast<char>((value & 0x7F) | 0x80));
+            value >>= 7;
+        }
+        buffer.push_back(static_cast<char>(value));
+    }
+
+    void TraceRecorder::WriteMask(const std::bitset<MAX_COMPONENTS>& mask)
+    {
+        WriteVarint(mask.count());
+        for (size_t i = 0; i < MAX_COMPONENTS; ++i)
+        {
+            if (mask.test(i))
+                WriteVarint(i);
+        }
+    }
+
+    TraceReader::TraceReader(std::istream& stream) : stream(stream)
+    {
+        char header[sizeof(TRACE_MAGIC) + 1];
+        valid = static_cast<bool>(stream.read(header, sizeof(header))) &&
+                std::equal(TRACE_MAGIC, TRACE_MAGIC + sizeof(TRACE_MAGIC), header) &&
+                header[sizeof(TRACE_MAGIC)] == TRACE_VERSION;
+    }
+
+    bool TraceReader::IsValid() const
+    {
+        return valid;
+    }
+
+    bool TraceReader::Next(TraceOperation& operation)
+    {
+        if (!valid)
+            return false;
+
+        char type;
+        if (!stream.get(type))
+            return false;
+
+        operation = TraceOperation();
+        if (type < 0 || type >= TraceOperation::TYPE_COUNT)
+        {
+            valid = false;
+            return false;
+        }
+        operation.type = static_cast<TraceOperation::Type>(type);
+
+        uint64_t value = 0;
+        bool read = true;
+        switch (operation.type)
+        {
+        case TraceOperation::CREATE_ENTITY:
+        case TraceOperation::REMOVE_ENTITY:
+            read = ReadVarint(value);
+            operation.entity = value;
+            break;
+        case TraceOperation::ADD_COMPONENT:
+        case TraceOperation::REMOVE_COMPONENT:
+            read = ReadVarint(value) && ReadComponentType(operation.id);
+            operation.entity = value;
+            break;
+        case TraceOperation::PROCESS:
+            read = ReadVarint(value);
+            operation.id = static_cast<size_t>(value);
+            break;
+        case TraceOperation::DECLARE_COMPONENT:
+            read = ReadComponentType(operation.id) && ReadVarint(value);
+            operation.size = static_cast<size_t>(value);
+            break;
+        case TraceOperation::DECLARE_SYSTEM:
+            read = ReadVarint(value) && ReadMask(operation.aspect) && ReadMask(operation.exclude) && ReadMask(operation.anyOf);
+            operation.id = static_cast<size_t>(value);
+            break;
+        default:
+            break;
+        }
+
+        // A trace cut off in the middle of an operation is malformed.
+        valid = read;
+        return valid;
+    }
+
+    bool TraceReader::ReadVarint(uint64_t& value)
+    {
+        value = 0;
+        for (unsigned int shift = 0; shift < 64; shift += 7)
+        {
+            char byte;
+            if (!stream.get(byte))
+                return false;
+
+            value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+            if ((byte & 0x80) == 0)
+                return true;
+        }
+
+        return false;
+    }
+
+    bool TraceReader::ReadComponentType(size_t& componentType)
+    {
+        uint64_t value;
+        if (!ReadVarint(value) || value >= MAX_COMPONENTS)
+            return false;
+
+        componentType = static_cast<size_t>(value);
+        return true;
+    }
+
+    bool TraceReader::ReadMask(std::bitset<MAX_COMPONENTS>& mask)
+    {
+        uint64_t count;
+        if (!ReadVarint(count) || count > MAX_COMPONENTS)
+            return false;
+
+        for (uint64_t i = 0; i < count; ++i)
+        {
+            size_t componentType;
+            if (!ReadComponentType(componentType))
+                return false;
+            mask.set(componentType);
+        }
+
+        return true;
+    }
+}
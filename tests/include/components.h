@@ -12,3 +12,14 @@ struct Component2 : public ECS::Component<Component2>
     float foo;
     char bar[32];
 };
+
+struct Component3 : public ECS::Component<Component3>
+{
+    int mesh;
+    float scale;
+
+    bool operator<(const Component3& rhs) const
+    {
+        return mesh < rhs.mesh || (mesh == rhs.mesh && scale < rhs.scale);
+    }
+};
@@ -0,0 +1,127 @@
+#include <string>
+#include <gtest/gtest.h>
+#include "../include/ecs_include.h"
+
+/**
+ * @brief A component with a small inline buffer, used for testing.
+ *
+ */
+struct Path : public ECS::Component<Path>
+{
+    ECS::Buffer<int, 4> waypoints;
+};
+
+TEST(Buffer, StaysInlineUntilFull)
+{
+    ECS::Buffer<int, 4> buffer;
+    ASSERT_TRUE(buffer.IsInline());
+    ASSERT_EQ(buffer.Capacity(), 4U);
+
+    for (int i = 0; i < 4; ++i)
+        buffer.PushBack(i);
+    ASSERT_TRUE(buffer.IsInline());
+    ASSERT_EQ(buffer.Size(), 4U);
+    ASSERT_GE(reinterpret_cast<const char*>(buffer.Data()), reinterpret_cast<const char*>(&buffer));
+    ASSERT_LT(reinterpret_cast<const char*>(buffer.Data()), reinterpret_cast<const char*>(&buffer + 1));
+
+    buffer.PushBack(4);
+    ASSERT_FALSE(buffer.IsInline());
+    ASSERT_GE(buffer.Capacity(), 8U);
+    for (int i = 0; i < 5; ++i)
+        ASSERT_EQ(buffer[static_cast<size_t>(i)], i);
+
+    buffer.PopBack();
+    ASSERT_EQ(buffer.Size(), 4U);
+
+    int sum = 0;
+    for (int value : buffer)
+        sum += value;
+    ASSERT_EQ(sum, 6);
+}
+
+TEST(Buffer, CopiesAndMoves)
+{
+    ECS::Buffer<std::string, 2> inlineBuffer;
+    inlineBuffer.PushBack("a");
+    inlineBuffer.PushBack("b");
+
+    ECS::Buffer<std::string, 2> heapBuffer;
+    for (int i = 0; i < 5; ++i)
+        heapBuffer.PushBack(std::to_string(i));
+
+    ECS::Buffer<std::string, 2> copy(heapBuffer);
+    ASSERT_EQ(copy.Size(), 5U);
+    ASSERT_NE(copy.Data(), heapBuffer.Data());
+    ASSERT_EQ(copy[4], "4");
+
+    // Moving a spilled buffer takes over its heap block.
+    const std::string* block = heapBuffer.Data();
+    ECS::Buffer<std::string, 2> moved(std::move(heapBuffer));
+    ASSERT_EQ(moved.Data(), block);
+    ASSERT_EQ(heapBuffer.Size(), 0U);
+    ASSERT_TRUE(heapBuffer.IsInline());
+
+    // Assigning keeps the heap block of the target.
+    moved = inlineBuffer;
+    ASSERT_EQ(moved.Data(), block);
+    ASSERT_EQ(moved.Size(), 2U);
+    ASSERT_EQ(moved[1], "b");
+
+    copy = std::move(inlineBuffer);
+    ASSERT_TRUE(copy.IsInline());
+    ASSERT_EQ(copy[0], "a");
+
+    // Pushing an element of the buffer itself while growing.
+    copy.PushBack(copy[0]);
+    ASSERT_EQ(copy[2], "a");
+}
+
+TEST(Buffer, ReusesFreedBlocks)
+{
+    const int* block;
+    {
+        ECS::Buffer<int, 1> buffer;
+        buffer.Reserve(100);
+        block = buffer.Data();
+    }
+
+    ECS::Buffer<int, 1> buffer;
+    buffer.Reserve(100);
+    ASSERT_EQ(buffer.Data(), block);
+}
+
+TEST(Buffer, SurvivesPoolGrowth)
+{
+    ECS::EntityManager entityManager(1);
+
+    std::vector<ECS::Entity> entities;
+    for (int i = 0; i < 64; ++i)
+    {
+        ECS::Entity entity = entityManager.CreateEntity();
+        Path* path = entityManager.AddComponent<Path>(entity);
+        for (int k = 0; k <= i % 8; ++k)
+            path->waypoints.PushBack(i * 10 + k);
+        entities.push_back(entity);
+    }
+
+    // Destroying components moves the last ones into the holes.
+    for (size_t i = 0; i < entities.size(); i += 3)
+        entityManager.RemoveComponent<Path>(entities[i]);
+    entityManager.DestroyRemoved();
+
+    for (size_t i = 0; i < entities.size(); ++i)
+    {
+        Path* path = entityManager.GetComponent<Path>(entities[i]);
+        if (i % 3 == 0)
+        {
+            ASSERT_EQ(path, nullptr);
+            continue;
+        }
+
+        ASSERT_NE(path, nullptr);
+        ASSERT_EQ(path->waypoints.Size(), i % 8 + 1);
+        ASSERT_EQ(path->waypoints.IsInline(), i % 8 < 4);
+        for (size_t k = 0; k < path->waypoints.Size(); ++k)
+            ASSERT_EQ(path->waypoints[k], static_cast<int>(i * 10 + k));
+    }
+}
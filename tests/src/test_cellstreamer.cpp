@@ -0,0 +1,261 @@
+#include <cstdio>
+#include <fstream>
+#include <gtest/gtest.h>
+#include "../include/ecs_include.h"
+#include "../include/components.h"
+
+/**
+ * @brief Counts the entities matching Component1 and Component3, used for testing.
+ *
+ */
+class CellSystem : public ECS::EntitySystem
+{
+public:
+    CellSystem()
+    {
+        Require<Component1>();
+        Require<Component3>();
+    }
+
+    void ProcessEntity(ECS::Entity) {}
+};
+
+/**
+ * @brief A fixture for testing the cell streamer.
+ */
+class CellStreamerTest : public ::testing::Test
+{
+public:
+    CellStreamerTest();
+    ~CellStreamerTest();
+
+    ECS::EntityManager entityManager;
+    ECS::SystemManager systemManager;
+    ECS::CellStreamer streamer;
+    std::string path;
+};
+
+CellStreamerTest::CellStreamerTest() : entityManager(1024), systemManager(&entityManager), streamer(&entityManager)
+{
+    path = ::testing::TempDir() + "ecs_test_cell.bin";
+    streamer.RegisterComponent<Component1>(1);
+    streamer.RegisterComponent<Component3>(3);
+}
+
+CellStreamerTest::~CellStreamerTest()
+{
+    std::remove(path.c_str());
+}
+
+
+
+TEST_F(CellStreamerTest, LoadsAndUnloadsCells)
+{
+    // Build a cell, save it and get rid of it.
+    std::vector<ECS::Entity> original;
+    for (int i = 0; i < 10; ++i)
+    {
+        ECS::Entity entity = entityManager.CreateEntity();
+        entityManager.AddComponent<Component1>(entity)->value = i;
+        entityManager.AddComponent<Component2>(entity);
+        if (i % 2 == 0)
+        {
+            Component3* component = entityManager.AddComponent<Component3>(entity);
+            component->mesh = i;
+            component->scale = 0.5f;
+        }
+        original.push_back(entity);
+    }
+
+    {
+        std::ofstream stream(path.c_str(), std::ios::binary);
+        streamer.Save(stream, original);
+    }
+    entityManager.RemoveEntities(original);
+    entityManager.DestroyRemoved();
+
+    CellSystem* system = new CellSystem;
+    systemManager.RegisterSystem(system);
+
+    // Nothing reaches the entity manager before Commit.
+    streamer.Load(7, path);
+    streamer.Wait();
+    ASSERT_FALSE(streamer.IsLoaded(7));
+    ASSERT_EQ(0U, entityManager.GetActiveEntities().size());
+
+    ASSERT_EQ(1U, streamer.Commit());
+    ASSERT_TRUE(streamer.IsLoaded(7));
+    ASSERT_FALSE(streamer.HasFailed(7));
+
+    const std::vector<ECS::Entity>& loaded = streamer.GetEntities(7);
+    ASSERT_EQ(10U, loaded.size());
+    ASSERT_EQ(5U, system->GetEntityCount());
+    for (int i = 0; i < 10; ++i)
+    {
+        ASSERT_EQ(i, entityManager.GetComponent<Component1>(loaded[i])->value);
+        ASSERT_EQ(nullptr, entityManager.GetComponent<Component2>(loaded[i]));
+        if (i % 2 == 0)
+        {
+            ASSERT_EQ(i, entityManager.GetComponent<Component3>(loaded[i])->mesh);
+            ASSERT_EQ(0.5f, entityManager.GetComponent<Component3>(loaded[i])->scale);
+        }
+        else
+        {
+            ASSERT_EQ(nullptr, entityManager.GetComponent<Component3>(loaded[i]));
+        }
+    }
+
+    // The components of a type are appended as one run.
+    ECS::Private::ComponentPool<Component1>* pool = entityManager.GetPool<Component1>();
+    for (size_t i = 0; i < loaded.size(); ++i)
+        ASSERT_EQ(i, pool->IndexOf(entityManager.GetInternalId(loaded[i])));
+
+    std::vector<ECS::Entity> unloaded = loaded;
+    streamer.Unload(7);
+    ASSERT_FALSE(streamer.IsLoaded(7));
+    ASSERT_EQ(0U, system->GetEntityCount());
+    for (auto entity : unloaded)
+        ASSERT_TRUE(entityManager.IsRemoved(entity));
+}
+
+TEST_F(CellStreamerTest, UnloadSkipsRemovedEntities)
+{
+    std::vector<ECS::Entity> original;
+    for (int i = 0; i < 3; ++i)
+    {
+        original.push_back(entityManager.CreateEntity());
+        entityManager.AddComponent<Component1>(original.back())->value = i;
+    }
+    {
+        std::ofstream stream(path.c_str(), std::ios::binary);
+        streamer.Save(stream, original);
+    }
+    entityManager.RemoveEntities(original);
+    entityManager.DestroyRemoved();
+
+    streamer.Load(1, path);
+    streamer.Wait();
+    ASSERT_EQ(1U, streamer.Commit());
+    std::vector<ECS::Entity> loaded = streamer.GetEntities(1);
+
+    // One entity is destroyed and one is removed by the game before the cell is unloaded.
+    entityManager.RemoveEntity(loaded[0]);
+    entityManager.DestroyRemoved();
+    entityManager.RemoveEntity(loaded[1]);
+
+    streamer.Unload(1);
+    ASSERT_EQ(2U, entityManager.entitiesToDestroy.size());
+    entityManager.DestroyRemoved();
+    for (auto entity : loaded)
+        ASSERT_TRUE(entityManager.IsDestroyed(entity));
+}
+
+TEST_F(CellStreamerTest, ReportsFailedCells)
+{
+    streamer.Load(1, path + ".missing");
+
+    {
+        std::ofstream stream(path.c_str(), std::ios::binary);
+        stream << "not a cell";
+    }
+    streamer.Load(2, path);
+
+    streamer.Wait();
+    ASSERT_EQ(2U, streamer.Commit());
+    ASSERT_TRUE(streamer.HasFailed(1));
+    ASSERT_TRUE(streamer.HasFailed(2));
+    ASSERT_FALSE(streamer.IsLoaded(1));
+    ASSERT_EQ(0U, entityManager.GetActiveEntities().size());
+}
+
+/**
+ * @brief Write a cell file with one column of Component1 by hand, used for testing corrupt cells.
+ *
+ */
+static void WriteCell(const std::string& path, uint64_t entityCount, uint64_t size, uint64_t count, const std::vector<uint32_t>& owners,
+                      const std::vector<uint32_t>& keys = std::vector<uint32_t>(1, 1))
+{
+    std::ofstream stream(path.c_str(), std::ios::binary);
+    const uint32_t version = 1;
+    const uint64_t typeCount = keys.size();
+    stream.write("ECSC", 4);
+    stream.write(reinterpret_cast<const char*>(&version), sizeof(version));
+    stream.write(reinterpret_cast<const char*>(&entityCount), sizeof(entityCount));
+    stream.write(reinterpret_cast<const char*>(&typeCount), sizeof(typeCount));
+    for (auto key : keys)
+    {
+        stream.write(reinterpret_cast<const char*>(&key), sizeof(key));
+        stream.write(reinterpret_cast<const char*>(&size), sizeof(size));
+        stream.write(reinterpret_cast<const char*>(&count), sizeof(count));
+        stream.write(reinterpret_cast<const char*>(owners.data()), static_cast<std::streamsize>(owners.size() * sizeof(uint32_t)));
+        std::vector<char> bytes(owners.size() * sizeof(int));
+        stream.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+    }
+}
+
+TEST_F(CellStreamerTest, RejectsCorruptCells)
+{
+    // A well formed cell for reference.
+    WriteCell(path, 2, sizeof(int), 2, std::vector<uint32_t>{ 0, 1 });
+    streamer.Load(0, path);
+    streamer.Wait();
+    streamer.Commit();
+    ASSERT_TRUE(streamer.IsLoaded(0));
+
+    // Two components of a type on one entity.
+    WriteCell(path, 2, sizeof(int), 2, std::vector<uint32_t>{ 1, 1 });
+    streamer.Load(1, path);
+    streamer.Wait();
+    streamer.Commit();
+    ASSERT_TRUE(streamer.HasFailed(1));
+
+    // Sizes that do not fit in the file.
+    WriteCell(path, 2, static_cast<uint64_t>(1) << 62, 2, std::vector<uint32_t>{ 0, 1 });
+    streamer.Load(2, path);
+    WriteCell(path + ".count", static_cast<uint64_t>(1) << 32, sizeof(int), static_cast<uint64_t>(1) << 31, std::vector<uint32_t>{ 0, 1 });
+    streamer.Load(3, path + ".count");
+    streamer.Wait();
+    streamer.Commit();
+    std::remove((path + ".count").c_str());
+    ASSERT_TRUE(streamer.HasFailed(2));
+    ASSERT_TRUE(streamer.HasFailed(3));
+
+    // A type listed twice, under the same key or under two keys of the same component type.
+    streamer.RegisterComponent<Component1>(11);
+    WriteCell(path, 1, sizeof(int), 1, std::vector<uint32_t>{ 0 }, std::vector<uint32_t>{ 1, 1 });
+    streamer.Load(4, path);
+    streamer.Wait();
+    WriteCell(path, 1, sizeof(int), 1, std::vector<uint32_t>{ 0 }, std::vector<uint32_t>{ 1, 11 });
+    streamer.Load(5, path);
+    streamer.Wait();
+    streamer.Commit();
+    ASSERT_TRUE(streamer.HasFailed(4));
+    ASSERT_TRUE(streamer.HasFailed(5));
+    ASSERT_EQ(2U, entityManager.GetActiveEntities().size());
+}
+
+TEST_F(CellStreamerTest, CommitsWithinBudget)
+{
+    std::vector<ECS::Entity> entities(1, entityManager.CreateEntity());
+    entityManager.AddComponent<Component1>(entities[0])->value = 42;
+    {
+        std::ofstream stream(path.c_str(), std::ios::binary);
+        streamer.Save(stream, entities);
+    }
+
+    for (size_t id = 0; id < 3; ++id)
+        streamer.Load(id, path);
+    streamer.Wait();
+
+    ASSERT_EQ(2U, streamer.Commit(2));
+    ASSERT_EQ(1U, streamer.Commit(2));
+    ASSERT_EQ(0U, streamer.Commit(2));
+    ASSERT_EQ(42, entityManager.GetComponent<Component1>(streamer.GetEntities(2)[0])->value);
+
+    // Unloading a staged cell drops it.
+    streamer.Load(3, path);
+    streamer.Wait();
+    streamer.Unload(3);
+    ASSERT_EQ(0U, streamer.Commit());
+    ASSERT_FALSE(streamer.IsLoaded(3));
+}
@@ -1,3 +1,4 @@
+#include <thread>
 #include <gtest/gtest.h>
 #include "../include/ecs_include.h"
 #include "../include/components.h"
@@ -26,12 +27,12 @@ TEST_F(EntityManagerTest, EntityCreate)
     }
 
     // Make sure the number of entities is correct.
-    ASSERT_EQ(ENTITY_COUNT, entityManager.entities.size());
+    ASSERT_EQ(ENTITY_COUNT, entityManager.entities.Size());
 
-    // Make sure the component table has been extended properly.
+    // Make sure no component pools are created before components are added.
     for (int i = 0; i < ECS::MAX_COMPONENTS; ++i)
     {
-        ASSERT_EQ(ENTITY_COUNT, entityManager.components[i].size());
+        ASSERT_EQ(nullptr, entityManager.pools[i]);
     }
 }
 
@@ -63,12 +64,12 @@ TEST_F(EntityManagerTest, EntityRemovalCleanup)
 
     entityManager.DestroyRemoved();
 
-    // Make sure all components are destroyed and nulled.
+    // Make sure all components are destroyed.
     for (int i = 0; i < ECS::MAX_COMPONENTS; ++i)
     {
-        for (size_t k = 0; k < entityManager.components[i].size(); ++k)
+        if (entityManager.pools[i] != nullptr)
         {
-            ASSERT_EQ(nullptr, entityManager.components[i][k]);
+            ASSERT_EQ(0, entityManager.pools[i]->Size());
         }
     }
 
@@ -140,6 +141,820 @@ TEST_F(EntityManagerTest, RemoveComponents)
 }
 
 
+TEST_F(EntityManagerTest, ComponentsArePlainData)
+{
+    // Plain data components must stay trivially copyable so that they can be cloned with memcpy.
+    ASSERT_TRUE(std::is_trivially_copyable<Component1>::value);
+    ASSERT_TRUE(std::is_trivially_copyable<Component2>::value);
+}
+
+TEST_F(EntityManagerTest, ComponentStorageIsPacked)
+{
+    const int ENTITY_COUNT = 10;
+    std::vector<ECS::Entity> entities;
+    for (int i = 0; i < ENTITY_COUNT; ++i)
+    {
+        entities.push_back(entityManager.CreateEntity());
+        entityManager.AddComponent<Component1>(entities.back())->value = i;
+    }
+
+    // Destroying a component moves the last one into its place.
+    entityManager.RemoveComponent<Component1>(entities[2]);
+    entityManager.DestroyRemoved();
+
+    ASSERT_EQ(ENTITY_COUNT - 1, entityManager.pools[Component1::ID]->Size());
+    ASSERT_EQ(ENTITY_COUNT - 1, entityManager.GetComponent<Component1>(entities.back())->value);
+    ASSERT_EQ(entityManager.GetComponent<Component1>(entities[1]) + 1, entityManager.GetComponent<Component1>(entities.back()));
+}
+
+#ifdef __linux__
+TEST_F(EntityManagerTest, ComponentStorageDoesNotMoveWhenGrowing)
+{
+    ECS::Entity first = entityManager.CreateEntity();
+    Component2* component = entityManager.AddComponent<Component2>(first);
+    const ECS::Private::InternalEntity* internalEntities = entityManager.entities.Data();
+
+    // Grow far past the reserved entity count. The columns stay inside their reserved address space.
+    for (int i = 0; i < 100000; ++i)
+        entityManager.AddComponent<Component2>(entityManager.CreateEntity());
+
+    ASSERT_EQ(component, entityManager.GetComponent<Component2>(first));
+    ASSERT_EQ(internalEntities, entityManager.entities.Data());
+}
+#endif
+
+TEST_F(EntityManagerTest, ReAddRemovedComponent)
+{
+    ECS::Entity e = entityManager.CreateEntity();
+    entityManager.AddComponent<Component1>(e)->value = 1;
+    entityManager.RemoveComponent<Component1>(e);
+
+    // Adding the component again cancels the pending destruction.
+    Component1* c1 = entityManager.AddComponent<Component1>(e);
+    ASSERT_FALSE(entityManager.IsComponentRemoved<Component1>(e));
+
+    entityManager.DestroyRemoved();
+    ASSERT_TRUE(entityManager.HasComponent<Component1>(e));
+    ASSERT_EQ(c1, entityManager.GetComponent<Component1>(e));
+}
+
+TEST_F(EntityManagerTest, Prefab)
+{
+    ECS::Entity prefab = entityManager.CreatePrefab();
+    entityManager.AddComponent<Component1>(prefab)->value = 42;
+
+    ASSERT_TRUE(entityManager.IsPrefab(prefab));
+    ASSERT_TRUE(entityManager.GetActiveEntities().empty());
+    ASSERT_TRUE(entityManager.GetEntityFlag(prefab).test(Component1::ID));
+
+    entityManager.RemoveEntity(prefab);
+    entityManager.DestroyRemoved();
+    ASSERT_TRUE(entityManager.IsDestroyed(prefab));
+    ASSERT_FALSE(entityManager.IsPrefab(prefab));
+}
+
+TEST_F(EntityManagerTest, Instantiate)
+{
+    ECS::Entity prefab = entityManager.CreatePrefab();
+    entityManager.AddComponent<Component1>(prefab)->value = 42;
+    entityManager.AddComponent<Component2>(prefab)->foo = 1.5f;
+    entityManager.SetComponentEnabled<Component2>(prefab, false);
+
+    const int INSTANCE_COUNT = 37;
+    std::vector<ECS::Entity> instances = entityManager.Instantiate(prefab, INSTANCE_COUNT);
+    ASSERT_EQ(INSTANCE_COUNT, instances.size());
+    ASSERT_EQ(INSTANCE_COUNT, entityManager.GetActiveEntities().size());
+
+    for (size_t i = 0; i < instances.size(); ++i)
+    {
+        ASSERT_FALSE(entityManager.IsPrefab(instances[i]));
+        ASSERT_EQ(entityManager.GetEntityFlag(prefab), entityManager.GetEntityFlag(instances[i]));
+        ASSERT_EQ(42, entityManager.GetComponent<Component1>(instances[i])->value);
+        ASSERT_EQ(1.5f, entityManager.GetComponent<Component2>(instances[i])->foo);
+        ASSERT_TRUE(entityManager.IsComponentEnabled<Component1>(instances[i]));
+        ASSERT_FALSE(entityManager.IsComponentEnabled<Component2>(instances[i]));
+    }
+
+    // The copies are stored contiguously, in instance order.
+    Component1* first = entityManager.GetComponent<Component1>(instances.front());
+    for (size_t i = 0; i < instances.size(); ++i)
+    {
+        ASSERT_EQ(first + i, entityManager.GetComponent<Component1>(instances[i]));
+    }
+
+    // Instances are independent of the prefab and each other.
+    entityManager.GetComponent<Component1>(instances[0])->value = 1;
+    ASSERT_EQ(42, entityManager.GetComponent<Component1>(prefab)->value);
+    ASSERT_EQ(42, entityManager.GetComponent<Component1>(instances[1])->value);
+}
+
+TEST_F(EntityManagerTest, InstantiateSkipsRemovedComponents)
+{
+    ECS::Entity prefab = entityManager.CreatePrefab();
+    entityManager.AddComponent<Component1>(prefab);
+    entityManager.AddComponent<Component2>(prefab);
+    entityManager.RemoveComponent<Component2>(prefab);
+
+    std::vector<ECS::Entity> instances = entityManager.Instantiate(prefab, 3);
+    for (auto instance : instances)
+    {
+        ASSERT_TRUE(entityManager.HasComponent<Component1>(instance));
+        ASSERT_FALSE(entityManager.HasComponent<Component2>(instance));
+    }
+}
+
+TEST_F(EntityManagerTest, ConcurrentSpawning)
+{
+    // Leave some recycled IDs behind.
+    for (int i = 0; i < 10; ++i)
+        entityManager.RemoveEntity(entityManager.CreateEntity());
+    entityManager.DestroyRemoved();
+
+    const int THREAD_COUNT = 4;
+    const int ENTITIES_PER_THREAD = 1000;
+    entityManager.BeginConcurrentSpawning(THREAD_COUNT * ENTITIES_PER_THREAD, THREAD_COUNT);
+    entityManager.ReserveConcurrentComponents<Component1>(THREAD_COUNT * ENTITIES_PER_THREAD);
+
+    std::vector<std::vector<ECS::Entity>> spawned(THREAD_COUNT);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < THREAD_COUNT; ++t)
+    {
+        threads.push_back(std::thread([&, t]()
+        {
+            ECS::SpawnContext* context = entityManager.GetSpawnContext(static_cast<size_t>(t));
+            for (int i = 0; i < ENTITIES_PER_THREAD; ++i)
+            {
+                ECS::Entity entity = context->CreateEntity();
+                context->AddComponent<Component1>(entity)->value = t * ENTITIES_PER_THREAD + i;
+                spawned[static_cast<size_t>(t)].push_back(entity);
+            }
+        }));
+    }
+    for (auto& thread : threads)
+        thread.join();
+
+    entityManager.EndConcurrentSpawning();
+
+    ASSERT_EQ(THREAD_COUNT * ENTITIES_PER_THREAD, entityManager.GetActiveEntities().size());
+    ASSERT_EQ(THREAD_COUNT * ENTITIES_PER_THREAD, entityManager.pools[Component1::ID]->Size());
+    for (int t = 0; t < THREAD_COUNT; ++t)
+    {
+        for (int i = 0; i < ENTITIES_PER_THREAD; ++i)
+        {
+            ECS::Entity entity = spawned[static_cast<size_t>(t)][static_cast<size_t>(i)];
+            ASSERT_FALSE(entityManager.IsRemoved(entity));
+            ASSERT_EQ(t * ENTITIES_PER_THREAD + i, entityManager.GetComponent<Component1>(entity)->value);
+        }
+    }
+
+    // Every internal ID is used once, and the recycled IDs were used first.
+    std::set<size_t> internalIds;
+    for (auto& pair : entityManager.translator)
+        internalIds.insert(pair.second);
+    ASSERT_EQ(entityManager.translator.size(), internalIds.size());
+    ASSERT_EQ(entityManager.entities.Size(), internalIds.size() + entityManager.recycledIds.size());
+    for (size_t i = 0; i < 10; ++i)
+        ASSERT_TRUE(internalIds.find(i) != internalIds.end());
+
+    // The entity manager works as usual afterwards.
+    ECS::Entity entity = entityManager.CreateEntity();
+    entityManager.AddComponent<Component1>(entity)->value = -1;
+    ASSERT_EQ(-1, entityManager.GetComponent<Component1>(entity)->value);
+    ASSERT_EQ(THREAD_COUNT * ENTITIES_PER_THREAD + 1, entityManager.GetActiveEntities().size());
+}
+
+/**
+ * @brief Check that the members of the Component1/Component2 group are packed at the front of both pools, in the same order.
+ *
+ */
+static void ExpectGroupPacked(ECS::EntityManager& entityManager, const std::set<ECS::Entity>& members)
+{
+    size_t group = entityManager.FindGroup<Component1, Component2>();
+    ASSERT_EQ(members.size(), entityManager.groups[group].size);
+
+    ECS::Private::ComponentPoolBase* pool1 = entityManager.pools[Component1::ID];
+    ECS::Private::ComponentPoolBase* pool2 = entityManager.pools[Component2::ID];
+    for (size_t i = 0; i < members.size(); ++i)
+    {
+        ASSERT_EQ(pool1->GetInternalId(i), pool2->GetInternalId(i));
+        ASSERT_TRUE(members.find(entityManager.entities[pool1->GetInternalId(i)].entity) != members.end());
+    }
+}
+
+TEST_F(EntityManagerTest, Groups)
+{
+    // Build the entities in an order that interleaves the pools.
+    std::set<ECS::Entity> members;
+    std::vector<ECS::Entity> entities;
+    for (int i = 0; i < 20; ++i)
+    {
+        ECS::Entity entity = entityManager.CreateEntity();
+        if (i % 3 != 0)
+            entityManager.AddComponent<Component1>(entity)->value = i;
+        if (i % 2 == 0)
+            entityManager.AddComponent<Component2>(entity)->foo = static_cast<float>(i);
+        if (i % 3 != 0 && i % 2 == 0)
+            members.insert(entity);
+        entities.push_back(entity);
+    }
+
+    entityManager.CreateGroup<Component1, Component2>();
+    ExpectGroupPacked(entityManager, members);
+
+    // Adding and removing components maintains the ordering, and the values follow their entities.
+    entityManager.AddComponent<Component2>(entities[1])->foo = 1.0f;
+    members.insert(entities[1]);
+    ExpectGroupPacked(entityManager, members);
+
+    entityManager.RemoveComponent<Component1>(entities[2]);
+    members.erase(entities[2]);
+    entityManager.RemoveEntity(entities[4]);
+    members.erase(entities[4]);
+    ExpectGroupPacked(entityManager, members);
+
+    entityManager.DestroyRemoved();
+    ExpectGroupPacked(entityManager, members);
+
+    ECS::Entity entity = entityManager.CreateEntity();
+    entityManager.AddComponent<Component2>(entity)->foo = 100.0f;
+    entityManager.AddComponent<Component1>(entity)->value = 100;
+    members.insert(entity);
+    ExpectGroupPacked(entityManager, members);
+
+    for (auto member : members)
+    {
+        ASSERT_EQ(static_cast<float>(entityManager.GetComponent<Component1>(member)->value), entityManager.GetComponent<Component2>(member)->foo);
+    }
+
+    // The group can be walked as parallel arrays.
+    size_t walked = 0;
+    entityManager.ProcessGroup<Component1, Component2>([&](size_t count, Component1* c1, Component2* c2)
+    {
+        walked = count;
+        for (size_t i = 0; i < count; ++i)
+            ASSERT_EQ(static_cast<float>(c1[i].value), c2[i].foo);
+    });
+    ASSERT_EQ(members.size(), walked);
+}
+
+TEST_F(EntityManagerTest, QueryIsCachedAndUpdated)
+{
+    std::vector<ECS::Entity> entities;
+    for (int i = 0; i < 10; ++i)
+    {
+        entities.push_back(entityManager.CreateEntity());
+        entityManager.AddComponent<Component1>(entities.back());
+        if (i % 2 == 0)
+            entityManager.AddComponent<Component2>(entities.back());
+    }
+
+    const std::vector<ECS::Entity>& both = entityManager.Query<Component1, Component2>();
+    ASSERT_EQ(5, both.size());
+    ASSERT_EQ(&both, &(entityManager.Query<Component2, Component1>()));
+    ASSERT_EQ(10, entityManager.Query<Component1>().size());
+    ASSERT_EQ(10, entityManager.Query(std::bitset<ECS::MAX_COMPONENTS>()).size());
+    ASSERT_EQ(3, entityManager.queryCache->GetQueryCount());
+
+    // The cached results follow the changes.
+    entityManager.AddComponent<Component2>(entities[1]);
+    entityManager.RemoveComponent<Component2>(entities[0]);
+    entityManager.RemoveEntity(entities[2]);
+    entityManager.CreateEntity();
+    ASSERT_EQ(4, both.size());
+    ASSERT_TRUE(std::find(both.begin(), both.end(), entities[1]) != both.end());
+    ASSERT_TRUE(std::find(both.begin(), both.end(), entities[0]) == both.end());
+    ASSERT_TRUE(std::find(both.begin(), both.end(), entities[2]) == both.end());
+    ASSERT_EQ(10, entityManager.Query(std::bitset<ECS::MAX_COMPONENTS>()).size());
+
+    entityManager.Instantiate(entityManager.CreatePrefab(), 2);
+    ASSERT_EQ(12, entityManager.Query(std::bitset<ECS::MAX_COMPONENTS>()).size());
+
+    // Results that are not asked for are evicted after a while.
+    for (int i = 0; i < ECS::QUERY_EVICTION_AGE; ++i)
+    {
+        entityManager.Query<Component1>();
+        entityManager.DestroyRemoved();
+    }
+    ASSERT_EQ(3, entityManager.queryCache->GetQueryCount());
+    entityManager.DestroyRemoved();
+    ASSERT_EQ(1, entityManager.queryCache->GetQueryCount());
+    ASSERT_EQ(9, entityManager.Query<Component1>().size());
+}
+
+TEST_F(EntityManagerTest, Snapshots)
+{
+    ECS::SnapshotReader<Component1>* reader = entityManager.CreateSnapshotReader<Component1>();
+    ASSERT_EQ(0, reader->Read().GetFrame());
+
+    ECS::Entity a = entityManager.CreateEntity();
+    ECS::Entity b = entityManager.CreateEntity();
+    entityManager.AddComponent<Component1>(a)->value = 1;
+    entityManager.AddComponent<Component1>(b)->value = 2;
+    entityManager.AddComponent<Component1>(entityManager.CreatePrefab());
+    entityManager.PublishSnapshots();
+
+    // Changes after publishing do not show up until the next publish.
+    entityManager.GetComponent<Component1>(a)->value = 10;
+    entityManager.RemoveEntity(b);
+
+    const ECS::Snapshot<Component1>& snapshot = reader->Read();
+    ASSERT_EQ(1, snapshot.GetFrame());
+    ASSERT_EQ(2, snapshot.Size());
+    ASSERT_EQ(1, snapshot.Find(a)->value);
+    ASSERT_EQ(2, snapshot.Find(b)->value);
+
+    entityManager.PublishSnapshots();
+    ASSERT_EQ(1, snapshot.Find(a)->value);
+
+    const ECS::Snapshot<Component1>& next = reader->Read();
+    ASSERT_EQ(2, next.GetFrame());
+    ASSERT_EQ(1, next.Size());
+    ASSERT_EQ(a, next.GetEntity(0));
+    ASSERT_EQ(10, next.GetComponent(0).value);
+    ASSERT_EQ(nullptr, next.Find(b));
+}
+
+TEST_F(EntityManagerTest, SnapshotsAreConsistentAcrossThreads)
+{
+    ECS::SnapshotReader<Component1>* reader = entityManager.CreateSnapshotReader<Component1>();
+
+    const int ENTITY_COUNT = 100;
+    const int FRAME_COUNT = 1000;
+    std::vector<ECS::Entity> entities;
+    for (int i = 0; i < ENTITY_COUNT; ++i)
+    {
+        entities.push_back(entityManager.CreateEntity());
+        entityManager.AddComponent<Component1>(entities.back());
+    }
+
+    // The reader must never see components from different frames in one snapshot.
+    std::atomic<bool> done(false);
+    bool consistent = true;
+    std::thread thread([&]()
+    {
+        while (!done)
+        {
+            const ECS::Snapshot<Component1>& snapshot = reader->Read();
+            for (size_t i = 0; i < snapshot.Size(); ++i)
+                consistent = consistent && snapshot.GetComponent(i).value == static_cast<int>(snapshot.GetFrame());
+        }
+    });
+
+    for (int frame = 1; frame <= FRAME_COUNT; ++frame)
+    {
+        for (auto entity : entities)
+            entityManager.GetComponent<Component1>(entity)->value = frame;
+        entityManager.PublishSnapshots();
+    }
+    done = true;
+    thread.join();
+
+    ASSERT_TRUE(consistent);
+    ASSERT_EQ(FRAME_COUNT, reader->Read().GetFrame());
+}
+
+TEST_F(EntityManagerTest, FieldIndexes)
+{
+    std::vector<ECS::Entity> entities;
+    for (int i = 0; i < 10; ++i)
+    {
+        entities.push_back(entityManager.CreateEntity());
+        entityManager.AddComponent<Component1>(entities.back())->value = i % 3;
+    }
+
+    // Existing components are indexed when the index is created.
+    entityManager.CreateHashIndex(&Component1::value);
+    entityManager.CreateOrderedIndex(&Component1::value);
+    ASSERT_EQ(4, entityManager.FindByField(&Component1::value, 0).size());
+    ASSERT_EQ(3, entityManager.FindByField(&Component1::value, 2).size());
+    ASSERT_EQ(0, entityManager.FindByField(&Component1::value, 5).size());
+
+    std::vector<ECS::Entity> range;
+    entityManager.FindInRange(&Component1::value, 1, 2, range);
+    ASSERT_EQ(6, range.size());
+
+    // Changes are picked up when notified.
+    entityManager.GetComponent<Component1>(entities[0])->value = 5;
+    entityManager.NotifyComponentChanged<Component1>(entities[0]);
+    ASSERT_EQ(3, entityManager.FindByField(&Component1::value, 0).size());
+    ASSERT_EQ(std::vector<ECS::Entity>(1, entities[0]), entityManager.FindByField(&Component1::value, 5));
+
+    // New components are indexed with their default value until changed.
+    ECS::Entity entity = entityManager.CreateEntity();
+    entityManager.AddComponent<Component1>(entity)->value = 7;
+    ASSERT_EQ(0, entityManager.FindByField(&Component1::value, 7).size());
+    entityManager.NotifyComponentChanged<Component1>(entity);
+    ASSERT_EQ(1, entityManager.FindByField(&Component1::value, 7).size());
+
+    // Removed components and entities are dropped from the index.
+    entityManager.RemoveComponent<Component1>(entities[0]);
+    entityManager.RemoveEntity(entities[3]);
+    entityManager.DestroyRemoved();
+    ASSERT_EQ(0, entityManager.FindByField(&Component1::value, 5).size());
+    ASSERT_EQ(2, entityManager.FindByField(&Component1::value, 0).size());
+
+    // Instantiated components are indexed with the prefab's value.
+    ECS::Entity prefab = entityManager.CreatePrefab();
+    entityManager.AddComponent<Component1>(prefab)->value = 9;
+    ASSERT_EQ(0, entityManager.FindByField(&Component1::value, 9).size());
+    entityManager.Instantiate(prefab, 3);
+    ASSERT_EQ(3, entityManager.FindByField(&Component1::value, 9).size());
+
+    range.clear();
+    entityManager.FindInRange(&Component1::value, 7, 100, range);
+    ASSERT_EQ(4, range.size());
+}
+
+/**
+ * @brief A component referring to other entities, used for testing references.
+ *
+ */
+struct Turret : public ECS::Component<Turret>
+{
+    ECS::EntityRef target;
+    ECS::EntityRef owner;
+};
+
+/**
+ * @brief Records the changed components reported to it, used for testing references.
+ *
+ */
+class ChangeObserver : public ECS::EntityObserver
+{
+public:
+    void EntityCreated(ECS::Entity) {}
+    void EntityRemoved(ECS::Entity) {}
+    void ComponentAdded(ECS::Entity, ECS::ComponentType) {}
+    void ComponentRemoved(ECS::Entity, ECS::ComponentType) {}
+
+    void ComponentChanged(ECS::Entity entity, ECS::ComponentType)
+    {
+        changed.push_back(entity);
+    }
+
+    std::vector<ECS::Entity> changed;
+};
+
+TEST_F(EntityManagerTest, EntityReferences)
+{
+    ECS::Entity enemy = entityManager.CreateEntity();
+    ECS::Entity other = entityManager.CreateEntity();
+
+    std::vector<ECS::Entity> turrets;
+    for (int i = 0; i < 4; ++i)
+    {
+        turrets.push_back(entityManager.CreateEntity());
+        entityManager.AddComponent<Turret>(turrets.back());
+        entityManager.SetReference(turrets.back(), &Turret::target, (i < 3) ? enemy : other);
+    }
+    ASSERT_EQ(3, entityManager.FindReferences(&Turret::target, enemy).size());
+
+    // References written directly are tracked after NotifyComponentChanged, and instances of prefabs are tracked.
+    entityManager.CreateReferenceIndex(&Turret::owner);
+    entityManager.GetComponent<Turret>(turrets[0])->owner = enemy;
+    entityManager.NotifyComponentChanged<Turret>(turrets[0]);
+
+    ECS::Entity prefab = entityManager.CreatePrefab();
+    entityManager.AddComponent<Turret>(prefab)->target = enemy;
+    ECS::Entity instance = entityManager.Instantiate(prefab, 1)[0];
+    ASSERT_EQ(4, entityManager.FindReferences(&Turret::target, enemy).size());
+
+    // References held by removed entities are dropped before their targets are destroyed.
+    entityManager.RemoveEntity(turrets[2]);
+    entityManager.DestroyRemoved();
+    ASSERT_EQ(3, entityManager.FindReferences(&Turret::target, enemy).size());
+
+    ChangeObserver observer;
+    entityManager.AddEntityObserver(&observer);
+    entityManager.RemoveEntity(enemy);
+    ASSERT_EQ(ECS::Entity(enemy), entityManager.GetComponent<Turret>(turrets[0])->target.Get());
+    entityManager.DestroyRemoved();
+
+    ASSERT_TRUE(entityManager.GetComponent<Turret>(turrets[0])->target.IsNull());
+    ASSERT_TRUE(entityManager.GetComponent<Turret>(turrets[0])->owner.IsNull());
+    ASSERT_TRUE(entityManager.GetComponent<Turret>(turrets[1])->target.IsNull());
+    ASSERT_TRUE(entityManager.GetComponent<Turret>(instance)->target.IsNull());
+    ASSERT_EQ(ECS::Entity(other), entityManager.GetComponent<Turret>(turrets[3])->target.Get());
+    ASSERT_EQ(ECS::Entity(enemy), entityManager.GetComponent<Turret>(prefab)->target.Get());
+    ASSERT_EQ(0, entityManager.FindReferences(&Turret::target, enemy).size());
+    ASSERT_EQ(1, entityManager.FindReferences(&Turret::target, other).size());
+
+    // One change per cleared reference.
+    ASSERT_EQ(4, observer.changed.size());
+    ASSERT_EQ(2, std::count(observer.changed.begin(), observer.changed.end(), turrets[0]));
+    entityManager.RemoveEntityObserver(&observer);
+}
+
+static Component3 MakeComponent3(int mesh, float scale)
+{
+    Component3 component;
+    component.mesh = mesh;
+    component.scale = scale;
+    return component;
+}
+
+TEST_F(EntityManagerTest, Hierarchy)
+{
+    // root -> (a -> (c, d), b), created in an order that does not match the hierarchy.
+    ECS::Entity d = entityManager.CreateEntity();
+    ECS::Entity c = entityManager.CreateEntity();
+    ECS::Entity b = entityManager.CreateEntity();
+    ECS::Entity a = entityManager.CreateEntity();
+    ECS::Entity root = entityManager.CreateEntity();
+    ECS::Entity other = entityManager.CreateEntity();
+
+    ECS::Entity all[] = { d, c, b, a, root, other };
+    for (int i = 0; i < 6; ++i)
+        entityManager.AddComponent<Component1>(all[i])->value = 1;
+
+    entityManager.SetParent(c, a);
+    entityManager.SetParent(d, a);
+    entityManager.SetParent(a, root);
+    entityManager.SetParent(b, root);
+
+    ASSERT_EQ(root, entityManager.GetParent(a));
+    ASSERT_EQ(ECS::INVALID_ENTITY, entityManager.GetParent(root));
+    ASSERT_EQ(std::vector<ECS::Entity>({ c, d }), entityManager.GetChildren(a));
+
+    // Propagate the values down the hierarchy; the result is the depth of every entity.
+    std::vector<int> visited;
+    entityManager.ProcessHierarchy<Component1>([&visited](Component1& component, const Component1* parent)
+    {
+        if (parent != nullptr)
+            component.value += parent->value;
+        visited.push_back(component.value);
+    });
+    ASSERT_EQ(std::vector<int>({ 1, 2, 2, 3, 3 }), visited);
+    ASSERT_EQ(3, entityManager.GetComponent<Component1>(d)->value);
+    ASSERT_EQ(1, entityManager.GetComponent<Component1>(other)->value);
+
+    // The components of the hierarchy are at the front of the pool, in breadth-first order.
+    ECS::Private::ComponentPool<Component1>* pool = entityManager.GetPool<Component1>();
+    ECS::Entity order[] = { root, a, b, c, d };
+    for (size_t i = 0; i < 5; ++i)
+        ASSERT_EQ(entityManager.GetInternalId(order[i]), pool->GetInternalId(i));
+
+    // Reparenting moves the whole subtree.
+    entityManager.SetParent(a, b);
+    visited.clear();
+    entityManager.ProcessHierarchy<Component1>([&visited](Component1& component, const Component1* parent)
+    {
+        component.value = (parent != nullptr) ? parent->value + 1 : 1;
+        visited.push_back(component.value);
+    });
+    ASSERT_EQ(std::vector<int>({ 1, 2, 3, 4, 4 }), visited);
+
+    // Removing an entity removes its subtree.
+    entityManager.RemoveEntity(a);
+    ASSERT_TRUE(entityManager.IsRemoved(c));
+    ASSERT_TRUE(entityManager.IsRemoved(d));
+    ASSERT_FALSE(entityManager.IsRemoved(b));
+    ASSERT_TRUE(entityManager.GetChildren(b).empty());
+    entityManager.DestroyRemoved();
+
+    visited.clear();
+    entityManager.ProcessHierarchy<Component1>([&visited](Component1& component, const Component1*)
+    {
+        visited.push_back(component.value);
+    });
+    ASSERT_EQ(std::vector<int>({ 1, 2 }), visited);
+
+    // Detaching the last child takes both entities out of the hierarchy.
+    entityManager.SetParent(b, ECS::INVALID_ENTITY);
+    visited.clear();
+    entityManager.ProcessHierarchy<Component1>([&visited](Component1& component, const Component1*)
+    {
+        visited.push_back(component.value);
+    });
+    ASSERT_TRUE(visited.empty());
+}
+
+TEST_F(EntityManagerTest, RemoveParentAndChildInSameFrame)
+{
+    ECS::Entity parent = entityManager.CreateEntity();
+    ECS::Entity child = entityManager.CreateEntity();
+    ECS::Entity grandchild = entityManager.CreateEntity();
+    entityManager.SetParent(child, parent);
+    entityManager.SetParent(grandchild, child);
+
+    // The child is removed with its parent, and removing it again does nothing.
+    entityManager.RemoveEntity(parent);
+    ASSERT_TRUE(entityManager.IsRemoved(child));
+    entityManager.RemoveEntity(child);
+    entityManager.RemoveEntities(std::vector<ECS::Entity>{ parent, grandchild });
+    ASSERT_EQ(3U, entityManager.entitiesToDestroy.size());
+
+    entityManager.DestroyRemoved();
+    ASSERT_TRUE(entityManager.IsDestroyed(parent));
+    ASSERT_TRUE(entityManager.IsDestroyed(child));
+    ASSERT_TRUE(entityManager.IsDestroyed(grandchild));
+    ASSERT_EQ(0U, entityManager.GetActiveEntities().size());
+}
+
+TEST_F(EntityManagerTest, SharedComponentsAreDeduplicated)
+{
+    ECS::Entity e1 = entityManager.CreateEntity();
+    ECS::Entity e2 = entityManager.CreateEntity();
+    ECS::Entity e3 = entityManager.CreateEntity();
+
+    const Component3* shared1 = entityManager.AddSharedComponent(e1, MakeComponent3(1, 2.0f));
+    const Component3* shared2 = entityManager.AddSharedComponent(e2, MakeComponent3(1, 2.0f));
+    const Component3* other = entityManager.AddSharedComponent(e3, MakeComponent3(2, 2.0f));
+
+    ASSERT_EQ(shared1, shared2);
+    ASSERT_NE(shared1, other);
+    ASSERT_EQ(2, entityManager.GetSharedValueCount<Component3>());
+    ASSERT_EQ(shared1, entityManager.GetSharedComponent<Component3>(e2));
+    ASSERT_TRUE(entityManager.HasComponent<Component3>(e1));
+    ASSERT_TRUE(entityManager.GetEntityFlag(e1).test(Component3::ID));
+
+    // Changing the value of one entity moves it to another value.
+    ASSERT_EQ(other, entityManager.AddSharedComponent(e2, MakeComponent3(2, 2.0f)));
+    ASSERT_EQ(2, entityManager.GetSharedValueCount<Component3>());
+
+    // The value is destroyed with its last reference.
+    entityManager.RemoveComponent<Component3>(e1);
+    ASSERT_EQ(2, entityManager.GetSharedValueCount<Component3>());
+    entityManager.DestroyRemoved();
+    ASSERT_EQ(1, entityManager.GetSharedValueCount<Component3>());
+    ASSERT_FALSE(entityManager.HasComponent<Component3>(e1));
+    ASSERT_EQ(nullptr, entityManager.GetSharedComponent<Component3>(e1));
+}
+
+TEST_F(EntityManagerTest, SharedComponentGroups)
+{
+    ECS::Entity prefab = entityManager.CreatePrefab();
+    entityManager.AddSharedComponent(prefab, MakeComponent3(7, 1.0f));
+    std::vector<ECS::Entity> instances = entityManager.Instantiate(prefab, 5);
+
+    ECS::Entity single = entityManager.CreateEntity();
+    entityManager.AddSharedComponent(single, MakeComponent3(8, 1.0f));
+
+    // Instances share the prefab's value.
+    ASSERT_EQ(2, entityManager.GetSharedValueCount<Component3>());
+    ASSERT_EQ(entityManager.GetSharedComponent<Component3>(prefab), entityManager.GetSharedComponent<Component3>(instances[3]));
+
+    std::map<int, std::vector<ECS::Entity>> groups;
+    entityManager.ForEachSharedGroup<Component3>([&](const Component3& value, const std::vector<ECS::Entity>& entities)
+    {
+        groups[value.mesh] = entities;
+    });
+
+    std::vector<ECS::Entity> expected(1, prefab);
+    expected.insert(expected.end(), instances.begin(), instances.end());
+    ASSERT_EQ(2, groups.size());
+    ASSERT_EQ(expected, groups[7]);
+    ASSERT_EQ(std::vector<ECS::Entity>(1, single), groups[8]);
+
+    // Destroying members keeps the rest of the group intact.
+    entityManager.RemoveEntity(instances[0]);
+    entityManager.DestroyRemoved();
+    groups.clear();
+    entityManager.ForEachSharedGroup<Component3>([&](const Component3& value, const std::vector<ECS::Entity>& entities)
+    {
+        groups[value.mesh] = entities;
+    });
+
+    std::sort(groups[7].begin(), groups[7].end());
+    expected.erase(expected.begin() + 1);
+    ASSERT_EQ(expected, groups[7]);
+}
+
+struct UnitHot
+{
+    float x;
+    float y;
+};
+
+struct UnitCold
+{
+    char name[64];
+    int health;
+};
+
+/**
+ * @brief A split component, used for testing.
+ *
+ */
+struct Unit : public ECS::SplitComponent<Unit, UnitHot, UnitCold> {};
+
+TEST_F(EntityManagerTest, SplitComponents)
+{
+    std::vector<ECS::Entity> units;
+    for (int i = 0; i < 5; ++i)
+    {
+        units.push_back(entityManager.CreateEntity());
+        ECS::SplitView<Unit> unit = entityManager.AddSplitComponent<Unit>(units.back());
+        unit.hot->x = float(i);
+        unit.cold->health = 100 + i;
+    }
+
+    ASSERT_TRUE(entityManager.HasComponent<Unit>(units[0]));
+    ASSERT_TRUE(entityManager.GetSplitComponent<Unit>(entityManager.CreateEntity()).IsNull());
+
+    // The hot parts are packed on their own.
+    entityManager.ProcessSplitComponents<Unit>([](size_t count, UnitHot* hot, UnitCold*)
+    {
+        for (size_t i = 0; i < count; ++i)
+            hot[i].y = hot[i].x * 2.0f;
+    });
+
+    // Removing a component moves the parts of another one together.
+    entityManager.RemoveComponent<Unit>(units[1]);
+    entityManager.DestroyRemoved();
+    ASSERT_FALSE(entityManager.HasComponent<Unit>(units[1]));
+    ASSERT_TRUE(entityManager.GetSplitComponent<Unit>(units[1]).IsNull());
+    for (int i = 0; i < 5; ++i)
+    {
+        if (i == 1)
+            continue;
+
+        ECS::SplitView<Unit> unit = entityManager.GetSplitComponent<Unit>(units[i]);
+        ASSERT_EQ(float(i) * 2.0f, unit.hot->y);
+        ASSERT_EQ(100 + i, unit.cold->health);
+    }
+
+    // Instances copy both parts.
+    ECS::Entity prefab = entityManager.CreatePrefab();
+    entityManager.AddSplitComponent<Unit>(prefab).cold->health = 7;
+    ECS::Entity instance = entityManager.Instantiate(prefab, 2)[1];
+    ASSERT_EQ(7, entityManager.GetSplitComponent<Unit>(instance).cold->health);
+}
+
+/**
+ * @brief A blocked component, used for testing.
+ *
+ */
+struct Particle : public ECS::BlockedComponent<Particle, float, 4>
+{
+    float x;
+    float y;
+    float z;
+};
+
+static Particle MakeParticle(float x, float y, float z)
+{
+    Particle particle;
+    particle.x = x;
+    particle.y = y;
+    particle.z = z;
+    return particle;
+}
+
+TEST_F(EntityManagerTest, BlockedComponents)
+{
+    std::vector<ECS::Entity> particles;
+    for (int i = 0; i < 10; ++i)
+    {
+        particles.push_back(entityManager.CreateEntity());
+        entityManager.AddBlockedComponent(particles.back(), MakeParticle(float(i), float(i) + 0.5f, -float(i)));
+    }
+
+    // Fields are accessed per entity.
+    ECS::BlockedView<Particle> view = entityManager.GetBlockedComponent<Particle>(particles[6]);
+    ASSERT_EQ(6.5f, view.Field(&Particle::y));
+    view.Field(&Particle::z) = 60.0f;
+    ASSERT_EQ(60.0f, entityManager.GetBlockedComponent<Particle>(particles[6]).Load().z);
+
+    // Blocks store every field of WIDTH components contiguously.
+    std::vector<size_t> counts;
+    entityManager.ForEachBlock<Particle>([&](size_t count, float* block)
+    {
+        counts.push_back(count);
+        for (size_t i = 0; i < count; ++i)
+            block[i] += 100.0f;
+    });
+    ASSERT_EQ(3U, counts.size());
+    ASSERT_EQ(2U, counts[2]);
+    ASSERT_EQ(104.0f, entityManager.GetBlockedComponent<Particle>(particles[4]).Field(&Particle::x));
+    ASSERT_EQ(4.5f, entityManager.GetBlockedComponent<Particle>(particles[4]).Field(&Particle::y));
+
+    // Removing components keeps the blocks packed and drops empty ones.
+    entityManager.RemoveComponent<Particle>(particles[0]);
+    entityManager.RemoveEntity(particles[3]);
+    entityManager.RemoveEntity(particles[5]);
+    entityManager.DestroyRemoved();
+    counts.clear();
+    entityManager.ForEachBlock<Particle>([&](size_t count, float*) { counts.push_back(count); });
+    ASSERT_EQ(2U, counts.size());
+    ASSERT_EQ(3U, counts[1]);
+
+    Particle particle = entityManager.GetBlockedComponent<Particle>(particles[9]).Load();
+    ASSERT_EQ(109.0f, particle.x);
+    ASSERT_EQ(9.5f, particle.y);
+    ASSERT_EQ(-9.0f, particle.z);
+    ASSERT_EQ(60.0f, entityManager.GetBlockedComponent<Particle>(particles[6]).Field(&Particle::z));
+    ASSERT_TRUE(entityManager.GetBlockedComponent<Particle>(particles[0]).IsNull());
+
+    // Instances copy the prototype into their lanes.
+    ECS::Entity prefab = entityManager.CreatePrefab();
+    entityManager.AddBlockedComponent(prefab, MakeParticle(1.0f, 2.0f, 3.0f));
+    std::vector<ECS::Entity> instances = entityManager.Instantiate(prefab, 5);
+    for (auto instance : instances)
+        ASSERT_EQ(3.0f, entityManager.GetBlockedComponent<Particle>(instance).Field(&Particle::z));
+}
+
+
 
 /**
  * @brief An implementation of an entity observer, used for testing.
@@ -223,6 +1038,49 @@ TEST_F(EntityManagerTest, ObserverEvents)
     }
 }
 
+TEST_F(EntityManagerTest, PrefabObserverEvents)
+{
+    EntityObserverImpl observer;
+    entityManager.AddEntityObserver(&observer);
+
+    // Building a prefab is not observed.
+    ECS::Entity prefab = entityManager.CreatePrefab();
+    entityManager.AddComponent<Component1>(prefab);
+    entityManager.AddComponent<Component2>(prefab);
+    ASSERT_TRUE(observer.entitiesCreated.empty());
+    ASSERT_TRUE(observer.componentsAdded.empty());
+
+    // Instantiating is, through the default ComponentsAdded.
+    std::vector<ECS::Entity> instances = entityManager.Instantiate(prefab, 2);
+    ASSERT_EQ(instances, observer.entitiesCreated);
+    ASSERT_EQ(4, observer.componentsAdded.size());
+    ASSERT_EQ(instances[1], observer.componentsAdded.back().entity);
+}
+
+TEST_F(EntityManagerTest, ConcurrentSpawningObserverEvents)
+{
+    EntityObserverImpl observer;
+    entityManager.AddEntityObserver(&observer);
+
+    entityManager.BeginConcurrentSpawning(3, 1);
+    entityManager.ReserveConcurrentComponents<Component1>(1);
+    ECS::SpawnContext* context = entityManager.GetSpawnContext(0);
+    ECS::Entity a = context->CreateEntity();
+    ECS::Entity b = context->CreateEntity();
+    context->AddComponent<Component1>(b);
+
+    // Nothing is visible until the spawning ends.
+    ASSERT_TRUE(observer.entitiesCreated.empty());
+    ASSERT_TRUE(entityManager.GetActiveEntities().empty());
+
+    entityManager.EndConcurrentSpawning();
+    ASSERT_EQ(2, observer.entitiesCreated.size());
+    ASSERT_EQ(a, observer.entitiesCreated[0]);
+    ASSERT_EQ(b, observer.entitiesCreated[1]);
+    ASSERT_EQ(1, observer.componentsAdded.size());
+    ASSERT_EQ(b, observer.componentsAdded[0].entity);
+}
+
 TEST_F(EntityManagerTest, GetActiveEntities)
 {
     const std::set<ECS::Entity>& entities = entityManager.GetActiveEntities();
@@ -0,0 +1,106 @@
+#include <thread>
+#include <gtest/gtest.h>
+#include "../include/ecs_include.h"
+
+/**
+ * @brief An event used for testing.
+ *
+ */
+struct DamageEvent : public ECS::Event<DamageEvent>
+{
+    ECS::Entity target;
+    int amount;
+
+    DamageEvent(ECS::Entity target, int amount) : target(target), amount(amount) {}
+};
+
+/**
+ * @brief Another event used for testing.
+ *
+ */
+struct TriggerEvent : public ECS::Event<TriggerEvent>
+{
+    int trigger;
+};
+
+/**
+ * @brief A fixture for testing the event bus.
+ */
+class EventBusTest : public ::testing::Test
+{
+public:
+    EventBusTest();
+
+    ECS::EventBus eventBus;
+};
+
+EventBusTest::EventBusTest()
+{
+    eventBus.RegisterEvent<DamageEvent>(4);
+    eventBus.RegisterEvent<TriggerEvent>();
+}
+
+
+
+TEST_F(EventBusTest, EventsAreReadableForOneFrame)
+{
+    eventBus.Publish(DamageEvent(1, 10));
+    eventBus.Publish(DamageEvent(2, 20));
+
+    // Events published during a frame are read in the next one.
+    ASSERT_EQ(0, eventBus.Read<DamageEvent>().Size());
+    eventBus.Update();
+
+    ECS::EventSpan<DamageEvent> events = eventBus.Read<DamageEvent>();
+    ASSERT_EQ(2, events.Size());
+    ASSERT_EQ(1, events[0].target);
+    ASSERT_EQ(20, events[1].amount);
+    ASSERT_EQ(0, eventBus.Read<TriggerEvent>().Size());
+
+    eventBus.Update();
+    ASSERT_EQ(0, eventBus.Read<DamageEvent>().Size());
+}
+
+TEST_F(EventBusTest, OverflowGrowsCapacity)
+{
+    for (int i = 0; i < 10; ++i)
+        eventBus.Publish(DamageEvent(0, i));
+    eventBus.Update();
+
+    int sum = 0;
+    for (auto& event : eventBus.Read<DamageEvent>())
+        sum += event.amount;
+    ASSERT_EQ(45, sum);
+
+    // The next frames have room for as many events without overflowing.
+    ECS::Private::EventChannel<DamageEvent>* channel = static_cast<ECS::Private::EventChannel<DamageEvent>*>(eventBus.channels[DamageEvent::ID]);
+    ASSERT_EQ(10, channel->capacity);
+}
+
+TEST_F(EventBusTest, ConcurrentPublishing)
+{
+    const int THREAD_COUNT = 4;
+    const int EVENTS_PER_THREAD = 1000;
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < THREAD_COUNT; ++t)
+    {
+        threads.push_back(std::thread([&, t]()
+        {
+            for (int i = 0; i < EVENTS_PER_THREAD; ++i)
+                eventBus.Publish(DamageEvent(static_cast<ECS::Entity>(t), 1));
+        }));
+    }
+    for (auto& thread : threads)
+        thread.join();
+    eventBus.Update();
+
+    ECS::EventSpan<DamageEvent> events = eventBus.Read<DamageEvent>();
+    ASSERT_EQ(THREAD_COUNT * EVENTS_PER_THREAD, events.Size());
+
+    std::vector<int> perThread(THREAD_COUNT, 0);
+    for (auto& event : events)
+        perThread[event.target] += event.amount;
+    for (int t = 0; t < THREAD_COUNT; ++t)
+        ASSERT_EQ(EVENTS_PER_THREAD, perThread[static_cast<size_t>(t)]);
+}
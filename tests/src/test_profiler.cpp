@@ -0,0 +1,66 @@
+#include <gtest/gtest.h>
+#include "../include/ecs_include.h"
+#include "../include/components.h"
+
+/**
+ * @brief A system that does some work on every entity, used for testing.
+ *
+ */
+class IncrementSystem : public ECS::EntitySystem
+{
+public:
+    IncrementSystem()
+    {
+        Require<Component1>();
+    }
+
+    void ProcessEntity(ECS::Entity entity)
+    {
+        ++GetEntityManager()->GetComponent<Component1>(entity)->value;
+    }
+};
+
+TEST(Profiler, RecordsSystemsPerFrame)
+{
+    ECS::Profiler profiler;
+    ECS::EntityManager entityManager;
+    ECS::SystemManager systemManager(&entityManager);
+    systemManager.SetProfiler(&profiler);
+    entityManager.SetProfiler(&profiler);
+
+    IncrementSystem* system = new IncrementSystem;
+    systemManager.RegisterSystem(system);
+    for (int i = 0; i < 100; ++i)
+        entityManager.AddComponent<Component1>(entityManager.CreateEntity());
+
+    system->Process();
+    system->Process();
+    entityManager.DestroyRemoved();
+
+    // Nothing is visible per frame until the frame is finished.
+    ASSERT_EQ(0U, profiler.GetFrameStatistics(system).calls);
+    ASSERT_EQ(2U, profiler.GetTotalStatistics(system).calls);
+
+    profiler.NextFrame();
+    ASSERT_EQ(1U, profiler.GetFrameCount());
+    ECS::ProfileStatistics frame = profiler.GetFrameStatistics(system);
+    ASSERT_EQ(2U, frame.calls);
+    ASSERT_EQ(1U, profiler.GetFrameStatistics(&entityManager).calls);
+
+    // Unavailable counters read as zero, available ones have counted the work.
+    if (profiler.IsAvailable(ECS::ProfileStatistics::INSTRUCTIONS))
+        ASSERT_GT(frame.counters[ECS::ProfileStatistics::INSTRUCTIONS], 0U);
+    else
+        ASSERT_EQ(0U, frame.counters[ECS::ProfileStatistics::INSTRUCTIONS]);
+
+    system->Process();
+    profiler.NextFrame();
+    ASSERT_EQ(1U, profiler.GetFrameStatistics(system).calls);
+    ASSERT_EQ(0U, profiler.GetFrameStatistics(&entityManager).calls);
+    ASSERT_EQ(3U, profiler.GetTotalStatistics(system).calls);
+
+    // Systems stop being measured when the profiler is removed.
+    systemManager.SetProfiler(nullptr);
+    system->Process();
+    ASSERT_EQ(3U, profiler.GetTotalStatistics(system).calls);
+}
@@ -0,0 +1,132 @@
+#include <set>
+#include <thread>
+#include <gtest/gtest.h>
+#include "../include/ecs_include.h"
+#include "../include/components.h"
+
+/**
+ * @brief Records the entities with Component1 it processes, used for testing.
+ *
+ */
+class ShardSystem : public ECS::EntitySystem
+{
+public:
+    ShardSystem()
+    {
+        Require<Component1>();
+    }
+
+    void ProcessEntity(ECS::Entity entity)
+    {
+        processed.push_back(entity);
+    }
+
+    std::vector<ECS::Entity> processed;
+};
+
+/**
+ * @brief A fixture for testing the sharded world.
+ */
+class ShardedWorldTest : public ::testing::Test
+{
+public:
+    ShardedWorldTest();
+
+    ECS::ShardedWorld world;
+};
+
+ShardedWorldTest::ShardedWorldTest() : world(3, 1024) {}
+
+
+
+TEST_F(ShardedWorldTest, UniqueEntitiesAcrossShards)
+{
+    const size_t ENTITY_COUNT = 1000;
+    std::vector<std::vector<ECS::Entity>> created(world.GetShardCount());
+
+    // Every shard creates entities on its own thread.
+    std::vector<std::thread> threads;
+    for (size_t shard = 0; shard < world.GetShardCount(); ++shard)
+    {
+        threads.push_back(std::thread([&, shard]()
+        {
+            for (size_t i = 0; i < ENTITY_COUNT; ++i)
+                created[shard].push_back(world.GetEntityManager(shard)->CreateEntity());
+        }));
+    }
+    for (auto& thread : threads)
+        thread.join();
+
+    std::set<ECS::Entity> unique;
+    for (size_t shard = 0; shard < world.GetShardCount(); ++shard)
+    {
+        for (auto entity : created[shard])
+        {
+            unique.insert(entity);
+            ASSERT_EQ(shard, world.Resolve(entity));
+        }
+    }
+    ASSERT_EQ(ENTITY_COUNT * world.GetShardCount(), unique.size());
+}
+
+TEST_F(ShardedWorldTest, Migrate)
+{
+    ECS::EntityManager* source = world.GetEntityManager(0);
+    ECS::EntityManager* target = world.GetEntityManager(1);
+    ShardSystem* sourceSystem = new ShardSystem;
+    ShardSystem* targetSystem = new ShardSystem;
+    world.GetSystemManager(0)->RegisterSystem(sourceSystem);
+    world.GetSystemManager(1)->RegisterSystem(targetSystem);
+
+    std::vector<ECS::Entity> entities;
+    for (int i = 0; i < 10; ++i)
+    {
+        ECS::Entity entity = source->CreateEntity();
+        source->AddComponent<Component1>(entity)->value = i;
+        source->AddComponent<Component2>(entity)->foo = static_cast<float>(i);
+        source->AddSharedComponent<Component3>(entity, Component3());
+        entities.push_back(entity);
+    }
+
+    // A removed component is not migrated.
+    source->RemoveComponent<Component2>(entities[0]);
+    source->SetEnabled(entities[1], false);
+
+    std::vector<ECS::Entity> moved(entities.begin(), entities.begin() + 5);
+    world.Migrate(moved, 0, 1);
+
+    for (size_t i = 0; i < moved.size(); ++i)
+    {
+        ECS::Entity entity = moved[i];
+        ASSERT_TRUE(source->IsDestroyed(entity));
+        ASSERT_FALSE(sourceSystem->HasEntity(entity));
+        ASSERT_EQ(1, world.Resolve(entity));
+
+        ASSERT_EQ(static_cast<int>(i), target->GetComponent<Component1>(entity)->value);
+        ASSERT_EQ(i != 0, target->HasComponent<Component2>(entity));
+        ASSERT_TRUE(target->HasComponent<Component3>(entity));
+        ASSERT_EQ(i != 1, target->IsEnabled(entity));
+        ASSERT_TRUE(targetSystem->HasEntity(entity));
+    }
+    ASSERT_EQ(1, target->GetSharedValueCount<Component3>());
+    ASSERT_EQ(5, source->GetActiveEntities().size());
+    ASSERT_EQ(5, sourceSystem->GetEntityCount());
+    ASSERT_EQ(5, source->pools[Component1::ID]->Size());
+    ASSERT_EQ(4, target->pools[Component2::ID]->Size());
+
+    // Moving back to the home shard works too, and destroyed entities no longer resolve.
+    world.Migrate(std::vector<ECS::Entity>(1, moved[2]), 1, 0);
+    ASSERT_EQ(0, world.Resolve(moved[2]));
+    ASSERT_EQ(2, source->GetComponent<Component1>(moved[2])->value);
+
+    target->RemoveEntity(moved[3]);
+    world.DestroyRemoved();
+    ASSERT_EQ(ECS::ShardedWorld::INVALID_SHARD, world.Resolve(moved[3]));
+    ASSERT_TRUE(world.migrated.find(moved[3]) == world.migrated.end());
+
+    // Destroying an entity that was never migrated leaves the migrated ones alone.
+    source->RemoveEntity(entities[9]);
+    world.DestroyRemoved();
+    ASSERT_EQ(3U, world.migrated.size());
+    ASSERT_EQ(1, world.Resolve(moved[4]));
+}
@@ -0,0 +1,112 @@
+#include <algorithm>
+#include <gtest/gtest.h>
+#include "../include/ecs_include.h"
+
+/**
+ * @brief A position component used for testing.
+ *
+ */
+struct Position : public ECS::Component<Position>
+{
+    float x;
+    float y;
+};
+
+typedef ECS::SpatialGrid<Position> Grid;
+
+static Grid::Point GetPoint(const Position& position)
+{
+    Grid::Point point = { position.x, position.y, 0.0f };
+    return point;
+}
+
+/**
+ * @brief A fixture for testing the spatial grid.
+ */
+class SpatialGridTest : public ::testing::Test
+{
+public:
+    SpatialGridTest();
+
+    ECS::Entity Spawn(float x, float y);
+
+    ECS::EntityManager entityManager;
+};
+
+SpatialGridTest::SpatialGridTest() : entityManager(1024) {}
+
+ECS::Entity SpatialGridTest::Spawn(float x, float y)
+{
+    ECS::Entity entity = entityManager.CreateEntity();
+    Position* position = entityManager.AddComponent<Position>(entity);
+    position->x = x;
+    position->y = y;
+    entityManager.NotifyComponentChanged<Position>(entity);
+    return entity;
+}
+
+static std::vector<ECS::Entity> Sorted(std::vector<ECS::Entity> entities)
+{
+    std::sort(entities.begin(), entities.end());
+    return entities;
+}
+
+
+
+TEST_F(SpatialGridTest, IncrementalQueries)
+{
+    ECS::Entity a = Spawn(0.0f, 0.0f);
+    Grid grid(&entityManager, 4.0f, &GetPoint);
+    ECS::Entity b = Spawn(3.0f, 4.0f);
+    ECS::Entity c = Spawn(-10.0f, 2.0f);
+    ECS::Entity d = Spawn(100.0f, 100.0f);
+    ASSERT_EQ(4, grid.Size());
+
+    Grid::Point origin = { 0.0f, 0.0f, 0.0f };
+    std::vector<ECS::Entity> expected = { a, b };
+    ASSERT_EQ(Sorted(expected), Sorted(grid.QueryRadius(origin, 5.0f)));
+    ASSERT_EQ(std::vector<ECS::Entity>(1, a), grid.QueryRadius(origin, 4.9f));
+
+    Grid::Point min = { -20.0f, -1.0f, 0.0f };
+    Grid::Point max = { 1.0f, 10.0f, 0.0f };
+    expected = { a, c };
+    ASSERT_EQ(Sorted(expected), Sorted(grid.QueryBox(min, max)));
+
+    // A huge box visits the non-empty cells instead of every overlapped cell.
+    Grid::Point hugeMin = { -1e6f, -1e6f, -1.0f };
+    Grid::Point hugeMax = { 1e6f, 1e6f, 1.0f };
+    ASSERT_EQ(4, grid.QueryBox(hugeMin, hugeMax).size());
+
+    // Moving, removing components and removing entities update the grid.
+    entityManager.GetComponent<Position>(d)->x = 1.0f;
+    entityManager.GetComponent<Position>(d)->y = 1.0f;
+    entityManager.NotifyComponentChanged<Position>(d);
+    entityManager.RemoveComponent<Position>(a);
+    entityManager.RemoveEntity(b);
+    ASSERT_EQ(std::vector<ECS::Entity>(1, d), grid.QueryRadius(origin, 5.0f));
+    ASSERT_EQ(2, grid.Size());
+}
+
+TEST_F(SpatialGridTest, BulkRebuild)
+{
+    Grid grid(&entityManager, 1.0f, &GetPoint, Grid::BULK);
+    std::vector<ECS::Entity> entities;
+    for (int i = 0; i < 100; ++i)
+        entities.push_back(Spawn(static_cast<float>(i), 0.0f));
+
+    // Bulk grids only change when rebuilt.
+    ASSERT_EQ(0, grid.Size());
+    grid.Rebuild();
+    ASSERT_EQ(100, grid.Size());
+
+    Grid::Point center = { 50.0f, 0.0f, 0.0f };
+    ASSERT_EQ(5, grid.QueryRadius(center, 2.0f).size());
+
+    for (auto entity : entities)
+        entityManager.GetComponent<Position>(entity)->y = 10.0f;
+    grid.Rebuild();
+    ASSERT_EQ(0, grid.QueryRadius(center, 2.0f).size());
+    center.y = 10.0f;
+    ASSERT_EQ(5, grid.QueryRadius(center, 2.0f).size());
+    ASSERT_EQ(100, grid.cells.size());
+}
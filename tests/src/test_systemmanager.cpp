@@ -0,0 +1,662 @@
+#include <chrono>
+#include <set>
+#include <gtest/gtest.h>
+#include "../include/ecs_include.h"
+#include "../include/components.h"
+
+/**
+ * @brief A system that records the entities it processes, used for testing.
+ *
+ */
+class RecordingSystem : public ECS::EntitySystem
+{
+public:
+    void ProcessEntity(ECS::Entity entity)
+    {
+        processed.push_back(entity);
+    }
+
+    std::vector<ECS::Entity> processed;
+};
+
+/**
+ * @brief Processes entities with Component1 but without Component2.
+ *
+ */
+class ExcludeSystem : public RecordingSystem
+{
+public:
+    ExcludeSystem()
+    {
+        Require<Component1>();
+        Exclude<Component2>();
+    }
+};
+
+/**
+ * @brief Processes entities with Component1 or Component2.
+ *
+ */
+class AnyOfSystem : public RecordingSystem
+{
+public:
+    AnyOfSystem()
+    {
+        RequireAnyOf<Component1>();
+        RequireAnyOf<Component2>();
+    }
+};
+
+/**
+ * @brief A fixture for testing the system manager.
+ */
+class SystemManagerTest : public ::testing::Test
+{
+public:
+    SystemManagerTest();
+
+    ECS::EntityManager entityManager;
+    ECS::SystemManager systemManager;
+};
+
+SystemManagerTest::SystemManagerTest() : entityManager(1024), systemManager(&entityManager) {}
+
+
+
+TEST_F(SystemManagerTest, ObservesEntityManager)
+{
+    ASSERT_TRUE(entityManager.IsObserving(&systemManager));
+}
+
+TEST_F(SystemManagerTest, ExcludeMask)
+{
+    ExcludeSystem* system = new ExcludeSystem;
+    systemManager.RegisterSystem(system);
+
+    ECS::Entity e = entityManager.CreateEntity();
+    ASSERT_EQ(0, system->GetEntityCount());
+
+    entityManager.AddComponent<Component1>(e);
+    ASSERT_TRUE(system->HasEntity(e));
+
+    // Adding an excluded component takes the entity out of the system, removing it puts it back.
+    entityManager.AddComponent<Component2>(e);
+    ASSERT_FALSE(system->HasEntity(e));
+
+    entityManager.RemoveComponent<Component2>(e);
+    ASSERT_TRUE(system->HasEntity(e));
+
+    system->Process();
+    ASSERT_EQ(std::vector<ECS::Entity>(1, e), system->processed);
+}
+
+TEST_F(SystemManagerTest, AnyOfMask)
+{
+    AnyOfSystem* system = new AnyOfSystem;
+    systemManager.RegisterSystem(system);
+
+    ECS::Entity none = entityManager.CreateEntity();
+    ECS::Entity first = entityManager.CreateEntity();
+    ECS::Entity second = entityManager.CreateEntity();
+    ECS::Entity both = entityManager.CreateEntity();
+    entityManager.AddComponent<Component1>(first);
+    entityManager.AddComponent<Component2>(second);
+    entityManager.AddComponent<Component1>(both);
+    entityManager.AddComponent<Component2>(both);
+
+    ASSERT_FALSE(system->HasEntity(none));
+    ASSERT_TRUE(system->HasEntity(first));
+    ASSERT_TRUE(system->HasEntity(second));
+    ASSERT_TRUE(system->HasEntity(both));
+}
+
+TEST_F(SystemManagerTest, RegisterMatchesExistingEntities)
+{
+    ECS::Entity matching = entityManager.CreateEntity();
+    ECS::Entity excluded = entityManager.CreateEntity();
+    entityManager.AddComponent<Component1>(matching);
+    entityManager.AddComponent<Component1>(excluded);
+    entityManager.AddComponent<Component2>(excluded);
+
+    ExcludeSystem* system = new ExcludeSystem;
+    systemManager.RegisterSystem(system);
+
+    ASSERT_EQ(1, system->GetEntityCount());
+    ASSERT_TRUE(system->HasEntity(matching));
+}
+
+
+
+/**
+ * @brief A reactive system that records the entities it is handed, used for testing.
+ *
+ */
+class RecordingReactiveSystem : public ECS::ReactiveSystem
+{
+public:
+    RecordingReactiveSystem()
+    {
+        Require<Component1>();
+    }
+
+    void ProcessEntered(const std::vector<ECS::Entity>& entities)
+    {
+        entered = entities;
+    }
+
+    void ProcessExited(const std::vector<ECS::Entity>& entities)
+    {
+        exited = entities;
+    }
+
+    void Reset()
+    {
+        entered.clear();
+        exited.clear();
+    }
+
+    std::vector<ECS::Entity> entered;
+    std::vector<ECS::Entity> exited;
+};
+
+TEST_F(SystemManagerTest, ReactiveSystemReportsChanges)
+{
+    RecordingReactiveSystem* system = new RecordingReactiveSystem;
+    systemManager.RegisterSystem(system);
+
+    ECS::Entity e1 = entityManager.CreateEntity();
+    ECS::Entity e2 = entityManager.CreateEntity();
+    entityManager.AddComponent<Component1>(e2);
+    entityManager.AddComponent<Component1>(e1);
+    entityManager.AddComponent<Component2>(e1);
+
+    system->Process();
+    ASSERT_EQ((std::vector<ECS::Entity> { e1, e2 }), system->entered);
+    ASSERT_TRUE(system->exited.empty());
+
+    // Nothing changed since the last call.
+    system->Reset();
+    system->Process();
+    ASSERT_TRUE(system->entered.empty());
+    ASSERT_TRUE(system->exited.empty());
+
+    entityManager.RemoveComponent<Component1>(e1);
+    entityManager.RemoveEntity(e2);
+    system->Process();
+    ASSERT_TRUE(system->entered.empty());
+    ASSERT_EQ((std::vector<ECS::Entity> { e1, e2 }), system->exited);
+}
+
+TEST_F(SystemManagerTest, ReactiveSystemDeduplicates)
+{
+    RecordingReactiveSystem* system = new RecordingReactiveSystem;
+    systemManager.RegisterSystem(system);
+
+    ECS::Entity flicker = entityManager.CreateEntity();
+    ECS::Entity readded = entityManager.CreateEntity();
+    entityManager.AddComponent<Component1>(readded);
+    system->Process();
+    system->Reset();
+
+    // Matching and unmatching between two calls cancels out.
+    entityManager.AddComponent<Component1>(flicker);
+    entityManager.RemoveComponent<Component1>(flicker);
+
+    // So does unmatching and matching again.
+    entityManager.RemoveComponent<Component1>(readded);
+    entityManager.AddComponent<Component1>(readded);
+
+    system->Process();
+    ASSERT_TRUE(system->entered.empty());
+    ASSERT_TRUE(system->exited.empty());
+}
+
+
+
+/**
+ * @brief Adds the foo of Component2 to the value of Component1, used for testing.
+ *
+ */
+class AccumulateSystem : public ECS::BatchSystem<Component1, const Component2>
+{
+public:
+    void ProcessBatch(size_t count, Component1* c1, const Component2* c2)
+    {
+        batchSizes.push_back(count);
+        for (size_t i = 0; i < count; ++i)
+            c1[i].value += static_cast<int>(c2[i].foo);
+    }
+
+    std::vector<size_t> batchSizes;
+};
+
+TEST_F(SystemManagerTest, BatchSystemProcessesRuns)
+{
+    AccumulateSystem* system = new AccumulateSystem;
+    systemManager.RegisterSystem(system);
+
+    const int ENTITY_COUNT = 100;
+    std::vector<ECS::Entity> entities;
+    for (int i = 0; i < ENTITY_COUNT; ++i)
+    {
+        entities.push_back(entityManager.CreateEntity());
+        entityManager.AddComponent<Component1>(entities.back())->value = i;
+        entityManager.AddComponent<Component2>(entities.back())->foo = 1.0f;
+    }
+
+    // Entities built in the same order are processed in one batch.
+    system->Process();
+    ASSERT_EQ(std::vector<size_t>(1, ENTITY_COUNT), system->batchSizes);
+    for (int i = 0; i < ENTITY_COUNT; ++i)
+        ASSERT_EQ(i + 1, entityManager.GetComponent<Component1>(entities[i])->value);
+
+    // Destroying a component in the middle splits the run, but every entity is still processed once.
+    entityManager.RemoveComponent<Component2>(entities[10]);
+    entityManager.DestroyRemoved();
+    system->batchSizes.clear();
+    system->Process();
+
+    size_t processed = 0;
+    for (auto size : system->batchSizes)
+        processed += size;
+    ASSERT_EQ(ENTITY_COUNT - 1, processed);
+    ASSERT_EQ(11, entityManager.GetComponent<Component1>(entities[10])->value);
+    ASSERT_EQ(ENTITY_COUNT + 1, entityManager.GetComponent<Component1>(entities.back())->value);
+}
+
+TEST_F(SystemManagerTest, GroupedBatchSystemProcessesOneRun)
+{
+    entityManager.CreateGroup<Component1, Component2>();
+    AccumulateSystem* system = new AccumulateSystem;
+    systemManager.RegisterSystem(system);
+
+    // Give the entities their components in different orders, with other entities in between.
+    const int ENTITY_COUNT = 50;
+    for (int i = 0; i < ENTITY_COUNT; ++i)
+    {
+        ECS::Entity entity = entityManager.CreateEntity();
+        entityManager.AddComponent<Component1>(entityManager.CreateEntity());
+        if (i % 2 == 0)
+        {
+            entityManager.AddComponent<Component1>(entity)->value = i;
+            entityManager.AddComponent<Component2>(entity)->foo = 1.0f;
+        }
+        else
+        {
+            entityManager.AddComponent<Component2>(entity)->foo = 1.0f;
+            entityManager.AddComponent<Component1>(entity)->value = i;
+        }
+    }
+
+    system->Process();
+    ASSERT_EQ(std::vector<size_t>(1, ENTITY_COUNT), system->batchSizes);
+}
+
+TEST_F(SystemManagerTest, BatchColumnsAreAligned)
+{
+    AccumulateSystem* system = new AccumulateSystem;
+    systemManager.RegisterSystem(system);
+
+    ECS::Entity e = entityManager.CreateEntity();
+    entityManager.AddComponent<Component1>(e);
+    entityManager.AddComponent<Component2>(e);
+
+    ASSERT_EQ(0, reinterpret_cast<uintptr_t>(entityManager.GetComponent<Component1>(e)) % ECS::COLUMN_ALIGNMENT);
+    ASSERT_EQ(0, reinterpret_cast<uintptr_t>(entityManager.GetComponent<Component2>(e)) % ECS::COLUMN_ALIGNMENT);
+}
+
+/**
+ * @brief Removes every entity it processes, used for testing.
+ *
+ */
+class RemovingSystem : public RecordingSystem
+{
+public:
+    RemovingSystem(ECS::EntityManager* entityManager)
+    {
+        Require<Component1>();
+        this->entityManager = entityManager;
+    }
+
+    void ProcessEntity(ECS::Entity entity)
+    {
+        RecordingSystem::ProcessEntity(entity);
+
+        // Remove this entity and the next one, which must then not be visited.
+        entityManager->RemoveEntity(entity);
+        if (!entityManager->IsRemoved(entity + 1))
+            entityManager->RemoveEntity(entity + 1);
+    }
+
+    ECS::EntityManager* entityManager;
+};
+
+TEST_F(SystemManagerTest, RemoveWhileProcessing)
+{
+    RemovingSystem* system = new RemovingSystem(&entityManager);
+    systemManager.RegisterSystem(system);
+
+    for (int i = 0; i < 6; ++i)
+        entityManager.AddComponent<Component1>(entityManager.CreateEntity());
+
+    system->Process();
+    ASSERT_EQ((std::vector<ECS::Entity> { 0, 2, 4 }), system->processed);
+    ASSERT_EQ(0, system->GetEntityCount());
+    ASSERT_TRUE(system->GetEntities().empty());
+}
+
+/**
+ * @brief Processes entities with Component1.
+ *
+ */
+class Component1System : public RecordingSystem
+{
+public:
+    Component1System()
+    {
+        Require<Component1>();
+    }
+};
+
+TEST_F(SystemManagerTest, DisabledEntitiesAreNotProcessed)
+{
+    Component1System* system = new Component1System;
+    systemManager.RegisterSystem(system);
+
+    std::vector<ECS::Entity> entities;
+    for (int i = 0; i < 4; ++i)
+    {
+        entities.push_back(entityManager.CreateEntity());
+        entityManager.AddComponent<Component1>(entities.back());
+    }
+
+    entityManager.SetEnabled(entities[1], false);
+    ASSERT_FALSE(entityManager.IsEnabled(entities[1]));
+    ASSERT_TRUE(system->HasEntity(entities[1]));
+    ASSERT_EQ(4, system->GetEntityCount());
+    ASSERT_EQ(3, system->GetEnabledEntityCount());
+
+    system->Process();
+    std::sort(system->processed.begin(), system->processed.end());
+    ASSERT_EQ((std::vector<ECS::Entity> { entities[0], entities[2], entities[3] }), system->processed);
+
+    // New components on disabled entities keep them in the disabled part.
+    ECS::Entity sleeper = entityManager.CreateEntity();
+    entityManager.SetEnabled(sleeper, false);
+    entityManager.AddComponent<Component1>(sleeper);
+    ASSERT_TRUE(system->HasEntity(sleeper));
+    ASSERT_EQ(3, system->GetEnabledEntityCount());
+
+    // Removing a disabled entity works as usual.
+    entityManager.RemoveEntity(entities[1]);
+    ASSERT_FALSE(system->HasEntity(entities[1]));
+    ASSERT_EQ(3, system->GetEnabledEntityCount());
+
+    entityManager.SetEnabled(sleeper, true);
+    system->processed.clear();
+    system->Process();
+    ASSERT_EQ(4, system->processed.size());
+}
+
+TEST_F(SystemManagerTest, DisabledComponentsDoNotMatch)
+{
+    ExcludeSystem* system = new ExcludeSystem;
+    systemManager.RegisterSystem(system);
+
+    ECS::Entity e = entityManager.CreateEntity();
+    entityManager.AddComponent<Component1>(e);
+    entityManager.AddComponent<Component2>(e);
+    ASSERT_FALSE(system->HasEntity(e));
+
+    // Disabling the excluded component makes the entity match, without touching its storage.
+    Component2* c2 = entityManager.GetComponent<Component2>(e);
+    entityManager.SetComponentEnabled<Component2>(e, false);
+    ASSERT_FALSE(entityManager.IsComponentEnabled<Component2>(e));
+    ASSERT_TRUE(entityManager.HasComponent<Component2>(e));
+    ASSERT_EQ(c2, entityManager.GetComponent<Component2>(e));
+    ASSERT_TRUE(system->HasEntity(e));
+
+    entityManager.SetComponentEnabled<Component1>(e, false);
+    ASSERT_FALSE(system->HasEntity(e));
+
+    entityManager.SetComponentEnabled<Component1>(e, true);
+    entityManager.SetComponentEnabled<Component2>(e, true);
+    ASSERT_FALSE(system->HasEntity(e));
+}
+
+/**
+ * @brief Disables every entity it processes, used for testing.
+ *
+ */
+class DisablingSystem : public Component1System
+{
+public:
+    DisablingSystem(ECS::EntityManager* entityManager)
+    {
+        this->entityManager = entityManager;
+    }
+
+    void ProcessEntity(ECS::Entity entity)
+    {
+        RecordingSystem::ProcessEntity(entity);
+        entityManager->SetEnabled(entity, false);
+    }
+
+    ECS::EntityManager* entityManager;
+};
+
+TEST_F(SystemManagerTest, DisableWhileProcessing)
+{
+    DisablingSystem* system = new DisablingSystem(&entityManager);
+    systemManager.RegisterSystem(system);
+
+    for (int i = 0; i < 5; ++i)
+        entityManager.AddComponent<Component1>(entityManager.CreateEntity());
+
+    system->Process();
+    ASSERT_EQ(5, system->processed.size());
+    ASSERT_EQ(5, system->GetEntityCount());
+    ASSERT_EQ(0, system->GetEnabledEntityCount());
+
+    system->processed.clear();
+    system->Process();
+    ASSERT_TRUE(system->processed.empty());
+}
+
+/**
+ * @brief Pipeline stages used for testing. Each records the order of the calls and changes Component1.
+ *
+ */
+struct DoubleStage : public ECS::PipelineStage<Component1>
+{
+    void Process(ECS::Entity entity, Component1* c1)
+    {
+        calls.push_back(entity);
+        c1->value *= 2;
+    }
+
+    std::vector<ECS::Entity> calls;
+};
+
+struct AddFooStage : public ECS::PipelineStage<Component1, const Component2>
+{
+    void Process(ECS::Entity entity, Component1* c1, const Component2* c2)
+    {
+        calls.push_back(entity);
+        c1->value += static_cast<int>(c2->foo);
+    }
+
+    std::vector<ECS::Entity> calls;
+};
+
+struct RemoveOddStage : public ECS::PipelineStage<const Component1>
+{
+    RemoveOddStage() : entityManager(nullptr) {}
+
+    void Process(ECS::Entity entity, const Component1* c1)
+    {
+        if (c1->value % 2 != 0)
+            entityManager->RemoveEntity(entity);
+    }
+
+    ECS::EntityManager* entityManager;
+};
+
+TEST_F(SystemManagerTest, PipelineRunsStagesInOnePass)
+{
+    ECS::Pipeline<DoubleStage, AddFooStage>* pipeline = systemManager.RegisterPipeline<DoubleStage, AddFooStage>();
+    ASSERT_TRUE(pipeline->GetAspect().test(ECS::Component<Component1>::ID));
+    ASSERT_TRUE(pipeline->GetAspect().test(ECS::Component<Component2>::ID));
+
+    std::vector<ECS::Entity> entities;
+    for (int i = 0; i < 10; ++i)
+    {
+        ECS::Entity entity = entityManager.CreateEntity();
+        entityManager.AddComponent<Component1>(entity)->value = i;
+        entityManager.AddComponent<Component2>(entity)->foo = 1.0f;
+        entities.push_back(entity);
+    }
+    entityManager.AddComponent<Component1>(entityManager.CreateEntity());
+
+    pipeline->Process();
+
+    // Same result as running the stages one after the other, but interleaved per entity.
+    for (int i = 0; i < 10; ++i)
+        ASSERT_EQ(i * 2 + 1, entityManager.GetComponent<Component1>(entities[i])->value);
+    ASSERT_EQ(10, pipeline->GetStage<0>().calls.size());
+    ASSERT_EQ(pipeline->GetStage<0>().calls, pipeline->GetStage<1>().calls);
+}
+
+TEST_F(SystemManagerTest, PipelineSkipsEntitiesRemovedByEarlierStages)
+{
+    ECS::Pipeline<RemoveOddStage, DoubleStage>* pipeline = systemManager.RegisterPipeline<RemoveOddStage, DoubleStage>();
+    pipeline->GetStage<0>().entityManager = &entityManager;
+
+    std::vector<ECS::Entity> entities;
+    for (int i = 0; i < 10; ++i)
+    {
+        entities.push_back(entityManager.CreateEntity());
+        entityManager.AddComponent<Component1>(entities.back())->value = i;
+    }
+    entityManager.SetEnabled(entities[2], false);
+
+    pipeline->Process();
+    ASSERT_EQ(4, pipeline->GetStage<1>().calls.size());
+    ASSERT_EQ(5, pipeline->GetEntityCount());
+
+    entityManager.DestroyRemoved();
+    ASSERT_EQ(2, entityManager.GetComponent<Component1>(entities[2])->value);
+    ASSERT_EQ(8, entityManager.GetComponent<Component1>(entities[4])->value);
+}
+
+/**
+ * @brief A recording system processing entities with Component1, used for testing scheduling.
+ *
+ */
+class ScheduledSystem : public RecordingSystem
+{
+public:
+    ScheduledSystem()
+    {
+        Require<Component1>();
+    }
+};
+
+TEST_F(SystemManagerTest, IntervalSkipsCalls)
+{
+    ScheduledSystem* system = new ScheduledSystem;
+    system->SetInterval(3);
+    systemManager.RegisterSystem(system);
+    entityManager.AddComponent<Component1>(entityManager.CreateEntity());
+
+    for (int i = 0; i < 7; ++i)
+        system->Process();
+
+    // Calls 1, 4 and 7 do work.
+    ASSERT_EQ(3U, system->processed.size());
+}
+
+TEST_F(SystemManagerTest, SlicesCoverEveryEntityOncePerRound)
+{
+    ScheduledSystem* system = new ScheduledSystem;
+    system->SetSliceSize(4);
+    systemManager.RegisterSystem(system);
+
+    std::vector<ECS::Entity> entities;
+    for (int i = 0; i < 10; ++i)
+    {
+        entities.push_back(entityManager.CreateEntity());
+        entityManager.AddComponent<Component1>(entities.back());
+    }
+
+    system->Process();
+    ASSERT_EQ(4U, system->processed.size());
+
+    // Change the membership between slices: remove and disable visited entities, remove an unvisited one, add one.
+    std::set<ECS::Entity> visited(system->processed.begin(), system->processed.end());
+    entityManager.RemoveEntity(system->processed[0]);
+    entityManager.SetEnabled(system->processed[1], false);
+    ECS::Entity unvisited = ECS::INVALID_ENTITY;
+    for (auto entity : entities)
+    {
+        if (visited.count(entity) == 0)
+            unvisited = entity;
+    }
+    entityManager.RemoveEntity(unvisited);
+    ECS::Entity added = entityManager.CreateEntity();
+    entityManager.AddComponent<Component1>(added);
+
+    // The rest of the round visits every remaining entity that was not visited yet, exactly once.
+    system->Process();
+    system->Process();
+    ASSERT_EQ(4U + 6U, system->processed.size());
+    std::set<ECS::Entity> round(system->processed.begin(), system->processed.end());
+    ASSERT_EQ(10U, round.size());
+    ASSERT_EQ(1U, round.count(added));
+    ASSERT_EQ(0U, round.count(unvisited));
+
+    // The next round starts over.
+    system->processed.clear();
+    system->Process();
+    system->Process();
+    ASSERT_EQ(8U, system->processed.size());
+    ASSERT_EQ(8U, std::set<ECS::Entity>(system->processed.begin(), system->processed.end()).size());
+}
+
+/**
+ * @brief Takes a while for every entity and removes the entities it visits, used for testing time slices.
+ *
+ */
+class SlowSystem : public ScheduledSystem
+{
+public:
+    void ProcessEntity(ECS::Entity entity)
+    {
+        RecordingSystem::ProcessEntity(entity);
+        GetEntityManager()->RemoveEntity(entity);
+
+        std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now() + std::chrono::microseconds(20);
+        while (std::chrono::steady_clock::now() < end) {}
+    }
+};
+
+TEST_F(SystemManagerTest, TimeBudgetLimitsSlices)
+{
+    SlowSystem* system = new SlowSystem;
+    system->SetTimeBudget(100);
+    systemManager.RegisterSystem(system);
+
+    for (int i = 0; i < 100; ++i)
+        entityManager.AddComponent<Component1>(entityManager.CreateEntity());
+
+    system->Process();
+    size_t first = system->processed.size();
+    ASSERT_GE(first, 1U);
+    ASSERT_LT(first, 100U);
+
+    // Entities removed while processing do not make later slices skip anything.
+    while (system->GetEntityCount() > 0)
+        system->Process();
+    ASSERT_EQ(100U, system->processed.size());
+    ASSERT_EQ(100U, std::set<ECS::Entity>(system->processed.begin(), system->processed.end()).size());
+}
@@ -0,0 +1,262 @@
+#include <sstream>
+#include <gtest/gtest.h>
+#include "../include/ecs_include.h"
+#include "../include/components.h"
+
+/**
+ * @brief A system that does nothing, used for recording.
+ *
+ */
+class TracedSystem : public ECS::EntitySystem
+{
+public:
+    TracedSystem()
+    {
+        Require<Component1>();
+        Exclude<Component2>();
+    }
+
+    void ProcessEntity(ECS::Entity) {}
+};
+
+/**
+ * @brief A replay target that logs the calls it gets, used for testing.
+ *
+ */
+class LoggingTarget : public ECS::ReplayTarget
+{
+public:
+    LoggingTarget() : nextEntity(100) {}
+
+    void DeclareComponent(ECS::ComponentType componentType, size_t size)
+    {
+        std::ostringstream entry;
+        entry << "component " << componentType << " " << size;
+        log.push_back(entry.str());
+    }
+
+    void DeclareSystem(size_t system, const std::bitset<ECS::MAX_COMPONENTS>& aspect, const std::bitset<ECS::MAX_COMPONENTS>& exclude, const std::bitset<ECS::MAX_COMPONENTS>& anyOf)
+    {
+        std::ostringstream entry;
+        entry << "system " << system << " " << aspect.to_ulong() << " " << exclude.to_ulong() << " " << anyOf.to_ulong();
+        log.push_back(entry.str());
+    }
+
+    ECS::Entity CreateEntity()
+    {
+        log.push_back("create " + std::to_string(nextEntity));
+        return nextEntity++;
+    }
+
+    void RemoveEntity(ECS::Entity entity)
+    {
+        log.push_back("remove " + std::to_string(entity));
+    }
+
+    void AddComponent(ECS::Entity entity, ECS::ComponentType componentType)
+    {
+        log.push_back("add " + std::to_string(entity) + " " + std::to_string(componentType));
+    }
+
+    void RemoveComponent(ECS::Entity entity, ECS::ComponentType componentType)
+    {
+        log.push_back("remove " + std::to_string(entity) + " " + std::to_string(componentType));
+    }
+
+    void DestroyRemoved()
+    {
+        log.push_back("destroy");
+    }
+
+    void Process(size_t system)
+    {
+        log.push_back("process " + std::to_string(system));
+    }
+
+    ECS::Entity nextEntity;
+    std::vector<std::string> log;
+};
+
+TEST(Trace, RecordsAndReplays)
+{
+    std::stringstream stream;
+    {
+        ECS::TraceRecorder recorder(stream);
+        ECS::EntityManager entityManager;
+        ECS::SystemManager systemManager(&entityManager);
+        entityManager.SetRecorder(&recorder);
+        systemManager.SetRecorder(&recorder);
+
+        TracedSystem* system = new TracedSystem;
+        systemManager.RegisterSystem(system);
+
+        // Skip some UUIDs, so the replayed entities are different from the recorded ones.
+        entityManager.SetRecorder(nullptr);
+        for (int i = 0; i < 1000; ++i)
+            entityManager.CreateEntity();
+        entityManager.SetRecorder(&recorder);
+
+        ECS::Entity a = entityManager.CreateEntity();
+        ECS::Entity b = entityManager.CreateEntity();
+        entityManager.AddComponent<Component1>(a);
+        entityManager.AddComponent<Component1>(b);
+        entityManager.AddComponent<Component2>(b);
+        system->Process();
+        entityManager.RemoveComponent<Component2>(b);
+        entityManager.RemoveEntity(a);
+        entityManager.DestroyRemoved();
+        system->Process();
+
+        ASSERT_EQ(10U, recorder.GetOperationCount());
+    }
+
+    ECS::TraceReader reader(stream);
+    ASSERT_TRUE(reader.IsValid());
+
+    LoggingTarget target;
+    ECS::TraceReplayer replayer;
+    ASSERT_TRUE(replayer.Replay(reader, target));
+
+    std::string c1 = std::to_string(ECS::Component<Component1>::ID);
+    std::string c2 = std::to_string(ECS::Component<Component2>::ID);
+    std::ostringstream system;
+    system << "system 0 " << (1UL << ECS::Component<Component1>::ID) << " " << (1UL << ECS::Component<Component2>::ID) << " 0";
+
+    std::vector<std::string> expected =
+    {
+        "create 100",
+        "create 101",
+        "component " + c1 + " " + std::to_string(sizeof(Component1)),
+        "add 100 " + c1,
+        "add 101 " + c1,
+        "component " + c2 + " " + std::to_string(sizeof(Component2)),
+        "add 101 " + c2,
+        system.str(),
+        "process 0",
+        "remove 101 " + c2,
+        "remove 100",
+        "destroy",
+        "process 0"
+    };
+    ASSERT_EQ(expected, target.log);
+
+    ASSERT_EQ(2U, replayer.GetCount(ECS::TraceOperation::CREATE_ENTITY));
+    ASSERT_EQ(2U, replayer.GetCount(ECS::TraceOperation::PROCESS));
+    ASSERT_EQ(0U, replayer.GetCount(ECS::TraceOperation::DECLARE_SYSTEM));
+    ASSERT_LE(replayer.GetPercentile(ECS::TraceOperation::ADD_COMPONENT, 50.0), replayer.GetPercentile(ECS::TraceOperation::ADD_COMPONENT, 100.0));
+}
+
+TEST(Trace, RejectsMalformedTraces)
+{
+    std::stringstream notATrace("not a trace");
+    ECS::TraceReader reader(notATrace);
+    ASSERT_FALSE(reader.IsValid());
+
+    // A trace cut off in the middle of an operation.
+    std::stringstream stream;
+    {
+        ECS::TraceRecorder recorder(stream);
+        recorder.CreateEntity(1000);
+    }
+    std::string truncated = stream.str();
+    truncated.resize(truncated.size() - 1);
+
+    std::stringstream truncatedStream(truncated);
+    ECS::TraceReader truncatedReader(truncatedStream);
+    ASSERT_TRUE(truncatedReader.IsValid());
+
+    LoggingTarget target;
+    ECS::TraceReplayer replayer;
+    ASSERT_FALSE(replayer.Replay(truncatedReader, target));
+
+    // An operation on an entity that was never created.
+    std::stringstream unknown;
+    {
+        ECS::TraceRecorder recorder(unknown);
+        recorder.RemoveEntity(5);
+    }
+    ECS::TraceReader unknownReader(unknown);
+    ASSERT_FALSE(replayer.Replay(unknownReader, target));
+}
+
+TEST(Trace, RecordsPrefabsAndInstances)
+{
+    std::stringstream stream;
+    {
+        ECS::TraceRecorder recorder(stream);
+        ECS::EntityManager entityManager;
+        entityManager.SetRecorder(&recorder);
+
+        ECS::Entity prefab = entityManager.CreatePrefab();
+        entityManager.AddComponent<Component1>(prefab);
+        std::vector<ECS::Entity> instances = entityManager.Instantiate(prefab, 2);
+        entityManager.RemoveEntity(instances[0]);
+        entityManager.DestroyRemoved();
+    }
+
+    ECS::TraceReader reader(stream);
+    ASSERT_TRUE(reader.IsValid());
+
+    LoggingTarget target;
+    ECS::TraceReplayer replayer;
+    ASSERT_TRUE(replayer.Replay(reader, target));
+
+    std::string c1 = std::to_string(ECS::Component<Component1>::ID);
+    std::vector<std::string> expected =
+    {
+        "create 100",
+        "component " + c1 + " " + std::to_string(sizeof(Component1)),
+        "add 100 " + c1,
+        "create 101",
+        "add 101 " + c1,
+        "create 102",
+        "add 102 " + c1,
+        "remove 101",
+        "destroy"
+    };
+    ASSERT_EQ(expected, target.log);
+}
+
+TEST(Trace, KeepsRemovedEntitiesUntilDestroyed)
+{
+    // Components may still be removed from an entity after it is removed, until it is destroyed.
+    std::stringstream stream;
+    {
+        ECS::TraceRecorder recorder(stream);
+        recorder.CreateEntity(5);
+        recorder.AddComponent(5, 0, 4);
+        recorder.RemoveEntity(5);
+        recorder.RemoveComponent(5, 0);
+        recorder.DestroyRemoved();
+    }
+    ECS::TraceReader reader(stream);
+    LoggingTarget target;
+    ECS::TraceReplayer replayer;
+    ASSERT_TRUE(replayer.Replay(reader, target));
+
+    // After that, the entity is gone.
+    std::stringstream destroyed;
+    {
+        ECS::TraceRecorder recorder(destroyed);
+        recorder.CreateEntity(5);
+        recorder.RemoveEntity(5);
+        recorder.DestroyRemoved();
+        recorder.RemoveEntity(5);
+    }
+    ECS::TraceReader destroyedReader(destroyed);
+    ECS::TraceReplayer destroyedReplayer;
+    ASSERT_FALSE(destroyedReplayer.Replay(destroyedReader, target));
+}
+
+TEST(Trace, PercentilesUseNearestRank)
+{
+    ECS::TraceReplayer replayer;
+    for (uint64_t i = 10; i > 0; --i)
+        replayer.latencies[ECS::TraceOperation::PROCESS].push_back(i);
+    replayer.sorted[ECS::TraceOperation::PROCESS] = false;
+
+    ASSERT_EQ(1U, replayer.GetPercentile(ECS::TraceOperation::PROCESS, 0.0));
+    ASSERT_EQ(3U, replayer.GetPercentile(ECS::TraceOperation::PROCESS, 21.0));
+    ASSERT_EQ(5U, replayer.GetPercentile(ECS::TraceOperation::PROCESS, 50.0));
+    ASSERT_EQ(10U, replayer.GetPercentile(ECS::TraceOperation::PROCESS, 100.0));
+}